@@ -171,6 +171,12 @@ void Spi_SetCS(boolean_t bFlag);
 en_result_t Spi_SendData(uint8_t u8Data);
 //SPI 接收数据
 uint8_t Spi_ReceiveData(void);
+//SPI 批量发送数据
+en_result_t Spi_SendBuf(const uint8_t *pu8Buf, uint32_t u32Len);
+//SPI 批量接收数据
+en_result_t Spi_ReceiveBuf(uint8_t *pu8Buf, uint32_t u32Len);
+//SPI 批量全双工传输
+en_result_t Spi_TransferBuf(const uint8_t *pu8Tx, uint8_t *pu8Rx, uint32_t u32Len);
 
 //@} // Spi Group
 
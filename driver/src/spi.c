@@ -65,6 +65,8 @@
  * Local pre-processor symbols/macros ('#define')
  *****************************************************************************/
 
+#define SPI_BUF_TIMEOUT_PER_BYTE    1000u   ///< 批量传输的超时预算（每字节等待次数）
+
 #define IS_VALID_STAT(x)            (   SpiIf == (x)||\
                                         SpiWcol == (x)||\
                                         SpiSserr == (x)||\
@@ -268,6 +270,127 @@ uint8_t Spi_ReceiveData(void)
     return temp;
 }
 
+/**
+ ******************************************************************************
+ ** \brief  SPI 批量发送函数
+ **
+ ** 直接访问 DATA/STAT 寄存器，整个数据块共用一个超时预算，
+ ** 接收到的数据丢弃
+ **
+ ** \param [in] pu8Buf 发送数据指针
+ ** \param [in] u32Len 发送长度
+ **
+ ** \retval Ok发送成功
+ ** \retval ErrorInvalidParameter 参数错误
+ ** \retval ErrorTimeout 发送超时
+ ** 
+ ******************************************************************************/
+en_result_t Spi_SendBuf(const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t u32TimeOut;
+    volatile uint8_t u8Dummy;
+
+    if (NULL == pu8Buf)
+    {
+        return ErrorInvalidParameter;
+    }
+
+    u32TimeOut = u32Len * SPI_BUF_TIMEOUT_PER_BYTE;
+    while (u32Len--)
+    {
+        M0P_SPI->DATA = *pu8Buf++;
+        while (0 == M0P_SPI->STAT_f.SPIF)
+        {
+            if (0 == --u32TimeOut)
+            {
+                return ErrorTimeout;
+            }
+        }
+        u8Dummy = M0P_SPI->DATA;
+    }
+    (void)u8Dummy;
+    return Ok;
+}
+
+/**
+ ******************************************************************************
+ ** \brief  SPI 批量接收函数
+ **
+ ** 发送 0x00 产生时钟，直接访问 DATA/STAT 寄存器，整个数据块共用一个超时预算
+ **
+ ** \param [out] pu8Buf 接收数据指针
+ ** \param [in]  u32Len 接收长度
+ **
+ ** \retval Ok接收成功
+ ** \retval ErrorInvalidParameter 参数错误
+ ** \retval ErrorTimeout 接收超时
+ ** 
+ ******************************************************************************/
+en_result_t Spi_ReceiveBuf(uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t u32TimeOut;
+
+    if (NULL == pu8Buf)
+    {
+        return ErrorInvalidParameter;
+    }
+
+    u32TimeOut = u32Len * SPI_BUF_TIMEOUT_PER_BYTE;
+    while (u32Len--)
+    {
+        M0P_SPI->DATA = 0x00;
+        while (0 == M0P_SPI->STAT_f.SPIF)
+        {
+            if (0 == --u32TimeOut)
+            {
+                return ErrorTimeout;
+            }
+        }
+        *pu8Buf++ = (uint8_t)M0P_SPI->DATA;
+    }
+    return Ok;
+}
+
+/**
+ ******************************************************************************
+ ** \brief  SPI 批量全双工传输函数
+ **
+ ** 同时发送 pu8Tx 并接收到 pu8Rx，整个数据块共用一个超时预算
+ **
+ ** \param [in]  pu8Tx 发送数据指针
+ ** \param [out] pu8Rx 接收数据指针（可与 pu8Tx 相同）
+ ** \param [in]  u32Len 传输长度
+ **
+ ** \retval Ok传输成功
+ ** \retval ErrorInvalidParameter 参数错误
+ ** \retval ErrorTimeout 传输超时
+ ** 
+ ******************************************************************************/
+en_result_t Spi_TransferBuf(const uint8_t *pu8Tx, uint8_t *pu8Rx, uint32_t u32Len)
+{
+    uint32_t u32TimeOut;
+
+    if ((NULL == pu8Tx) || (NULL == pu8Rx))
+    {
+        return ErrorInvalidParameter;
+    }
+
+    u32TimeOut = u32Len * SPI_BUF_TIMEOUT_PER_BYTE;
+    while (u32Len--)
+    {
+        M0P_SPI->DATA = *pu8Tx++;
+        while (0 == M0P_SPI->STAT_f.SPIF)
+        {
+            if (0 == --u32TimeOut)
+            {
+                return ErrorTimeout;
+            }
+        }
+        *pu8Rx++ = (uint8_t)M0P_SPI->DATA;
+    }
+    return Ok;
+}
+
 //@} // SpiGroup
 /******************************************************************************
  * EOF (not truncated)
@@ -1,5 +1,13 @@
 #include "crc_utils.h"
 #include "flash_config.h"
+#include "crc32_tables.h"
+#if CRC16_USE_HW
+#include "crc.h"
+#endif
+
+#if (CRC32_IMPL != CRC32_IMPL_BITWISE) && (CRC32_TABLES_POLYNOMIAL != CRC32_POLYNOMIAL)
+#error "crc32_tables.h is out of date, run tools/gen_crc_tables.py"
+#endif
 
 // 标准CRC32配置（IEEE 802.3）
 const crc32_config_t CRC32_IEEE = {
@@ -10,6 +18,64 @@ const crc32_config_t CRC32_IEEE = {
     0
 };
 
+/**
+ * @brief 逐位计算，用于非默认多项式
+ */
+static uint32_t crc32_update_bitwise(uint32_t crc, const uint8_t* data, uint32_t length, uint32_t polynomial)
+{
+    uint32_t i, j;
+
+    for (i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (j = 0; j < 8; j++) {
+            if (crc & 1) {
+                crc = (crc >> 1) ^ polynomial;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief 增量计算CRC32（默认多项式），实现由 CRC32_IMPL 选择
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, uint32_t length)
+{
+#if (CRC32_IMPL == CRC32_IMPL_NIBBLE)
+    while (length--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ crc32_table_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_table_nibble[crc & 0x0F];
+    }
+    return crc;
+#elif (CRC32_IMPL == CRC32_IMPL_BYTE)
+    while (length--) {
+        crc = (crc >> 8) ^ crc32_table_byte0[(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+#elif (CRC32_IMPL == CRC32_IMPL_SLICE4)
+    // 每次处理4字节（按字节拼接，不要求地址对齐）
+    while (length >= 4u) {
+        crc ^= (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+               ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+        crc = crc32_table_byte3[crc & 0xFF] ^
+              crc32_table_byte2[(crc >> 8) & 0xFF] ^
+              crc32_table_byte1[(crc >> 16) & 0xFF] ^
+              crc32_table_byte0[crc >> 24];
+        data += 4;
+        length -= 4u;
+    }
+    while (length--) {
+        crc = (crc >> 8) ^ crc32_table_byte0[(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+#else
+    return crc32_update_bitwise(crc, data, length, CRC32_POLYNOMIAL);
+#endif
+}
+
 /**
  * @brief 计算CRC32校验值
  * @param data 数据指针
@@ -21,34 +87,20 @@ uint32_t calculate_crc32(const uint8_t* data, uint32_t length, const crc32_confi
 // uint32_t calculate_crc32(uint8_t* data, uint32_t length, const crc32_config_t* config)
 {
     uint32_t crc;
-    uint32_t i, j;
-    uint32_t polynomial;
-    uint32_t initial_value;
-    uint32_t final_xor;
     
     // 如果没有提供配置，使用默认配置
     if (config == NULL) {
         config = &CRC32_IEEE;
     }
     
-    polynomial = config->polynomial;
-    initial_value = config->initial_value;
-    final_xor = config->final_xor;
-    
-    crc = initial_value;
-    
-    for (i = 0; i < length; i++) {
-        crc ^= data[i];
-        for (j = 0; j < 8; j++) {
-            if (crc & 1) {
-                crc = (crc >> 1) ^ polynomial;
-            } else {
-                crc >>= 1;
-            }
-        }
+    // 默认多项式走查表实现，其他多项式逐位计算
+    if (config->polynomial == CRC32_POLYNOMIAL) {
+        crc = crc32_update(config->initial_value, data, length);
+    } else {
+        crc = crc32_update_bitwise(config->initial_value, data, length, config->polynomial);
     }
     
-    return crc ^ final_xor;
+    return crc ^ config->final_xor;
 }
 
 /**
@@ -62,3 +114,104 @@ uint32_t calculate_crc32_default(const uint8_t* data, uint32_t length)
 {
     return calculate_crc32(data, length, NULL);
 }
+
+// CRC16-CCITT 半字节表（poly 0x1021）
+static const uint16_t crc16_table_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+#if CRC16_USE_HW
+// 硬件状态：0xFF 未自检，0 使用软件，1 硬件按字节，3 硬件按字节且可按字输入
+#define CRC16_HW_UNKNOWN        0xFFu
+#define CRC16_HW_BYTE           0x01u
+#define CRC16_HW_WORD           0x02u
+static uint8_t crc16HwMode = CRC16_HW_UNKNOWN;
+#endif
+
+/**
+ * @brief 软件计算CRC16-CCITT（半字节查表）
+ */
+uint16_t crc16_ccitt_update_sw(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+    while (len--) {
+        crc = (uint16_t)((crc << 4) ^ crc16_table_nibble[((crc >> 12) ^ (*data >> 4)) & 0x0F]);
+        crc = (uint16_t)((crc << 4) ^ crc16_table_nibble[((crc >> 12) ^ *data) & 0x0F]);
+        data++;
+    }
+    return crc;
+}
+
+#if CRC16_USE_HW
+/**
+ * @brief 硬件计算CRC16：写入当前值作为初值，4字节对齐部分按字输入
+ */
+static uint16_t crc16_ccitt_update_hw(uint16_t crc, const uint8_t* data, uint32_t len, uint8_t mode)
+{
+    M0P_CRC->RESULT_f.RESULT = crc;
+    while (len && (((uint32_t)data & 3u) != 0u)) {
+        *((volatile uint8_t*)(&(M0P_CRC->DATA_f))) = *data++;
+        len--;
+    }
+    if (mode & CRC16_HW_WORD) {
+        while (len >= 4u) {
+            M0P_CRC->DATA_f.DATA = *(const uint32_t*)data;
+            data += 4;
+            len -= 4u;
+        }
+    }
+    while (len--) {
+        *((volatile uint8_t*)(&(M0P_CRC->DATA_f))) = *data++;
+    }
+    return (uint16_t)M0P_CRC->RESULT_f.RESULT;
+}
+#endif
+
+/**
+ * @brief 硬件CRC16自检
+ */
+uint8_t crc16_ccitt_hw_init(void)
+{
+#if CRC16_USE_HW
+    // 字对齐的测试向量，覆盖 续算初值 / 字节输入 / 字输入 三种情况
+    static const uint32_t vector[3] = { 0x34333231u, 0x38373635u, 0xA5C30F39u };
+    const uint8_t* p = (const uint8_t*)vector;
+    uint16_t expect;
+
+    crc16HwMode = 0;
+    expect = crc16_ccitt_update_sw(CRC16_CCITT_INIT, p, sizeof(vector));
+    if (crc16_ccitt_update_hw(crc16_ccitt_update_hw(CRC16_CCITT_INIT, p, 5, 0), p + 5, sizeof(vector) - 5u, 0) == expect) {
+        crc16HwMode = CRC16_HW_BYTE;
+        if (crc16_ccitt_update_hw(CRC16_CCITT_INIT, p, sizeof(vector), CRC16_HW_BYTE | CRC16_HW_WORD) == expect) {
+            crc16HwMode |= CRC16_HW_WORD;
+        }
+    }
+    return (crc16HwMode != 0) ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief 增量计算CRC16-CCITT，硬件自检通过时使用硬件
+ */
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+#if CRC16_USE_HW
+    if (crc16HwMode == CRC16_HW_UNKNOWN) {
+        (void)crc16_ccitt_hw_init();
+    }
+    if (crc16HwMode != 0) {
+        return crc16_ccitt_update_hw(crc, data, len, crc16HwMode);
+    }
+#endif
+    return crc16_ccitt_update_sw(crc, data, len);
+}
+
+/**
+ * @brief 计算CRC16-CCITT
+ */
+uint16_t crc16_ccitt(const uint8_t* data, uint32_t len)
+{
+    return crc16_ccitt_update(CRC16_CCITT_INIT, data, len);
+}
@@ -3,6 +3,27 @@
 
 #include <stdint.h>
 
+// CRC32 实现选择（编译时）：ROM 占用与速度的折中
+#define CRC32_IMPL_BITWISE      0   // 逐位计算，无表
+#define CRC32_IMPL_NIBBLE       1   // 16 项半字节表，64 字节
+#define CRC32_IMPL_BYTE         2   // 256 项字节表，1 KB
+#define CRC32_IMPL_SLICE4       3   // slice-by-4，4 KB
+
+#ifndef CRC32_IMPL
+#define CRC32_IMPL              CRC32_IMPL_NIBBLE
+#endif
+
+// CRC16-CCITT 是否使用芯片硬件CRC单元（主机编译时只用软件实现）
+#ifndef CRC16_USE_HW
+#if defined(__CC_ARM) || defined(__ARMCC_VERSION)
+#define CRC16_USE_HW            1
+#else
+#define CRC16_USE_HW            0
+#endif
+#endif
+
+#define CRC16_CCITT_INIT        0xFFFFu     // CRC16-CCITT-FALSE: poly 0x1021, init 0xFFFF, 不反转, 无结果异或
+
 // CRC32配置结构
 typedef struct {
     uint32_t polynomial;    // CRC多项式
@@ -24,6 +45,15 @@ extern const crc32_config_t CRC32_IEEE;
  */
 uint32_t calculate_crc32(const uint8_t* data, uint32_t length, const crc32_config_t* config);
 
+/**
+ * @brief 增量计算CRC32（默认多项式，不做初值和结果异或）
+ * @param crc 上一次的返回值，首次调用传入 0xFFFFFFFF
+ * @param data 数据指针
+ * @param length 数据长度
+ * @return uint32_t 更新后的CRC，全部数据处理完后与 0xFFFFFFFF 异或得到结果
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, uint32_t length);
+
 /**
  * @brief 计算CRC32校验值（使用默认配置）
  * @param data 数据指针
@@ -32,4 +62,35 @@ uint32_t calculate_crc32(const uint8_t* data, uint32_t length, const crc32_confi
  */
 uint32_t calculate_crc32_default(const uint8_t* data, uint32_t length);
 
+/**
+ * @brief 硬件CRC16自检，确认与软件CRC16-CCITT逐位一致后才启用硬件
+ * @note 需在CRC外设时钟打开后调用；未调用时在第一次计算时自动执行
+ * @return uint8_t 1 使用硬件，0 使用软件
+ */
+uint8_t crc16_ccitt_hw_init(void);
+
+/**
+ * @brief 增量计算CRC16-CCITT
+ * @param crc 上一次的返回值，首次调用传入 CRC16_CCITT_INIT
+ * @param data 数据指针
+ * @param len 数据长度
+ * @return uint16_t 更新后的CRC（CCITT-FALSE 无结果异或，直接作为结果使用）
+ * @note 硬件CRC单元为共享资源，只能在主循环中调用，不能在中断中调用
+ */
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t* data, uint32_t len);
+
+/**
+ * @brief 软件增量计算CRC16-CCITT，不使用硬件CRC单元
+ * @note 可在中断中调用
+ */
+uint16_t crc16_ccitt_update_sw(uint16_t crc, const uint8_t* data, uint32_t len);
+
+/**
+ * @brief 计算CRC16-CCITT（高字节在前发送）
+ * @param data 数据指针
+ * @param len 数据长度
+ * @return uint16_t CRC16值
+ */
+uint16_t crc16_ccitt(const uint8_t* data, uint32_t len);
+
 #endif // CRC_UTILS_H
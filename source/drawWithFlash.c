@@ -122,23 +122,6 @@ static const unsigned char FONT_5X7[62][5] = {
 };
 static uint8_t pageBuffer[PAGE_SIZE];
 
-/* 软件 CRC16-CCITT (poly 0x1021, init 0xFFFF) */
-static uint16_t crc16_ccitt_sw(const uint8_t *data, uint32_t len)
-{
-    uint16_t crc = 0xFFFF;
-    uint32_t i;
-	  uint8_t j;
-    for (i = 0; i < len; ++i) {
-        crc ^= ((uint16_t)data[i]) << 8;
-
-        for (j = 0; j < 8; ++j) {
-            if (crc & 0x8000u) crc = (uint16_t)((crc << 1) ^ 0x1021u);
-            else crc = (uint16_t)(crc << 1);
-        }
-    }
-    return crc;
-}
-
 /**
  * 测试接口：接受一帧数据（应包含 PAGE_SIZE 字节的数据，随后2字节 CRC 高字节/低字节），
  * 校验通过则将该 page 写入 slot 的第 0 页，其余页写白色，并刷新电子纸显示。
@@ -168,7 +151,7 @@ static uint16_t crc16_ccitt_sw(const uint8_t *data, uint32_t len)
 //     recv_crc = ((uint16_t)buf[PAGE_SIZE] << 8) | (uint16_t)buf[PAGE_SIZE + 1];
 
 //     /* 计算软件 CRC */
-//     calc = crc16_ccitt_sw(pageBuffer, PAGE_SIZE);
+//     calc = crc16_ccitt(pageBuffer, PAGE_SIZE);
 
 //     if (calc != recv_crc) {
 //         UARTIF_uartPrintf(0, "TEST: CRC ERR recv=0x%04X calc=0x%04X\r\n", recv_crc, calc);
@@ -32,7 +32,7 @@
 /******************************************************************************
  * Local pre-processor symbols/macros ('#define')                            
  ******************************************************************************/
-#define BUFFER_SIZE 256u
+#define BUFFER_SIZE PAYLOAD_SIZE  // FM_readImage 每页最多 PAYLOAD_SIZE 字节
 #define DC_H    Gpio_SetIO(0, 1, 1) //DC输出高
 #define DC_L    Gpio_SetIO(0, 1, 0) //DC输出低
 #define RST_H   Gpio_SetIO(0, 3, 1) //RST输出高
@@ -112,14 +112,10 @@ static void spiInit(void)
 
 static void writeBuffer(uint8_t *buf, uint16_t size)
 {
-    uint16_t i;
     Spi_SetCS(TRUE);
     Spi_SetCS(FALSE);
 
-    for (i = 0; i < size; i++)
-    {
-        Spi_SendData(*(buf + i));
-    }
+    Spi_SendBuf(buf, size);
     Spi_SetCS(TRUE);
 
 }
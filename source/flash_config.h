@@ -12,6 +12,7 @@
 #define PAYLOAD_SIZE            248u         // 有效载荷大小
 
 // Segment配置
+// 以下为 W25Q32 的默认值，flash_manager 运行时按 SFDP/JEDEC 读到的容量划分segment
 #define FLASH_SEGMENT_COUNT     2           // 两个segment
 #define FLASH_SEGMENT_SIZE      (FLASH_TOTAL_SIZE / 2)  // 每个segment 2MB
 #define FLASH_SEGMENT0_BASE     FLASH_BASE_ADDRESS      // Segment 0基地址
@@ -25,10 +26,17 @@
 #define FLASH_PAGES_PER_SEGMENT (FLASH_SEGMENT_SIZE / FLASH_PAGE_SIZE)  // 每个segment的page数量：8192
 #define FLASH_DATA_PAGES_PER_SEGMENT (FLASH_PAGES_PER_SEGMENT - 1)     // 数据page数量：8191（除去header page）
 
+// page索引为uint16，0xFFFF为无效值：最多管理16MB，且最后一个page不使用
+#define FLASH_MAX_MANAGED_SIZE  0x1000000u
+#define FLASH_MAX_MANAGED_END   0xFFFF00u
+
 // 数据管理配置
 #define MAX_DATA_ENTRIES        16         // 最大数据条目数
 #define MAX_IMAGE_ENTRIES       8         //  最大图像条目数
 #define MAX_FRAME_NUM           60         // 最大帧数总共61 帧，0-60
+#define IMAGE_LAYER_PAGES       (MAX_FRAME_NUM + 2u) // 单层图像占用page数：61 数据页 + 1 头页
+#define FM_USER_DATA_ENTRIES    (MAX_DATA_ENTRIES - 1) // 对外开放的数据条目数（DATA_PAGE_MAGIC 的 dataId 0-14）
+#define FM_TRANSFER_DATA_ID     FM_USER_DATA_ENTRIES   // 可续传传输记录占用的数据条目，FM_writeData/FM_readData/FM_deleteData 不接受
 
 #define INVALID_DATA_ID         0xFFFF    // 无效数据ID (16位)
 #define INVALID_ADDRESS         0xFFFFFFFF  // 无效地址
@@ -9,24 +9,46 @@
 #include <stdint.h>
 #include <string.h>
 #include "uart_interface.h"
+#include "log.h"
 #include "crc_utils.h"
 #include "ddl.h"
 
 
+/******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+// segment边界由 FM_init() 根据器件容量确定
+#define SEGMENT1_BASE           (fmCtx.segmentSize)     // Segment 1基地址
+#define SEGMENT1_END            (fmCtx.segment1End)     // Segment 1结束地址（不含）
+#define SEGMENT0_FIRST_PAGE     ((uint16_t)((FLASH_SEGMENT0_BASE >> 8u) + 1u))
+#define SEGMENT1_FIRST_PAGE     ((uint16_t)((SEGMENT1_BASE >> 8u) + 1u))
+
+// 可续传传输记录：ID(4) | CRC(4) | MAGIC(1) | SLOT(1) | 起始page(2) | GC次数(4)，小端
+#define TRANSFER_RECORD_SIZE    16u
+#define NO_TRANSFER             0xffffu
+
 /******************************************************************************
  * Local function prototypes ('static')
  ******************************************************************************/
 
 static flash_result_t readSegmentHeader(uint32_t segmentBase, boolean_t isDstHeaderHigh);
-static flash_result_t resetSegment(boolean_t isSetHiSegment, const uint32_t statusMagic, const uint32_t currentGcCounter);
+static flash_result_t resetSegment(boolean_t isSetHiSegment, const uint32_t statusMagic, const uint32_t currentGcCounter, boolean_t needErase);
 static flash_result_t scanSegmentPages(void);
 //static int16_t find_data_entry(flash_manager_t* manager, uint16_t dataId);
 //static flash_result_t add_data_entry(flash_manager_t* manager, uint16_t dataId, uint32_t page_address);
 
 static flash_result_t eraseSegment(boolean_t eraseHiSegment);
+static flash_result_t eraseRange(uint32_t startAddr, uint32_t endAddr);
 static flash_result_t copyValidPages(void);
-static void readBlock(uint8_t blockAddress);
+static uint8_t scanPageCallback(uint32_t addr, uint8_t *buf, uint16_t len, void *ctx);
 static flash_result_t garbageCollect(void);
+static flash_result_t programPageBuffer(uint8_t magic, uint16_t dataId, uint16_t size);
+static flash_result_t writeData(uint8_t magic, uint16_t dataId, const uint8_t* data, uint16_t size);
+static flash_result_t readData(uint8_t magic, uint16_t dataId, uint8_t* data, uint8_t size);
+static boolean_t isReservedDataId(uint8_t magic, uint16_t dataId);
+static void initGeometry(void);
+static boolean_t isUsedPageMagic(uint8_t magic);
+static uint8_t transferScanCallback(uint32_t addr, uint8_t *buf, uint16_t len, void *ctx);
 
 /******************************************************************************
  * Local variable definitions ('static')                                      *
@@ -35,10 +57,31 @@ static flash_manager_t fmCtx;
 
 // 静态缓冲区，用于Flash读写操作的中间变量
 static uint8_t G_buffer1[FLASH_PAGE_SIZE] = {0};
-static uint8_t G_buffer2[FLASH_PAGE_SIZE] = {0};
+static uint8_t G_buffer2[(MAX_FRAME_NUM + 1) * 2] = {0};     // 图层头页（地址表）
+// G_buffer1 数据区已由 FM_getPageBuffer 借出；其它使用 G_buffer1 的地方都要清掉，FM_writePageBuffer 据此拒绝已被覆盖的数据
+static boolean_t G_pageBufferLent = FALSE;
 
 static uint16_t G_imageAddressBuffer[MAX_FRAME_NUM + 1u];
 
+// 续传扫描上下文
+typedef struct {
+    uint8_t magic;
+    uint8_t slotId;
+    uint64_t received;
+} transfer_scan_t;
+
+// 擦除规划：器件支持的擦除粒度（升序，kind[0] 为 4KB）与本次擦除范围
+typedef struct {
+    w25q32_erase_type_t kind[W25Q32_MAX_ERASE_TYPES];
+    uint32_t cost[W25Q32_MAX_ERASE_TYPES];  // 预计耗时（100us）
+    uint8_t count;
+    uint32_t startAddr;
+    uint32_t endAddr;
+    uint32_t unitAddr;                      // 当前规划单元（最大粒度）起始地址
+    uint32_t dirtyMask;                     // 单元内非空的sector
+    flash_result_t result;                  // 第一次擦除失败的结果
+} erase_plan_t;
+
 /*****************************************************************************
  * Function implementation - local ('static')
  ******************************************************************************/
@@ -57,15 +100,21 @@ static void resetSegments(
     flash_result_t* result
 ) {
     if (reset0 && reset1) {
-        *result = resetSegment(FALSE, statusMagic0, 0);
-        *result = resetSegment(TRUE, statusMagic1, 0);
+        // 两个segment一起擦除，由擦除规划决定是否使用整片擦除
+        *result = eraseRange(FLASH_SEGMENT0_BASE, SEGMENT1_END);
+        if (*result == FLASH_OK) {
+            *result = resetSegment(FALSE, statusMagic0, 0, FALSE);
+        }
+        if (*result == FLASH_OK) {
+            *result = resetSegment(TRUE, statusMagic1, 0, FALSE);
+        }
         fmCtx.activeSegmentBaseStatus = MAGIC_LOW_ACTIVE;
         fmCtx.gcInProgress = 0;
     } else if (reset0) {
-        *result = resetSegment(FALSE, statusMagic0, 0);
+        *result = resetSegment(FALSE, statusMagic0, 0, TRUE);
         fmCtx.activeSegmentBaseStatus = MAGIC_LOW_ACTIVE;
     } else if (reset1) {
-        *result = resetSegment(TRUE, statusMagic1, 0);
+        *result = resetSegment(TRUE, statusMagic1, 0, TRUE);
         fmCtx.activeSegmentBaseStatus = MAGIC_HIGH_ACTIVE;
     }
 }
@@ -87,6 +136,7 @@ static flash_result_t readSegmentHeader(uint32_t segmentBase, boolean_t isDstHea
         header = &fmCtx.header0;
     }
 
+    G_pageBufferLent = FALSE;
     if (W25Q32_ReadData(segmentBase, G_buffer1, sizeof(segment_header_t)) != 0) 
     {
         re = FLASH_ERROR_READ_FAIL;
@@ -144,13 +194,15 @@ static flash_result_t readSegmentHeader(uint32_t segmentBase, boolean_t isDstHea
 
 /**
  * @brief 写入segment头
+ * @param needErase 是否先擦除该segment（调用者已擦除时为FALSE）
  */
-static flash_result_t resetSegment(boolean_t isSetHiSegment, const uint32_t statusMagic, const uint32_t currentGcCounter)
+static flash_result_t resetSegment(boolean_t isSetHiSegment, const uint32_t statusMagic, const uint32_t currentGcCounter, boolean_t needErase)
 {
 	uint32_t crc32;
     flash_result_t re = FLASH_OK;
 
     // 清空缓冲区
+    G_pageBufferLent = FALSE;
     memset(G_buffer1, 0x00u, 256);
 
     // 将结构体字段复制到缓冲区
@@ -173,9 +225,12 @@ static flash_result_t resetSegment(boolean_t isSetHiSegment, const uint32_t stat
     G_buffer1[13] = (uint8_t)((crc32 >> 24) & 0xFF);
 
     // 擦除一个sg
-    eraseSegment( isSetHiSegment);
+    if (needErase)
+    {
+        re = eraseSegment(isSetHiSegment);
+    }
 
-    UARTIF_uartPrintf(0, "flash_manager: reset segment %s! \n", isSetHiSegment ? "1" : "0");
+    LOG1(LOG_FM_RESET_SEGMENT, isSetHiSegment ? 1u : 0u);
     // UARTIF_uartPrintf(0, "buffer 0 is 0x%02x! \n", G_buffer1[0]);
     // UARTIF_uartPrintf(0, "buffer 1 is 0x%02x! \n", G_buffer1[1]);
     // UARTIF_uartPrintf(0, "buffer 2 is 0x%02x! \n", G_buffer1[2]);
@@ -192,7 +247,7 @@ static flash_result_t resetSegment(boolean_t isSetHiSegment, const uint32_t stat
     // UARTIF_uartPrintf(0, "buffer 13 is 0x%02x! \n", G_buffer1[13]);
 
     // 写入header（写入整个页面以保持256字节对齐）
-    if (W25Q32_WritePage(isSetHiSegment ? FLASH_SEGMENT1_BASE : FLASH_SEGMENT0_BASE , G_buffer1, FLASH_PAGE_SIZE) != 0) 
+    if ((re == FLASH_OK) && (W25Q32_WritePage(isSetHiSegment ? SEGMENT1_BASE : FLASH_SEGMENT0_BASE , G_buffer1, FLASH_PAGE_SIZE) != 0)) 
     {
         re = FLASH_ERROR_WRITE_FAIL;
     }
@@ -200,66 +255,60 @@ static flash_result_t resetSegment(boolean_t isSetHiSegment, const uint32_t stat
     return re;
 }
 
-static void readBlock(uint8_t blockAddress)
+/**
+ * @brief 扫描时每读到一个page的回调，建立映射表并查找第一个空page
+ * @note 在连续读过程中被调用（CS保持拉低），不能访问SPI
+ */
+static uint8_t scanPageCallback(uint32_t addr, uint8_t *buf, uint16_t len, void *ctx)
 {
-    uint16_t i = 0;
-    uint32_t addr = 0;
     uint8_t magic;
     uint8_t dataId;
 
-    for (i = 0;i<256;i++)
+    (void)len;
+    (void)ctx;
+    if ((addr == FLASH_SEGMENT0_BASE) || (addr == SEGMENT1_BASE))
     {
-        addr = 0;
-        addr |= (uint32_t) (i << 8u);
-        addr |= (uint32_t) (blockAddress << 16u);
-        if ((addr != FLASH_SEGMENT0_BASE) && (addr != FLASH_SEGMENT1_BASE))
+        return 0;
+    }
+
+    magic = buf[0];
+    if (magic == DATA_PAGE_MAGIC || magic == MAGIC_BW_IMAGE_HEADER || magic == MAGIC_RED_IMAGE_HEADER)
+    {
+        dataId = buf[1];
+        if (fmCtx.entriesCountMax[magic & 0x03] > dataId)
         {
-            // UARTIF_uartPrintf(0, "Read page addr 0x%06lx! \n",addr);
-            memset(G_buffer1, 0, 256);
-            if (W25Q32_ReadData(addr, G_buffer1, 256) == 0)
-            {
-            // delay1ms(1);
-                magic = G_buffer1[0];
-                if (magic == DATA_PAGE_MAGIC || magic == MAGIC_BW_IMAGE_HEADER || magic == MAGIC_RED_IMAGE_HEADER)
-                {
-                    dataId = G_buffer1[1];
-                    if (fmCtx.entriesCountMax[magic & 0x03] > dataId)
-                    {
-                        fmCtx.entries[magic & 0x03][dataId] = (uint16_t)(addr >> 8u);
-                    }
-                    else
-                    {
-                        /* 只打印一次警告，避免刷屏 */
-                        // UARTIF_uartPrintf(0, "WARN: dataId %d out of range (max=%d) at addr 0x%06lx magic=0x%02x\n", 
-                        //                  dataId, fmCtx.entriesCountMax[magic & 0x03], addr, magic);
-                    }
-                }
-                else if (magic == MAGIC_BW_IMAGE_DATA || magic == MAGIC_RED_IMAGE_DATA)
-                {
-                    // do nothing
-                }
-                else if (magic == 0xff)
-                {
-                    if ((G_buffer1[1] == 0xff) && (G_buffer1[3] == 0xff))
-                    {
-                        UARTIF_uartPrintf(0, "flash_manager found last block! \n");
-                    }
-                    else 
-                    {
-                        UARTIF_uartPrintf(0, "ERR: flash_manager 0x07! last block error\n");
-                    }
-                    fmCtx.nextWriteAddress = blockAddress << 8u;
-                    fmCtx.nextWriteAddress |= i;
-                    // UARTIF_uartPrintf(0, "flash_manager found next write address 0x%04x!!! \n", fmCtx.nextWriteAddress);
-                    break;
-                }
-                else
-                {
-                    UARTIF_uartPrintf(0, "ERR: flash_manager 0x06! unknow magic\n");
-                }
-            }
+            fmCtx.entries[magic & 0x03][dataId] = (uint16_t)(addr >> 8u);
+        }
+        else
+        {
+            /* 只打印一次警告，避免刷屏 */
+            // UARTIF_uartPrintf(0, "WARN: dataId %d out of range (max=%d) at addr 0x%06lx magic=0x%02x\n", 
+            //                  dataId, fmCtx.entriesCountMax[magic & 0x03], addr, magic);
+        }
+    }
+    else if (magic == MAGIC_BW_IMAGE_DATA || magic == MAGIC_RED_IMAGE_DATA)
+    {
+        // do nothing
+    }
+    else if (magic == 0xff)
+    {
+        if ((buf[1] == 0xff) && (buf[3] == 0xff))
+        {
+            LOG0(LOG_FM_LAST_BLOCK);
         }
+        else 
+        {
+            LOG0(LOG_FM_LAST_BLOCK_ERR);
+        }
+        fmCtx.nextWriteAddress = (uint16_t)(addr >> 8u);
+        // UARTIF_uartPrintf(0, "flash_manager found next write address 0x%04x!!! \n", fmCtx.nextWriteAddress);
+        return 1;
+    }
+    else
+    {
+        LOG2(LOG_FM_UNKNOWN_MAGIC, magic, addr);
     }
+    return 0;
 }
 
 // /**
@@ -276,19 +325,17 @@ static void readBlock(uint8_t blockAddress)
  */
 static flash_result_t scanSegmentPages(void)
 {
-    uint8_t endBlockAddr = 0x20;
-    uint8_t blockAddr = 0x00;
- 
-    // 从第1个page开始扫描（第0个是header）
-    blockAddr = (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE) ? 0x00 : 0x20;
-    endBlockAddr = blockAddr + 0x20;
-    for (; blockAddr < endBlockAddr; blockAddr++)
+    flash_result_t re = FLASH_OK;
+    uint32_t segmentBase;
+    uint32_t segmentEnd;
+
+    // 整个segment一次连续读完，遇到第一个空page时由回调结束读取
+    segmentBase = (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE) ? FLASH_SEGMENT0_BASE : SEGMENT1_BASE;
+    segmentEnd = (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE) ? SEGMENT1_BASE : SEGMENT1_END;
+    G_pageBufferLent = FALSE;
+    if (W25Q32_FastReadBurst(segmentBase, segmentEnd - segmentBase, G_buffer1, FLASH_PAGE_SIZE, scanPageCallback, NULL) != W25Q32_OK)
     {
-        readBlock(blockAddr);
-        if (fmCtx.nextWriteAddress != 0xffff)
-        {
-            break;
-        }
+        re = FLASH_ERROR_READ_FAIL;
     }
     if (fmCtx.nextWriteAddress == 0xffff)
     {
@@ -297,12 +344,16 @@ static flash_result_t scanSegmentPages(void)
     }
     else 
     {
-        UARTIF_uartPrintf(0, "flash_manager next write address is 0x%04x\n", fmCtx.nextWriteAddress);
+        LOG1(LOG_FM_NEXT_WRITE, fmCtx.nextWriteAddress);
     }
-    return FLASH_OK;
+    return re;
 }
 
-static flash_result_t scanImageDataPages(uint8_t magic, uint8_t slotId)
+/**
+ * @brief 从最新写入处向前扫描图层数据页，填入 G_imageAddressBuffer
+ * @param merge TRUE：增量更新，G_imageAddressBuffer 已是原图像地址表，只用新写入的帧覆盖，不要求61帧齐全
+ */
+static flash_result_t scanImageDataPages(uint8_t magic, uint8_t slotId, boolean_t merge)
 {
     uint32_t currentAddr = 0x00;
     uint32_t endAddr = 0x00;
@@ -311,9 +362,19 @@ static flash_result_t scanImageDataPages(uint8_t magic, uint8_t slotId)
     flash_result_t re = FLASH_OK;
     uint8_t pageMagic;
     uint8_t pageSlotId;
+    uint8_t found = 0;
+    boolean_t inTransfer;
 
+    G_pageBufferLent = FALSE;
     currentAddr = (uint32_t)((fmCtx.nextWriteAddress - 1) << 8u);
-    endAddr = (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE) ? FLASH_SEGMENT0_BASE : FLASH_SEGMENT1_BASE;
+    endAddr = (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE) ? FLASH_SEGMENT0_BASE : SEGMENT1_BASE;
+
+    // 续传的图层中间可能夹有其他page，只扫描到传输起点，并跳过不属于本图层的page
+    inTransfer = (fmCtx.transferBase != NO_TRANSFER && fmCtx.transferMagic == magic && fmCtx.transferSlot == slotId) ? TRUE : FALSE;
+    if (inTransfer)
+    {
+        endAddr = (uint32_t)(fmCtx.transferBase - 1u) << 8u;
+    }
     for (; currentAddr > endAddr; currentAddr -= FLASH_PAGE_SIZE)
     {
         memset(G_buffer1, 0, 256);
@@ -322,9 +383,13 @@ static flash_result_t scanImageDataPages(uint8_t magic, uint8_t slotId)
             pageMagic = G_buffer1[0];
             pageSlotId = G_buffer1[2];
             
-            // 只要 magic 或 slotId 不匹配，立即停止扫描
+            // 只要 magic 或 slotId 不匹配，立即停止扫描（续传中的图层跳过该page）
             if (pageMagic != magic || pageSlotId != slotId)
             {
+                if (inTransfer)
+                {
+                    continue;
+                }
                 break;
             }
             
@@ -337,12 +402,12 @@ static flash_result_t scanImageDataPages(uint8_t magic, uint8_t slotId)
  
             if (frameNum > MAX_FRAME_NUM)
             {
-                UARTIF_uartPrintf(0, "ERR: flash_manager 0x09! image frame num out of range: %d\n", frameNum);
+                LOG1(LOG_FM_FRAME_RANGE, frameNum);
                 re = FLASH_ERROR_IMAGE_FRAME_LOST;
                 break;
             }
             G_imageAddressBuffer[frameNum] = (uint16_t)((currentAddr & 0x00ffff00) >> 8u);
-
+            found++;
 
             frameIsFull |= ((uint64_t)1u << frameNum);
             if (frameIsFull == 0x1FFFFFFFFFFFFFFF)
@@ -352,17 +417,40 @@ static flash_result_t scanImageDataPages(uint8_t magic, uint8_t slotId)
             }
         }
     }
-    if (re == FLASH_OK)
+    if (re == FLASH_OK && merge)
+    {
+        LOG3(LOG_FM_IMAGE_DELTA, magic, slotId, found);
+    }
+    else if (re == FLASH_OK)
     {
         if (frameIsFull != 0x1FFFFFFFFFFFFFFF)
         {
-            UARTIF_uartPrintf(0, "ERR: scanImageDataPages frame lost\r\n");
+            LOG0(LOG_FM_FRAME_LOST);
             re = FLASH_ERROR_IMAGE_FRAME_LOST;
         }
     }
     return re;
 }
 
+/**
+ * @brief 计算激活segment中从nextWriteAddress到segment末尾的空闲page数
+ */
+static uint16_t getFreePagesInActiveSegment(void)
+{
+    uint16_t endPage;
+
+    if (fmCtx.nextWriteAddress == 0xffff)
+    {
+        return 0u;
+    }
+    endPage = (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE) ? (uint16_t)(SEGMENT1_BASE >> 8u) : (uint16_t)(SEGMENT1_END >> 8u);
+    if (fmCtx.nextWriteAddress >= endPage)
+    {
+        return 0u;
+    }
+    return (uint16_t)(endPage - fmCtx.nextWriteAddress);
+}
+
 static flash_result_t checkAndDoGarbageCollection(void)
 {
     flash_result_t re = FLASH_OK;
@@ -371,26 +459,26 @@ static flash_result_t checkAndDoGarbageCollection(void)
     {
         // UARTIF_uartPrintf(0, "go to gc 0\n");
         // re = garbageCollect();
-        UARTIF_uartPrintf(0, "Gc on going! \n");
+        LOG0(LOG_FM_GC_ONGOING);
     }
     else 
     {
         if (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE)
         {
-            if (nextWriteAddress >= FLASH_SEGMENT1_BASE)
+            if (nextWriteAddress >= SEGMENT1_BASE)
             {
                 fmCtx.gcInProgress = 1;
-                UARTIF_uartPrintf(0, "go to gc 1\n");
+                LOG1(LOG_FM_GO_GC, 1u);
 
                 re = garbageCollect();
             }
         }
         else 
         {
-            if (nextWriteAddress >= FLASH_TOTAL_SIZE)
+            if (nextWriteAddress >= SEGMENT1_END)
             {
                 fmCtx.gcInProgress = 1;
-                UARTIF_uartPrintf(0, "go to gc 2\n");
+                LOG1(LOG_FM_GO_GC, 2u);
 
                 re = garbageCollect();
             }
@@ -400,25 +488,231 @@ static flash_result_t checkAndDoGarbageCollection(void)
 }
 
 /**
- * @brief 擦除整个segment
+ * @brief 连续读回调：遇到非 0xFF 字节立即结束
  */
-static flash_result_t eraseSegment(boolean_t eraseHiSegment)
+static uint8_t blankCheckCallback(uint32_t addr, uint8_t *buf, uint16_t len, void *ctx)
+{
+    uint16_t i;
+
+    (void)addr;
+    for (i = 0; i < len; i++)
+    {
+        if (buf[i] != 0xff)
+        {
+            *(boolean_t *)ctx = FALSE;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 检查sector是否为空
+ * @note 读整个sector：掉电时擦除或编程到一半的sector首page可能仍为空，只看page头会漏掉
+ */
+static boolean_t isSectorBlank(uint32_t sectorAddr)
+{
+    uint8_t buf[32];
+    boolean_t blank = TRUE;
+
+    if (W25Q32_FastReadBurst(sectorAddr, FLASH_SECTOR_SIZE, buf, sizeof(buf), blankCheckCallback, &blank) != W25Q32_OK)
+    {
+        return FALSE;
+    }
+    return blank;
+}
+
+/**
+ * @brief 由器件擦除类型（SFDP）建立擦除规划表
+ * @note 只使用 4KB~64KB 的2的幂粒度（规划单元内的脏sector用位图表示），按大小升序；没有 4KB 擦除时补上 0x20
+ */
+static void loadEraseKinds(erase_plan_t *p)
+{
+    const w25q32_geometry_t *geo = W25Q32_GetGeometry();
+    w25q32_erase_type_t t;
+    uint8_t i, j, n;
+
+    p->count = 0;
+    for (i = 0; i < W25Q32_MAX_ERASE_TYPES; i++)
+    {
+        t = geo->erase[i];
+        if ((t.opcode == 0u) || (t.size < FLASH_SECTOR_SIZE) || (t.size > FLASH_BLOCK_SIZE) || (t.size & (t.size - 1u)))
+        {
+            continue;
+        }
+        j = 0;
+        while ((j < p->count) && (p->kind[j].size < t.size))
+        {
+            j++;
+        }
+        if ((j < p->count) && (p->kind[j].size == t.size))
+        {
+            continue;
+        }
+        for (n = p->count; n > j; n--)
+        {
+            p->kind[n] = p->kind[n - 1u];
+        }
+        p->kind[j] = t;
+        p->count++;
+    }
+    if ((p->count == 0u) || (p->kind[0].size != FLASH_SECTOR_SIZE))
+    {
+        // 表满时丢掉最大的粒度
+        if (p->count < W25Q32_MAX_ERASE_TYPES)
+        {
+            p->count++;
+        }
+        for (n = (uint8_t)(p->count - 1u); n > 0u; n--)
+        {
+            p->kind[n] = p->kind[n - 1u];
+        }
+        p->kind[0].size = FLASH_SECTOR_SIZE;
+        p->kind[0].opcode = W25Q32_CMD_SECTOR_ERASE;
+    }
+    for (i = 0; i < p->count; i++)
+    {
+        p->cost[i] = W25Q32_GetExpectedTime(W25Q32_EraseOpForSize(p->kind[i].size));
+    }
+}
+
+/**
+ * @brief 规划（并可执行）一个区域的擦除
+ * @param k 区域大小为 p->kind[k].size，地址 addr 按此对齐，位于 p->unitAddr 开始的规划单元内
+ * @param execute FALSE 只计算耗时，TRUE 按规划从高地址到低地址执行擦除
+ * @return 预计耗时（100us），区域内全部为空时为0
+ * @note 整区擦除要求区域完全在擦除范围内，否则拆成下一级粒度；范围外的sector不会被擦除
+ */
+static uint32_t planErase(erase_plan_t *p, uint8_t k, uint32_t addr, boolean_t execute)
+{
+    uint32_t size = p->kind[k].size;
+    uint32_t sectors = size / FLASH_SECTOR_SIZE;
+    uint32_t bits = (((uint32_t)1u << sectors) - 1u) << ((addr - p->unitAddr) / FLASH_SECTOR_SIZE);
+    uint32_t sub = 0;
+    uint32_t subSize;
+    uint32_t a;
+
+    if ((p->dirtyMask & bits) == 0u)
+    {
+        return 0;
+    }
+    if (k == 0u)
+    {
+        // 只有范围内的sector会被标记为脏
+        if (execute && (p->result == FLASH_OK) && (W25Q32_EraseBlock(&p->kind[0], addr) != W25Q32_OK))
+        {
+            p->result = FLASH_ERROR_ERASE_FAIL;
+        }
+        return p->cost[0];
+    }
+
+    subSize = p->kind[k - 1u].size;
+    for (a = addr; a < addr + size; a += subSize)
+    {
+        sub += planErase(p, (uint8_t)(k - 1u), a, FALSE);
+    }
+    if ((addr >= p->startAddr) && (addr + size <= p->endAddr) && (p->cost[k] < sub))
+    {
+        if (execute && (p->result == FLASH_OK) && (W25Q32_EraseBlock(&p->kind[k], addr) != W25Q32_OK))
+        {
+            p->result = FLASH_ERROR_ERASE_FAIL;
+        }
+        return p->cost[k];
+    }
+    if (execute)
+    {
+        for (a = addr + size; a > addr; a -= subSize)
+        {
+            (void)planErase(p, (uint8_t)(k - 1u), a - subSize, TRUE);
+        }
+    }
+    return sub;
+}
+
+/**
+ * @brief 规划（并可执行）一个规划单元（最大擦除粒度）内的擦除
+ * @return 预计耗时（100us），单元内全部为空时为0
+ */
+static uint32_t planUnitErase(erase_plan_t *p, uint32_t unitAddr, boolean_t execute)
+{
+    uint32_t addr;
+    uint8_t i;
+    uint8_t top = (uint8_t)(p->count - 1u);
+
+    p->unitAddr = unitAddr;
+    p->dirtyMask = 0;
+    for (i = 0; i < p->kind[top].size / FLASH_SECTOR_SIZE; i++)
+    {
+        addr = unitAddr + (uint32_t)i * FLASH_SECTOR_SIZE;
+        if ((addr >= p->startAddr) && (addr < p->endAddr) && !isSectorBlank(addr))
+        {
+            p->dirtyMask |= (uint32_t)1u << i;
+        }
+    }
+    return planErase(p, top, unitAddr, execute);
+}
+
+/**
+ * @brief 擦除地址范围：跳过已为空的sector，按预计耗时最小选择 整片/器件支持的各级块擦除 组合
+ * @param startAddr 起始地址（4KB对齐）
+ * @param endAddr 结束地址（不含），向上对齐到4KB
+ * @return 任何一次擦除失败返回 FLASH_ERROR_ERASE_FAIL（之后的擦除不再执行）
+ * @note 从高地址向低地址擦除，segment头所在的首sector最后擦除
+ */
+static flash_result_t eraseRange(uint32_t startAddr, uint32_t endAddr)
 {
-    uint32_t sectorAddress = 0x00;
-    uint32_t i;
-    uint8_t startAddr = 0;
+    erase_plan_t plan;
+    uint32_t unitAddr;
+    uint32_t unitSize;
+    uint32_t total = 0;
+    uint32_t chipSize = W25Q32_GetGeometry()->totalSize;
+
+    endAddr = (endAddr + FLASH_SECTOR_SIZE - 1u) & ~(FLASH_SECTOR_SIZE - 1u);
+    if ((startAddr & (FLASH_SECTOR_SIZE - 1u)) || (startAddr >= endAddr) || (endAddr > chipSize))
+    {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    loadEraseKinds(&plan);
+    plan.startAddr = startAddr;
+    plan.endAddr = endAddr;
+    plan.result = FLASH_OK;
+    unitSize = plan.kind[plan.count - 1u].size;
 
-    // 按扇区擦除整个segment
-    startAddr = (eraseHiSegment) ? 0x20 : 0x00;
+    // 覆盖整片时先估算分块擦除的总耗时，与整片擦除比较
+    if ((startAddr == 0u) && (endAddr == chipSize))
+    {
+        for (unitAddr = 0; unitAddr < endAddr; unitAddr += unitSize)
+        {
+            total += planUnitErase(&plan, unitAddr, FALSE);
+        }
+        if (W25Q32_GetExpectedTime(W25Q32_OP_ERASE_CHIP) < total)
+        {
+            LOG1(LOG_FM_CHIP_ERASE, total);
+            return (W25Q32_EraseChip() == W25Q32_OK) ? FLASH_OK : FLASH_ERROR_ERASE_FAIL;
+        }
+    }
 
-    UARTIF_uartPrintf(0, "flash_manager: start to erase block 0x%02x to 0x%02x! \n", startAddr, startAddr + 0x1f);
-    for (i = startAddr; i < (startAddr + 0x1f); i++) 
+    LOG2(LOG_FM_ERASE_RANGE, startAddr, endAddr);
+    unitAddr = (endAddr - 1u) & ~(unitSize - 1u);
+    while (plan.result == FLASH_OK)
     {
-        sectorAddress = 0x00;
-        sectorAddress |= i << 16;
-        W25Q32_Erase64k(sectorAddress);
+        (void)planUnitErase(&plan, unitAddr, TRUE);
+        if (unitAddr <= (startAddr & ~(unitSize - 1u)))
+        {
+            break;
+        }
+        unitAddr -= unitSize;
     }
-    return FLASH_OK;
+    return plan.result;
+}
+
+/**
+ * @brief 擦除整个segment
+ */
+static flash_result_t eraseSegment(boolean_t eraseHiSegment)
+{
+    return eraseHiSegment ? eraseRange(SEGMENT1_BASE, SEGMENT1_END) : eraseRange(FLASH_SEGMENT0_BASE, SEGMENT1_BASE);
 }
 
 static flash_result_t readImageHeaderIntoBuffer(uint8_t magic, uint8_t slotId)
@@ -428,7 +722,7 @@ static flash_result_t readImageHeaderIntoBuffer(uint8_t magic, uint8_t slotId)
     /* Read addresses plus one-byte color flag (if present).
      * FM_readData returns FLASH_OK only if the page exists and CRC matches.
      */
-    memset(G_buffer2, 0xff, FLASH_PAGE_SIZE);
+    memset(G_buffer2, 0xff, sizeof(G_buffer2));
     result = FM_readData(magic, slotId, G_buffer2, (MAX_FRAME_NUM + 1) * 2);
     
     if (result != FLASH_OK)
@@ -452,6 +746,7 @@ static flash_result_t copyPage(uint16_t srcAddr, uint16_t destAddr, boolean_t is
     uint32_t destAddress = 0;
     flash_result_t result = FLASH_OK;
 
+    G_pageBufferLent = FALSE;
     srcAddress |= (uint32_t) (srcAddr << 8u);
 
     if (isDestNext)
@@ -500,7 +795,7 @@ static flash_result_t copyValidPages(void)
             result = copyPage(fmCtx.dataEntries[i], 0, TRUE);
             if (result != FLASH_OK)
             {
-                UARTIF_uartPrintf(0, "ERR: flash_manager 0x10! copy data page fail entry %d\n", i);
+                LOG1(LOG_FM_COPY_DATA_FAIL, i);
                 // 删除映射表中的地址
                 fmCtx.dataEntries[i] = 0xffff;
             }
@@ -525,7 +820,7 @@ static flash_result_t copyValidPages(void)
                 if (result != FLASH_OK)
                 {
                     // 删除映射表中的地址
-                    UARTIF_uartPrintf(0, "ERR: flash_manager 0x10! read image header into buffer fail\n");
+                    LOG0(LOG_FM_COPY_HEADER_FAIL);
                     fmCtx.entries[k][i] = 0xffff;
                     continue;
                 }
@@ -541,7 +836,7 @@ static flash_result_t copyValidPages(void)
                     }
                     else
                     {
-                        UARTIF_uartPrintf(0, "ERR: flash_manager 0x10! copy image data page fail entry %d frame %d\n", i, j);
+                        LOG2(LOG_FM_COPY_IMAGE_FAIL, i, j);
                         break;
                     }
                 }
@@ -562,14 +857,72 @@ static flash_result_t copyValidPages(void)
     return result;
 }
 
+/**
+ * @brief 是否为已写入的数据页/图像页magic
+ */
+static boolean_t isUsedPageMagic(uint8_t magic)
+{
+    return (magic == DATA_PAGE_MAGIC ||
+            magic == MAGIC_BW_IMAGE_DATA ||
+            magic == MAGIC_RED_IMAGE_DATA ||
+            magic == MAGIC_BW_IMAGE_HEADER ||
+            magic == MAGIC_RED_IMAGE_HEADER) ? TRUE : FALSE;
+}
+
+/**
+ * @brief 续传扫描回调：记录传输起点之后本图层已写入且CRC正确的帧
+ * @note 断电时正在编程的page可能不完整，CRC错误的帧按未收到处理
+ */
+static uint8_t transferScanCallback(uint32_t addr, uint8_t *buf, uint16_t len, void *ctx)
+{
+    transfer_scan_t *scan = (transfer_scan_t *)ctx;
+    uint32_t storedCrc;
+
+    (void)addr;
+    (void)len;
+    if (buf[0] == scan->magic && buf[2] == scan->slotId && buf[1] <= MAX_FRAME_NUM && buf[3] == PAYLOAD_SIZE)
+    {
+        storedCrc = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) |
+                    ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+        if (calculate_crc32_default(&buf[8], PAYLOAD_SIZE) == storedCrc)
+        {
+            scan->received |= ((uint64_t)1u << buf[1]);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 根据器件容量确定两个segment的范围
+ * @note page索引为uint16且0xFFFF为无效值，管理范围不超过 FLASH_MAX_MANAGED_END
+ */
+static void initGeometry(void)
+{
+    uint32_t managedSize;
+
+    if (W25Q32_ProbeGeometry() != W25Q32_OK)
+    {
+        LOG0(LOG_FM_UNKNOWN_FLASH);
+    }
+    managedSize = W25Q32_GetGeometry()->totalSize;
+    if (managedSize > FLASH_MAX_MANAGED_SIZE)
+    {
+        managedSize = FLASH_MAX_MANAGED_SIZE;
+    }
+    fmCtx.segmentSize = managedSize / FLASH_SEGMENT_COUNT;
+    fmCtx.segment1End = (managedSize > FLASH_MAX_MANAGED_END) ? FLASH_MAX_MANAGED_END : managedSize;
+    LOG3(LOG_FM_GEOMETRY, W25Q32_GetGeometry()->jedecId, W25Q32_GetGeometry()->totalSize, fmCtx.segmentSize);
+}
+
 static flash_result_t judgeWhichSegmentIsActive(void)
 {
     flash_result_t result = FLASH_OK;
     uint8_t sg0Tail, sg1Tail;
 
+    G_pageBufferLent = FALSE;
     memset(G_buffer1, 0, 256);
 
-    if (W25Q32_ReadData(FLASH_SEGMENT1_BASE - 0x100, G_buffer1, sizeof(segment_header_t)) != 0) 
+    if (W25Q32_ReadData(SEGMENT1_BASE - 0x100, G_buffer1, sizeof(segment_header_t)) != 0) 
     {
         result = FLASH_ERROR_READ_FAIL;
     }
@@ -582,7 +935,7 @@ static flash_result_t judgeWhichSegmentIsActive(void)
     {
         memset(G_buffer1, 0, 256);
 
-        if (W25Q32_ReadData(FLASH_TOTAL_SIZE - 0x100, G_buffer1, sizeof(segment_header_t)) != 0) 
+        if (W25Q32_ReadData(SEGMENT1_END - 0x100, G_buffer1, sizeof(segment_header_t)) != 0) 
         {
             result = FLASH_ERROR_READ_FAIL;
         }
@@ -594,44 +947,26 @@ static flash_result_t judgeWhichSegmentIsActive(void)
 
     if (result == FLASH_OK)
     {
-        if ((sg0Tail == DATA_PAGE_MAGIC ||
-            sg0Tail == MAGIC_BW_IMAGE_DATA ||
-            sg0Tail == MAGIC_RED_IMAGE_DATA ||
-            sg0Tail == MAGIC_BW_IMAGE_HEADER ||
-            sg0Tail == MAGIC_RED_IMAGE_HEADER) && 
-            (sg1Tail != DATA_PAGE_MAGIC ||
-            sg1Tail != MAGIC_BW_IMAGE_DATA ||
-            sg1Tail != MAGIC_RED_IMAGE_DATA ||
-            sg1Tail != MAGIC_BW_IMAGE_HEADER ||
-            sg1Tail != MAGIC_RED_IMAGE_HEADER))
+        if (isUsedPageMagic(sg0Tail) && !isUsedPageMagic(sg1Tail))
         {
             fmCtx.activeSegmentBaseStatus = MAGIC_LOW_ACTIVE;
-            UARTIF_uartPrintf(0, "regc flash_manager low active\n");
-        }
-        else if ((sg1Tail == DATA_PAGE_MAGIC ||
-            sg1Tail == MAGIC_BW_IMAGE_DATA ||
-            sg1Tail == MAGIC_RED_IMAGE_DATA ||
-            sg1Tail == MAGIC_BW_IMAGE_HEADER ||
-            sg1Tail == MAGIC_RED_IMAGE_HEADER) && 
-            (sg0Tail != DATA_PAGE_MAGIC ||
-            sg0Tail != MAGIC_BW_IMAGE_DATA ||
-            sg0Tail != MAGIC_RED_IMAGE_DATA ||
-            sg0Tail != MAGIC_BW_IMAGE_HEADER ||
-            sg0Tail != MAGIC_RED_IMAGE_HEADER))
+            LOG0(LOG_FM_REGC_LOW);
+        }
+        else if (isUsedPageMagic(sg1Tail) && !isUsedPageMagic(sg0Tail))
         {
             fmCtx.activeSegmentBaseStatus = MAGIC_HIGH_ACTIVE;
-            UARTIF_uartPrintf(0, "regc flash_manager high active\n");
+            LOG0(LOG_FM_REGC_HIGH);
         }
         else if (sg0Tail == 0xff && sg1Tail == 0xff)
         {
             // to do: scan all pages to find last write page
             // if not found, reset 2 segments
-            UARTIF_uartPrintf(0, "flash_manager no active segment, reset 2 segments\n");
+            LOG0(LOG_FM_REGC_RESET);
             result = FLASH_ERROR_INIT_FAIL;
         }
         else
         {
-            UARTIF_uartPrintf(0, "ERR: flash_manager 0x09! regc error, reset 2 segments\n");
+            LOG0(LOG_FM_REGC_ERR);
             result = FLASH_ERROR_INIT_FAIL;
         }
     }
@@ -673,74 +1008,157 @@ static flash_result_t checkArguments(uint8_t magic, uint16_t dataId, const uint8
 }
 
 /**
- * @brief 执行垃圾回收
+ * @brief 是否为内部保留的数据条目（可续传传输记录），外部接口不允许读写
  */
-static flash_result_t garbageCollect(void)
+static boolean_t isReservedDataId(uint8_t magic, uint16_t dataId)
+{
+    return (magic == DATA_PAGE_MAGIC && dataId >= FM_USER_DATA_ENTRIES) ? TRUE : FALSE;
+}
+
+/**
+ * @brief 把 G_buffer1 写入下一个空闲page
+ * @note 数据区（偏移 8）已由调用方填好，这里补齐page头并更新映射表
+ */
+static flash_result_t programPageBuffer(uint8_t magic, uint16_t dataId, uint16_t size)
 {
-    uint8_t i, k;
     flash_result_t result = FLASH_OK;
-    UARTIF_uartPrintf(0, "flash_manager start garbage collecting! \n");
+    uint32_t crc32;
+    uint32_t nextWriteAddress = 0;
 
-    fmCtx.currentGcCounter ++;
-    // 1. 将备用segment标记为激活
-    if (result == FLASH_OK)
-    {
-        UARTIF_uartPrintf(0, "flash_manager garbage collecting step one \n");
-        result = resetSegment((fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE), SEGMENT_MAGIC_ACTIVE, fmCtx.currentGcCounter);
-        fmCtx.nextWriteAddress = (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE) ? 0x2001 : 0x0001;
-    }
+    nextWriteAddress |= (uint32_t) (fmCtx.nextWriteAddress << 8u);
 
-    // 2. 复制有效数据
-    if (result == FLASH_OK)
-    {
-        UARTIF_uartPrintf(0, "flash_manager garbage collecting step two \n");
-        result = copyValidPages();
-    }
-    
-    // 3. 将原激活segment标记为备用
-    if (result == FLASH_OK)
+    if (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE)
     {
-        UARTIF_uartPrintf(0, "flash_manager garbage collecting step three \n");
-        if (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE)
+        if (nextWriteAddress >= SEGMENT1_BASE)
         {
-            fmCtx.activeSegmentBaseStatus = MAGIC_HIGH_ACTIVE;
-        }
-        else 
-        {
-            fmCtx.activeSegmentBaseStatus = MAGIC_LOW_ACTIVE;
+            result = FLASH_ERROR_NO_SPACE;
         }
-        result = resetSegment((fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE), SEGMENT_MAGIC_BACKUP, 0);
     }
-    
-    // 4. Update image header if needed
-    for (k = 1; k < 3; k++)
+    else 
     {
-        for (i = 0; i < MAX_IMAGE_ENTRIES; i++) 
+        if (nextWriteAddress >= SEGMENT1_END || nextWriteAddress < SEGMENT1_BASE)
         {
-            if (fmCtx.entries[k][i] != 0xffff)
-            {
-                result = FM_writeImageHeader(DATA_PAGE_MAGIC + k, i);
-                if (result != FLASH_OK)
-                {
-                    UARTIF_uartPrintf(0, "ERR: flash_manager 0x08! write image header fail entry %d, type %d\n", i, k);
-                }
-            }
+            result = FLASH_ERROR_NO_SPACE;
         }
     }
-
-    if (result == FLASH_OK)
+    if (nextWriteAddress == (FLASH_SEGMENT0_BASE) || nextWriteAddress == (SEGMENT1_BASE))
     {
-        UARTIF_uartPrintf(0, "flash_manager garbage collecting finished successfully! \n");
-
-        fmCtx.gcInProgress = 0;
+        result = FLASH_ERROR_INVALID_PARAM;
     }
-    else
+
+    if (result == FLASH_OK)
     {
-        UARTIF_uartPrintf(0, "ERR: flash_manager 0x08! gc error: %d\n", result);
-    }
+        // 填写数据页头
+        G_buffer1[0] = magic; // 魔法数字
+        G_buffer1[1] = (uint8_t)(dataId & 0xFF); // if image data, this byte is frameNum
+        G_buffer1[2] = (uint8_t)((dataId >> 8) & 0xFF); // if image data, this byte is slotId
+        G_buffer1[3] = size;
     
-    return result;
-}
+        // 计算CRC32（只计算数据部分）
+        crc32 = calculate_crc32_default(&G_buffer1[8], size);
+        G_buffer1[4] = (uint8_t)(crc32 & 0xFF);
+        G_buffer1[5] = (uint8_t)((crc32 >> 8) & 0xFF);
+        G_buffer1[6] = (uint8_t)((crc32 >> 16) & 0xFF);
+        G_buffer1[7] = (uint8_t)((crc32 >> 24) & 0xFF);
+
+        // 写入Flash
+        if (W25Q32_WritePage(nextWriteAddress, G_buffer1, FLASH_PAGE_SIZE) != 0)
+        {
+            result = FLASH_ERROR_WRITE_FAIL;
+        }
+    }
+    // 更新映射表
+    if (result == FLASH_OK)
+    {
+        if (magic == DATA_PAGE_MAGIC || magic == MAGIC_BW_IMAGE_HEADER || magic == MAGIC_RED_IMAGE_HEADER)
+        {
+            fmCtx.entries[magic & 0x03][dataId] = fmCtx.nextWriteAddress;
+        }
+        else if (magic == MAGIC_BW_IMAGE_DATA || magic == MAGIC_RED_IMAGE_DATA)
+        {
+            // Image data written
+        }
+        else
+        {
+            result = FLASH_ERROR_INVALID_PARAM;
+        }
+        fmCtx.nextWriteAddress++;
+    }
+
+    return result;
+}
+
+/**
+ * @brief 执行垃圾回收
+ */
+static flash_result_t garbageCollect(void)
+{
+    uint8_t i, k;
+    flash_result_t result = FLASH_OK;
+    LOG0(LOG_FM_GC_START);
+
+    // 未完成的图层数据页不会被复制，进行中的传输失效
+    fmCtx.transferBase = NO_TRANSFER;
+    fmCtx.currentGcCounter ++;
+    // 1. 将备用segment标记为激活
+    if (result == FLASH_OK)
+    {
+        LOG1(LOG_FM_GC_STEP, 1u);
+        result = resetSegment((fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE), SEGMENT_MAGIC_ACTIVE, fmCtx.currentGcCounter, TRUE);
+        fmCtx.nextWriteAddress = (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE) ? SEGMENT1_FIRST_PAGE : SEGMENT0_FIRST_PAGE;
+    }
+
+    // 2. 复制有效数据
+    if (result == FLASH_OK)
+    {
+        LOG1(LOG_FM_GC_STEP, 2u);
+        result = copyValidPages();
+    }
+    
+    // 3. 将原激活segment标记为备用
+    if (result == FLASH_OK)
+    {
+        LOG1(LOG_FM_GC_STEP, 3u);
+        if (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE)
+        {
+            fmCtx.activeSegmentBaseStatus = MAGIC_HIGH_ACTIVE;
+        }
+        else 
+        {
+            fmCtx.activeSegmentBaseStatus = MAGIC_LOW_ACTIVE;
+        }
+        result = resetSegment((fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE), SEGMENT_MAGIC_BACKUP, 0, TRUE);
+    }
+    
+    // 4. Update image header if needed
+    for (k = 1; k < 3; k++)
+    {
+        for (i = 0; i < MAX_IMAGE_ENTRIES; i++) 
+        {
+            if (fmCtx.entries[k][i] != 0xffff)
+            {
+                result = FM_writeImageHeader(DATA_PAGE_MAGIC + k, i);
+                if (result != FLASH_OK)
+                {
+                    LOG2(LOG_FM_GC_HEADER_FAIL, i, k);
+                }
+            }
+        }
+    }
+
+    if (result == FLASH_OK)
+    {
+        LOG0(LOG_FM_GC_DONE);
+
+        fmCtx.gcInProgress = 0;
+    }
+    else
+    {
+        LOG1(LOG_FM_GC_ERR, result);
+    }
+    
+    return result;
+}
 
 
 
@@ -761,6 +1179,8 @@ flash_result_t FM_init()
     memset(fmCtx.imageBwEntries, 0xff, sizeof(uint16_t) * MAX_IMAGE_ENTRIES);
     memset(fmCtx.imageRedEntries, 0xff, sizeof(uint16_t) * MAX_IMAGE_ENTRIES);
     fmCtx.nextWriteAddress = 0xffff;
+    fmCtx.transferBase = NO_TRANSFER;
+    initGeometry();
 
     fmCtx.entries[0] = fmCtx.dataEntries;
     fmCtx.entries[1] = fmCtx.imageBwEntries;
@@ -777,14 +1197,14 @@ flash_result_t FM_init()
         result = readSegmentHeader(FLASH_SEGMENT0_BASE, FALSE);
         if (result == FLASH_ERROR_READ_FAIL)
         {
-            UARTIF_uartPrintf(0, "ERR: flash_manager 0x04! header0 error\n");
+            LOG1(LOG_FM_HEADER_ERR, 0u);
         }
         else
         {
-            result = readSegmentHeader(FLASH_SEGMENT1_BASE, TRUE);
+            result = readSegmentHeader(SEGMENT1_BASE, TRUE);
             if (result == FLASH_ERROR_READ_FAIL)
             {
-                UARTIF_uartPrintf(0, "ERR: flash_manager 0x04! header1 error\n");
+                LOG1(LOG_FM_HEADER_ERR, 1u);
             }
             else
             {
@@ -813,7 +1233,7 @@ flash_result_t FM_init()
             {
                 // 正常情况：segment0激活，segment1备用
                 fmCtx.activeSegmentBaseStatus = MAGIC_LOW_ACTIVE;
-                UARTIF_uartPrintf(0, "flash_manager low active\n");
+                LOG0(LOG_FM_LOW_ACTIVE);
                 needToInitList = TRUE;
                 fmCtx.currentGcCounter = fmCtx.header0.gcCounter;
             } 
@@ -821,7 +1241,7 @@ flash_result_t FM_init()
             {
                 // segment1激活，segment0备用
                 fmCtx.activeSegmentBaseStatus = MAGIC_HIGH_ACTIVE;
-                UARTIF_uartPrintf(0, "flash_manager high active\n");
+                LOG0(LOG_FM_HIGH_ACTIVE);
                 needToInitList = TRUE;
                 fmCtx.currentGcCounter = fmCtx.header1.gcCounter;
             } 
@@ -830,7 +1250,7 @@ flash_result_t FM_init()
                 // 垃圾回收中断，需要恢复
                 // TO DO：
                 fmCtx.gcInProgress = 1;
-                UARTIF_uartPrintf(0, "flash_manager GC redo! \n");
+                LOG0(LOG_FM_GC_REDO);
                 result = judgeWhichSegmentIsActive();
                 if (result != FLASH_OK) {
                     resetSegments(TRUE, TRUE, SEGMENT_MAGIC_ACTIVE, SEGMENT_MAGIC_BACKUP, &result);
@@ -842,10 +1262,10 @@ flash_result_t FM_init()
             } 
             else
             {
-                UARTIF_uartPrintf(0, "flash_manager start to init sg 0 else! \n");
+                LOG0(LOG_FM_INIT_SG0);
                 // segment1激活，segment0备用
                 resetSegments(TRUE, FALSE, SEGMENT_MAGIC_ACTIVE, 0, &result);
-                UARTIF_uartPrintf(0, "flash_manager low active\n");
+                LOG0(LOG_FM_LOW_ACTIVE);
             }
         }
     }
@@ -862,11 +1282,11 @@ flash_result_t FM_init()
         {
             if (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE)
             {
-                fmCtx.nextWriteAddress = 0x0001;
+                fmCtx.nextWriteAddress = SEGMENT0_FIRST_PAGE;
             }
             else 
             {
-                fmCtx.nextWriteAddress = 0x2001;
+                fmCtx.nextWriteAddress = SEGMENT1_FIRST_PAGE;
             }
             fmCtx.gcInProgress = 0;
         }
@@ -885,101 +1305,79 @@ flash_result_t FM_init()
  * @brief 写入数据
  */
 flash_result_t FM_writeData(uint8_t magic, uint16_t dataId, const uint8_t* data, uint16_t size)
+{
+    flash_result_t result = FLASH_ERROR_INVALID_PARAM;
+
+    if (!isReservedDataId(magic, dataId))
+    {
+        result = writeData(magic, dataId, data, size);
+    }
+    return result;
+}
+
+/**
+ * @brief 写入数据（内部使用，可写保留条目）
+ */
+static flash_result_t writeData(uint8_t magic, uint16_t dataId, const uint8_t* data, uint16_t size)
 {
     flash_result_t result = FLASH_OK;
-    uint32_t crc32;
-    uint32_t nextWriteAddress = 0;
-    // uint8_t slotId;
 
     // 检查是否需要垃圾回收
     result = checkArguments(magic, dataId, data, size);
     if (result == FLASH_OK)
     {
         result = checkAndDoGarbageCollection();
-        nextWriteAddress |= (uint32_t) (fmCtx.nextWriteAddress << 8u);
-
-        if (fmCtx.activeSegmentBaseStatus == MAGIC_LOW_ACTIVE)
-        {
-            if (nextWriteAddress >= FLASH_SEGMENT1_BASE)
-            {
-                result = FLASH_ERROR_NO_SPACE;
-            }
-        }
-        else 
-        {
-            if (nextWriteAddress >= FLASH_TOTAL_SIZE || nextWriteAddress < FLASH_SEGMENT1_BASE)
-            {
-                result = FLASH_ERROR_NO_SPACE;
-            }
-        }
-        if (nextWriteAddress == (FLASH_SEGMENT0_BASE) || nextWriteAddress == (FLASH_SEGMENT1_BASE))
-        {
-            result = FLASH_ERROR_INVALID_PARAM;
-        }
-    }
-    else
-    {
-        result = FLASH_ERROR_INVALID_PARAM;
     }
 
     if (result == FLASH_OK)
     {
-        // 清空缓冲区
+        // 清空缓冲区，数据复制到数据区
+        G_pageBufferLent = FALSE;
         memset(G_buffer1, 0, FLASH_PAGE_SIZE);
-
-        // 将数据页字段复制到缓冲区
-        G_buffer1[0] = magic; // 魔法数字
-        G_buffer1[1] = (uint8_t)(dataId & 0xFF); // if image data, this byte is frameNum
-        // slotId = G_buffer1[2] = (uint8_t)((dataId >> 8) & 0xFF); // if image data, this byte is slotId
-        G_buffer1[2] = (uint8_t)((dataId >> 8) & 0xFF); // if image data, this byte is slotId
-        G_buffer1[3] = size;
-    
-        // 计算CRC32（只计算数据部分）
-        crc32 = calculate_crc32_default(data, size);
-        G_buffer1[4] = (uint8_t)(crc32 & 0xFF);
-        G_buffer1[5] = (uint8_t)((crc32 >> 8) & 0xFF);
-        G_buffer1[6] = (uint8_t)((crc32 >> 16) & 0xFF);
-        G_buffer1[7] = (uint8_t)((crc32 >> 24) & 0xFF);
-    
         memcpy(&G_buffer1[8], data, size);
+        result = programPageBuffer(magic, dataId, size);
+    }
 
-        // CRITICAL: DISABLE debug output during image transfer
-        // This interferes with UART protocol communication (ACK/NAK responses)
-        // UARTIF_uartPrintf(0, "flash_manager: write data to flash nextWriteAddress is 0x%08x! \n", nextWriteAddress);
+    return result;
+}
 
-        // 写入Flash
-        if (W25Q32_WritePage(nextWriteAddress, G_buffer1, FLASH_PAGE_SIZE) != 0)
-        {
-            result = FLASH_ERROR_WRITE_FAIL;
-        }
-        else
-        {
-            // Write successful
-        }
+/**
+ * @brief 取得待写入page的数据区
+ */
+uint8_t *FM_getPageBuffer(void)
+{
+    memset(G_buffer1, 0, FLASH_PAGE_SIZE);
+    G_pageBufferLent = TRUE;
+    return &G_buffer1[8];
+}
+
+/**
+ * @brief 写入 FM_getPageBuffer 中已生成的数据
+ */
+flash_result_t FM_writePageBuffer(uint8_t magic, uint16_t dataId, uint16_t size)
+{
+    flash_result_t result = FLASH_OK;
+
+    result = checkArguments(magic, dataId, &G_buffer1[8], size);
+
+    // 取得数据区之后又调用过其它 FM 接口，数据区已被覆盖
+    if ((result == FLASH_OK) && !G_pageBufferLent)
+    {
+        result = FLASH_ERROR_INVALID_PARAM;
     }
-    // 更新映射表
+
+    // 垃圾回收会复用page缓冲区，这里不做回收，由调用方提前 FM_reserve
+    if ((result == FLASH_OK) && (fmCtx.gcInProgress || getFreePagesInActiveSegment() == 0u))
+    {
+        result = FLASH_ERROR_NO_SPACE;
+    }
+
     if (result == FLASH_OK)
     {
-        if (magic == DATA_PAGE_MAGIC || magic == MAGIC_BW_IMAGE_HEADER || magic == MAGIC_RED_IMAGE_HEADER)
-        {
-            fmCtx.entries[magic & 0x03][dataId] = fmCtx.nextWriteAddress;
-            if (magic == MAGIC_BW_IMAGE_HEADER || magic == MAGIC_RED_IMAGE_HEADER)
-            {
-                // UARTIF_uartPrintf(0, "FM_writeData: Updated entries[%d][%d] = 0x%04x (magic=0x%02x)\r\n", 
-                //                 magic & 0x03, dataId, fmCtx.nextWriteAddress, magic);
-            }
-        }
-        else if (magic == MAGIC_BW_IMAGE_DATA || magic == MAGIC_RED_IMAGE_DATA)
-        {
-            // Image data written
-        }
-        else
-        {
-            result = FLASH_ERROR_INVALID_PARAM;
-        }
-        fmCtx.nextWriteAddress++;
+        G_pageBufferLent = FALSE;
+        result = programPageBuffer(magic, dataId, size);
     }
-    
+
     return result;
 }
 
@@ -987,6 +1385,20 @@ flash_result_t FM_writeData(uint8_t magic, uint16_t dataId, const uint8_t* data,
  * @brief 读取数据
  */
 flash_result_t FM_readData(uint8_t magic, uint16_t dataId, uint8_t* data, uint8_t size)
+{
+    flash_result_t result = FLASH_ERROR_INVALID_PARAM;
+
+    if (!isReservedDataId(magic, dataId))
+    {
+        result = readData(magic, dataId, data, size);
+    }
+    return result;
+}
+
+/**
+ * @brief 读取数据（内部使用，可读保留条目）
+ */
+static flash_result_t readData(uint8_t magic, uint16_t dataId, uint8_t* data, uint8_t size)
 {
     flash_result_t result = FLASH_OK;
     uint32_t calculatedCrc, storedCrc;
@@ -1038,6 +1450,7 @@ flash_result_t FM_readData(uint8_t magic, uint16_t dataId, uint8_t* data, uint8_
     // 读取数据页
     if (result == FLASH_OK)
     {
+        G_pageBufferLent = FALSE;
         memset(G_buffer1, 0, FLASH_PAGE_SIZE);
         // 读取数据页到缓冲区
         if (W25Q32_ReadData(destAddress, G_buffer1, FLASH_PAGE_SIZE) != 0) 
@@ -1093,7 +1506,7 @@ flash_result_t FM_readData(uint8_t magic, uint16_t dataId, uint8_t* data, uint8_
 flash_result_t FM_deleteData(uint16_t dataId)
 {
     flash_result_t result = FLASH_OK;
-    if (dataId >= MAX_DATA_ENTRIES)
+    if (isReservedDataId(DATA_PAGE_MAGIC, dataId))
     {
         result = FLASH_ERROR_INVALID_PARAM;
     }
@@ -1115,14 +1528,41 @@ flash_result_t FM_forceGarbageCollect(void)
     return garbageCollect();
 }
 
+/**
+ * @brief 把 G_imageAddressBuffer 写成图层头页
+ */
+static flash_result_t writeImageAddressBuffer(uint8_t magic, uint8_t slotId)
+{
+    flash_result_t result;
+
+    // 清空缓冲区
+    memset(G_buffer2, 0, sizeof(G_buffer2));
+    memcpy(G_buffer2, G_imageAddressBuffer, (MAX_FRAME_NUM + 1) * 2);
+    
+    // /* Append 1-byte color flag */
+    // G_buffer2[(MAX_FRAME_NUM + 1) * 2] = (uint8_t)(lastIsRed);
+    /* 写入 addresses + color flag */
+    result = FM_writeData(magic, slotId, G_buffer2, (MAX_FRAME_NUM + 1) * 2);
+    if ((result == FLASH_OK) && (fmCtx.transferMagic == (uint8_t)(magic + 2u)) && (fmCtx.transferSlot == slotId))
+    {
+        FM_endTransfer();
+    }
+    // if (result == FLASH_OK)
+    // {
+    //     if (slotId < MAX_IMAGE_ENTRIES)
+    //     {
+    //         fmCtx.imageSlotColor[slotId] = lastIsRed;
+    //     }
+    // }
+    return result;
+}
+
 /**
  * @brief 写入图像头页
  */
 flash_result_t FM_writeImageHeader(uint8_t magic, uint8_t slotId)
 {
     flash_result_t result = FLASH_OK;
-	uint16_t buf_addr1;
-	uint16_t buf_addr0;
 
     if (magic != MAGIC_BW_IMAGE_HEADER && magic != MAGIC_RED_IMAGE_HEADER)
     {
@@ -1137,30 +1577,279 @@ flash_result_t FM_writeImageHeader(uint8_t magic, uint8_t slotId)
     if (result == FLASH_OK)
     {
         memset(G_imageAddressBuffer, 0xff, sizeof(G_imageAddressBuffer));
-        result = scanImageDataPages(magic + 2u, slotId);
+        result = scanImageDataPages(magic + 2u, slotId, FALSE);
     }
 
     if (result == FLASH_OK)
     {
-        // 清空缓冲区
-        memset(G_buffer2, 0, FLASH_PAGE_SIZE);
-        memcpy(G_buffer2, G_imageAddressBuffer, (MAX_FRAME_NUM + 1) * 2);
-        
-        // /* Append 1-byte color flag */
-        // G_buffer2[(MAX_FRAME_NUM + 1) * 2] = (uint8_t)(lastIsRed);
-        /* 写入 addresses + color flag */
-        result = FM_writeData(magic, slotId, G_buffer2, (MAX_FRAME_NUM + 1) * 2);
-        // if (result == FLASH_OK)
-        // {
-        //     if (slotId < MAX_IMAGE_ENTRIES)
-        //     {
-        //         fmCtx.imageSlotColor[slotId] = lastIsRed;
-        //     }
-        // }
+        result = writeImageAddressBuffer(magic, slotId);
+    }
+    return result;
+}
+
+/**
+ * @brief 增量更新：新头页引用本次写入的帧，其余帧沿用原图像的数据页
+ */
+flash_result_t FM_writeImageHeaderDelta(uint8_t magic, uint8_t slotId)
+{
+    flash_result_t result = FLASH_OK;
+
+    if (magic != MAGIC_BW_IMAGE_HEADER && magic != MAGIC_RED_IMAGE_HEADER)
+    {
+        result = FLASH_ERROR_INVALID_PARAM;
+    }
+
+    if (slotId >= MAX_IMAGE_ENTRIES)
+    {
+        result = FLASH_ERROR_INVALID_PARAM;
+    }
+
+    // 原头页的地址表作为底，未改动的帧不复制
+    if (result == FLASH_OK)
+    {
+        memset(G_imageAddressBuffer, 0xff, sizeof(G_imageAddressBuffer));
+        result = readImageHeaderIntoBuffer(magic, slotId);
+    }
+
+    if (result == FLASH_OK)
+    {
+        result = scanImageDataPages(magic + 2u, slotId, TRUE);
+    }
+
+    if (result == FLASH_OK)
+    {
+        result = writeImageAddressBuffer(magic, slotId);
+    }
+    return result;
+}
+
+/**
+ * @brief 读取图层各帧的CRC32（数据页页头第4~7字节）
+ */
+flash_result_t FM_readImageManifest(uint8_t magic, uint8_t slotId, uint8_t firstFrame, uint8_t count, uint32_t *crcs)
+{
+    flash_result_t result = FLASH_OK;
+    uint16_t pageAddr;
+    uint8_t frameNum;
+    uint8_t i;
+
+    if (magic != MAGIC_BW_IMAGE_DATA && magic != MAGIC_RED_IMAGE_DATA)
+    {
+        result = FLASH_ERROR_INVALID_PARAM;
+    }
+    if (slotId >= MAX_IMAGE_ENTRIES || crcs == NULL || count == 0u ||
+        (uint16_t)firstFrame + count > (uint16_t)(MAX_FRAME_NUM + 1))
+    {
+        result = FLASH_ERROR_INVALID_PARAM;
+    }
+
+    // 地址表读到 G_buffer2，不覆盖 FM_readImage 缓存在 G_imageAddressBuffer 中的地址表
+    if (result == FLASH_OK)
+    {
+        result = FM_readData((uint8_t)(magic - 2u), slotId, G_buffer2, (MAX_FRAME_NUM + 1) * 2);
+    }
+
+    // 只读每页的8字节页头；读不出的帧报告CRC为0，主机会重新上传该帧
+    for (i = 0; (result == FLASH_OK) && (i < count); i++)
+    {
+        frameNum = (uint8_t)(firstFrame + i);
+        pageAddr = (uint16_t)(G_buffer2[frameNum * 2u] | ((uint16_t)G_buffer2[frameNum * 2u + 1u] << 8));
+        crcs[i] = 0;
+        if (pageAddr != 0xffff && W25Q32_ReadData((uint32_t)pageAddr << 8u, G_buffer1, 8u) == 0 &&
+            G_buffer1[0] == magic && G_buffer1[1] == frameNum && G_buffer1[2] == slotId)
+        {
+            crcs[i] = (uint32_t)G_buffer1[4] | ((uint32_t)G_buffer1[5] << 8) |
+                      ((uint32_t)G_buffer1[6] << 16) | ((uint32_t)G_buffer1[7] << 24);
+        }
     }
     return result;
 }
 
+/**
+ * @brief 获取激活segment中剩余的连续空闲page数量
+ */
+uint16_t FM_getFreePages(void)
+{
+    return getFreePagesInActiveSegment();
+}
+
+/**
+ * @brief 预留连续空闲page
+ */
+flash_result_t FM_reserve(uint16_t pages)
+{
+    flash_result_t result = FLASH_OK;
+
+    if (pages == 0u || pages > (uint16_t)((fmCtx.segmentSize >> 8u) - 1u))
+    {
+        result = FLASH_ERROR_INVALID_PARAM;
+    }
+
+    // 空间不足时在传输开始前完成垃圾回收，避免在数据阶段阻塞
+    if ((result == FLASH_OK) && (getFreePagesInActiveSegment() < pages))
+    {
+        LOG2(LOG_FM_RESERVE_GC, pages, getFreePagesInActiveSegment());
+        fmCtx.gcInProgress = 1;
+        result = garbageCollect();
+        if ((result == FLASH_OK) && (getFreePagesInActiveSegment() < pages))
+        {
+            result = FLASH_ERROR_NO_SPACE;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 开始一次可续传的图层传输
+ */
+flash_result_t FM_beginTransfer(const fm_transfer_t *transfer)
+{
+    flash_result_t result = FLASH_OK;
+    uint8_t record[TRANSFER_RECORD_SIZE];
+    uint16_t base;
+
+    if (transfer == NULL || transfer->slotId >= MAX_IMAGE_ENTRIES ||
+        (transfer->magic != MAGIC_BW_IMAGE_DATA && transfer->magic != MAGIC_RED_IMAGE_DATA))
+    {
+        result = FLASH_ERROR_INVALID_PARAM;
+    }
+
+    // 记录页 + 整层数据页 + 头页一次预留，之后的数据阶段不会触发垃圾回收
+    if (result == FLASH_OK)
+    {
+        FM_endTransfer();
+        result = FM_reserve(IMAGE_LAYER_PAGES + 1u);
+    }
+
+    if (result == FLASH_OK)
+    {
+        // 数据页从记录页的下一页开始
+        base = (uint16_t)(fmCtx.nextWriteAddress + 1u);
+        record[0] = (uint8_t)(transfer->transferId & 0xFF);
+        record[1] = (uint8_t)((transfer->transferId >> 8) & 0xFF);
+        record[2] = (uint8_t)((transfer->transferId >> 16) & 0xFF);
+        record[3] = (uint8_t)((transfer->transferId >> 24) & 0xFF);
+        record[4] = (uint8_t)(transfer->imageCrc & 0xFF);
+        record[5] = (uint8_t)((transfer->imageCrc >> 8) & 0xFF);
+        record[6] = (uint8_t)((transfer->imageCrc >> 16) & 0xFF);
+        record[7] = (uint8_t)((transfer->imageCrc >> 24) & 0xFF);
+        record[8] = transfer->magic;
+        record[9] = transfer->slotId;
+        record[10] = (uint8_t)(base & 0xFF);
+        record[11] = (uint8_t)((base >> 8) & 0xFF);
+        record[12] = (uint8_t)(fmCtx.currentGcCounter & 0xFF);
+        record[13] = (uint8_t)((fmCtx.currentGcCounter >> 8) & 0xFF);
+        record[14] = (uint8_t)((fmCtx.currentGcCounter >> 16) & 0xFF);
+        record[15] = (uint8_t)((fmCtx.currentGcCounter >> 24) & 0xFF);
+        result = writeData(DATA_PAGE_MAGIC, FM_TRANSFER_DATA_ID, record, TRANSFER_RECORD_SIZE);
+    }
+
+    if (result == FLASH_OK)
+    {
+        fmCtx.transferBase = base;
+        fmCtx.transferMagic = transfer->magic;
+        fmCtx.transferSlot = transfer->slotId;
+        LOG4(LOG_FM_TRANSFER_BEGIN, transfer->transferId, transfer->slotId, transfer->magic, base);
+    }
+    return result;
+}
+
+/**
+ * @brief 续传：按传输记录重建已写入的帧位图
+ */
+flash_result_t FM_resumeTransfer(const fm_transfer_t *transfer, uint64_t *received)
+{
+    flash_result_t result = FLASH_OK;
+    uint8_t record[TRANSFER_RECORD_SIZE];
+    transfer_scan_t scan;
+    uint16_t base = 0;
+    uint32_t gcCounter;
+    uint32_t transferId;
+    uint32_t imageCrc;
+    uint16_t missing = 0;
+    uint8_t i;
+
+    if (transfer == NULL || received == NULL)
+    {
+        result = FLASH_ERROR_INVALID_PARAM;
+    }
+
+    if (result == FLASH_OK)
+    {
+        result = readData(DATA_PAGE_MAGIC, FM_TRANSFER_DATA_ID, record, TRANSFER_RECORD_SIZE);
+        if (result != FLASH_OK)
+        {
+            result = FLASH_ERROR_NOT_FOUND;
+        }
+    }
+
+    // 记录必须与主机给出的传输一致，且之后没有发生过垃圾回收（未完成的数据页已被丢弃）
+    if (result == FLASH_OK)
+    {
+        base = (uint16_t)(record[10] | ((uint16_t)record[11] << 8));
+        gcCounter = (uint32_t)record[12] | ((uint32_t)record[13] << 8) |
+                    ((uint32_t)record[14] << 16) | ((uint32_t)record[15] << 24);
+        transferId = (uint32_t)record[0] | ((uint32_t)record[1] << 8) |
+                     ((uint32_t)record[2] << 16) | ((uint32_t)record[3] << 24);
+        imageCrc = (uint32_t)record[4] | ((uint32_t)record[5] << 8) |
+                   ((uint32_t)record[6] << 16) | ((uint32_t)record[7] << 24);
+        if (transferId != transfer->transferId || imageCrc != transfer->imageCrc ||
+            record[8] != transfer->magic || record[9] != transfer->slotId ||
+            gcCounter != fmCtx.currentGcCounter || base > fmCtx.nextWriteAddress)
+        {
+            result = FLASH_ERROR_NOT_FOUND;
+        }
+    }
+
+    if (result == FLASH_OK)
+    {
+        scan.magic = transfer->magic;
+        scan.slotId = transfer->slotId;
+        scan.received = 0;
+        G_pageBufferLent = FALSE;
+        if (fmCtx.nextWriteAddress > base &&
+            W25Q32_FastReadBurst((uint32_t)base << 8u, (uint32_t)(fmCtx.nextWriteAddress - base) << 8u,
+                                 G_buffer1, FLASH_PAGE_SIZE, transferScanCallback, &scan) != W25Q32_OK)
+        {
+            result = FLASH_ERROR_READ_FAIL;
+        }
+    }
+
+    // 剩余空间要能写完缺失帧和头页，否则只能重新开始（FM_beginTransfer 会先回收空间）
+    if (result == FLASH_OK)
+    {
+        for (i = 0; i <= MAX_FRAME_NUM; i++)
+        {
+            if ((scan.received & ((uint64_t)1u << i)) == 0u)
+            {
+                missing++;
+            }
+        }
+        if (getFreePagesInActiveSegment() < (uint16_t)(missing + 1u))
+        {
+            result = FLASH_ERROR_NO_SPACE;
+        }
+    }
+
+    if (result == FLASH_OK)
+    {
+        fmCtx.transferBase = base;
+        fmCtx.transferMagic = transfer->magic;
+        fmCtx.transferSlot = transfer->slotId;
+        *received = scan.received;
+    }
+    LOG3(LOG_FM_TRANSFER_RESUME, (transfer != NULL) ? transfer->transferId : 0u, result, missing);
+    return result;
+}
+
+/**
+ * @brief 结束进行中的可续传传输
+ */
+void FM_endTransfer(void)
+{
+    fmCtx.transferBase = NO_TRANSFER;
+}
+
 /**
  * @brief 读取图像数据页
  */
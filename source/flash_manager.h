@@ -70,8 +70,21 @@ typedef struct {
     segment_header_t header1;
     uint16_t* entries[3u]; // 0 - dataEntries, 1 - imageBwEntries, 2 - imageRedEntries
     uint8_t entriesCountMax[3u]; // 0 - MAX_DATA_ENTRIES, 1 - MAX_IMAGE_ENTRIES, 2 - MAX_IMAGE_ENTRIES
+    uint32_t segmentSize;        // 运行时segment大小，同时也是segment1基地址
+    uint32_t segment1End;        // segment1结束地址（不含）
+    uint16_t transferBase;       // 进行中的可续传传输：第一个数据页的page索引，0xFFFF 表示没有
+    uint8_t transferMagic;       // 进行中的可续传传输：图层数据页magic
+    uint8_t transferSlot;        // 进行中的可续传传输：图像槽位
 } flash_manager_t;
 
+// 可续传的图层传输（同一时间只有一个）
+typedef struct {
+    uint32_t transferId;         // 主机给出的传输ID
+    uint32_t imageCrc;           // 整层图像CRC32，主机用来确认续传的是同一幅图
+    uint8_t magic;               // 图层数据页magic：MAGIC_BW_IMAGE_DATA / MAGIC_RED_IMAGE_DATA
+    uint8_t slotId;              // 图像槽位
+} fm_transfer_t;
+
 // 函数声明
 
 /**
@@ -87,15 +100,34 @@ flash_result_t FM_init(void);
  * @param data 数据指针
  * @param size 数据大小（1-247字节）
  * @return flash_result_t 操作结果
+ * @note DATA_PAGE_MAGIC 的 dataId 范围为 0 ~ FM_USER_DATA_ENTRIES-1，FM_TRANSFER_DATA_ID 保留给可续传传输记录
  */
 flash_result_t FM_writeData(uint8_t magic, uint16_t dataId, const uint8_t* data, uint16_t size);
 
+/**
+ * @brief 取得待写入page的数据区，调用方直接在其中生成数据，省去一次复制
+ * @return uint8_t* 数据区指针（最多 PAYLOAD_SIZE 字节，已清零）
+ * @note 与垃圾回收、读写接口共用page缓冲区：从 FM_getPageBuffer 到 FM_writePageBuffer 之间不能调用其它 FM_* 接口
+ */
+uint8_t *FM_getPageBuffer(void);
+
+/**
+ * @brief 写入 FM_getPageBuffer 数据区中的数据
+ * @param magic 魔法数字
+ * @param dataId 数据ID
+ * @param size 数据大小
+ * @return flash_result_t 操作结果，需要垃圾回收时返回 FLASH_ERROR_NO_SPACE（先调用 FM_reserve）；
+ *         没有先调用 FM_getPageBuffer，或其后调用过其它 FM_* 接口（数据区已被覆盖）返回 FLASH_ERROR_INVALID_PARAM
+ */
+flash_result_t FM_writePageBuffer(uint8_t magic, uint16_t dataId, uint16_t size);
+
 /**
  * @brief 读取数据
  * @param dataId 数据ID
  * @param data 数据缓冲区指针
  * @param size 输入：缓冲区大小，输出：实际数据大小
  * @return flash_result_t 操作结果
+ * @note 与 FM_writeData 相同，不能读取保留条目 FM_TRANSFER_DATA_ID
  */
 flash_result_t FM_readData(uint8_t magic, uint16_t dataId, uint8_t* data, uint8_t size);
 
@@ -137,6 +169,26 @@ flash_result_t FM_forceGarbageCollect(void);
  */
 flash_result_t FM_writeImageHeader(uint8_t magic, uint8_t slotId);
 
+/**
+ * @brief 增量更新后写入图像头页：本次写入的帧替换原地址，未改动的帧继续引用原数据页
+ * @param magic 头页魔法数字
+ * @param slotId 槽位编号
+ * @return flash_result_t 槽位没有原图像返回 FLASH_ERROR_NOT_FOUND
+ */
+flash_result_t FM_writeImageHeaderDelta(uint8_t magic, uint8_t slotId);
+
+/**
+ * @brief 读取图层各帧存储的CRC32（主机据此只上传改动的帧）
+ * @param magic 数据页魔法数字
+ * @param slotId 槽位编号
+ * @param firstFrame 起始帧号
+ * @param count 帧数，firstFrame + count 不超过 61
+ * @param crcs 输出：count 个CRC32
+ * @return flash_result_t 槽位没有原图像返回 FLASH_ERROR_NOT_FOUND
+ * @note 只读页头，不校验数据；读不出的帧CRC为0。显示时 FM_readImage 仍会校验CRC
+ */
+flash_result_t FM_readImageManifest(uint8_t magic, uint8_t slotId, uint8_t firstFrame, uint8_t count, uint32_t *crcs);
+
 // /**
 //  * @brief 获取图像槽位存储的颜色标志
 //  * @param slotId 槽位编号
@@ -154,4 +206,41 @@ flash_result_t FM_writeImageHeader(uint8_t magic, uint8_t slotId);
  */
 flash_result_t FM_readImage(uint8_t magic, uint8_t slotId, uint8_t frameNum, uint8_t* data);
 
+/**
+ * @brief 获取激活segment中剩余的连续空闲page数量
+ * @return uint16_t 空闲page数量
+ */
+uint16_t FM_getFreePages(void);
+
+/**
+ * @brief 预留连续空闲page（在传输开始时调用）
+ * @param pages 需要预留的page数量
+ * @return flash_result_t 操作结果，空间不足时先执行垃圾回收，仍不足返回 FLASH_ERROR_NO_SPACE
+ * @note 预留成功后，后续 pages 次 FM_writeData 不会触发垃圾回收
+ */
+flash_result_t FM_reserve(uint16_t pages);
+
+/**
+ * @brief 开始一次可续传的图层传输：预留空间并写入传输记录
+ * @param transfer 传输ID、图像CRC、图层与槽位
+ * @return flash_result_t 操作结果
+ * @note 记录写入后，该图层的数据页按普通方式用 FM_writeData/FM_writePageBuffer 写入
+ */
+flash_result_t FM_beginTransfer(const fm_transfer_t *transfer);
+
+/**
+ * @brief 续传：查找与 transfer 一致的传输记录，返回已写入的帧
+ * @param transfer 传输ID、图像CRC、图层与槽位
+ * @param received 输出：已写入且CRC正确的帧位图（bit n = 帧 n）
+ * @return flash_result_t 无匹配记录或记录之后发生过垃圾回收返回 FLASH_ERROR_NOT_FOUND，
+ *         剩余空间不够写完缺失帧返回 FLASH_ERROR_NO_SPACE；两种情况都应重新开始传输
+ * @note 位图由传输起点之后的数据页重建，不单独保存，重启后同样有效
+ */
+flash_result_t FM_resumeTransfer(const fm_transfer_t *transfer, uint64_t *received);
+
+/**
+ * @brief 结束进行中的可续传传输（图层头页写入成功时自动结束）
+ */
+void FM_endTransfer(void);
+
 #endif // FLASH_MANAGER_H
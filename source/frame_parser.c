@@ -0,0 +1,121 @@
+/******************************************************************************
+ ** @file frame_parser.c
+ **
+ ** @brief 0xABCD 帧逐字节解析：显式状态机，PAYLOAD 直接写入目的缓冲区
+ **
+ ******************************************************************************/
+
+/******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stddef.h>
+#include "frame_parser.h"
+#include "crc_utils.h"
+
+/*****************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+
+// 初始化解析器
+void FrameParser_Init(frame_parser_t *p, uint16_t maxLen)
+{
+    p->state = FP_STATE_MAGIC0;
+    p->flags = 0;
+    p->len = 0;
+    p->pos = 0;
+    p->crc = CRC16_CCITT_INIT;
+    p->crcRx = 0;
+    p->maxLen = maxLen;
+    p->dst = NULL;
+}
+
+// 设置本帧 PAYLOAD 的目的缓冲区
+void FrameParser_SetDest(frame_parser_t *p, uint8_t *dst)
+{
+    p->dst = dst;
+}
+
+// 放弃本帧重新同步
+void FrameParser_Reject(frame_parser_t *p)
+{
+    p->state = FP_STATE_MAGIC0;
+    p->dst = NULL;
+}
+
+/**
+ * @brief 输入一个字节
+ * @return FRAME_PARSE_xxx
+ * @note 中断中不使用硬件 CRC（与主循环共享），PAYLOAD CRC 按字节软件累计
+ */
+uint8_t FrameParser_Feed(frame_parser_t *p, uint8_t data)
+{
+    switch (p->state)
+    {
+    case FP_STATE_MAGIC0:
+        if (data == FRAME_MAGIC_0) p->state = FP_STATE_MAGIC1;
+        break;
+
+    case FP_STATE_MAGIC1:
+        if (data == FRAME_MAGIC_1)
+        {
+            p->state = FP_STATE_FLAGS;
+        }
+        else if (data != FRAME_MAGIC_0)
+        {
+            p->state = FP_STATE_MAGIC0;
+        }
+        break;
+
+    case FP_STATE_FLAGS:
+        p->flags = data;
+        p->state = FP_STATE_LEN_HI;
+        break;
+
+    case FP_STATE_LEN_HI:
+        p->len = (uint16_t)((uint16_t)data << 8);
+        p->state = FP_STATE_LEN_LO;
+        break;
+
+    case FP_STATE_LEN_LO:
+        p->len = (uint16_t)(p->len | data);
+        if (p->len > p->maxLen)
+        {
+            /* 非法长度，放弃本帧重新同步 */
+            p->state = FP_STATE_MAGIC0;
+            return FRAME_PARSE_LEN_ERR;
+        }
+        p->pos = 0;
+        p->crc = CRC16_CCITT_INIT;
+        p->dst = NULL;
+        p->state = (p->len != 0) ? FP_STATE_PAYLOAD : FP_STATE_CRC_HI;
+        return FRAME_PARSE_START;
+
+    case FP_STATE_PAYLOAD:
+        p->crc = crc16_ccitt_update_sw(p->crc, &data, 1);
+        if (p->dst != NULL)
+        {
+            p->dst[p->pos] = data;
+        }
+        if (++p->pos >= p->len)
+        {
+            p->state = FP_STATE_CRC_HI;
+        }
+        break;
+
+    case FP_STATE_CRC_HI:
+        p->crcRx = (uint16_t)((uint16_t)data << 8);
+        p->state = FP_STATE_CRC_LO;
+        break;
+
+    case FP_STATE_CRC_LO:
+        p->crcRx = (uint16_t)(p->crcRx | data);
+        p->state = FP_STATE_MAGIC0;
+        return (p->crc == p->crcRx) ? FRAME_PARSE_DONE : FRAME_PARSE_CRC_ERR;
+
+    default:
+        p->state = FP_STATE_MAGIC0;
+        break;
+    }
+
+    return FRAME_PARSE_NONE;
+}
@@ -0,0 +1,58 @@
+#ifndef FRAME_PARSER_H
+#define FRAME_PARSER_H
+
+#include <stdint.h>
+
+/*
+ * 0xABCD 帧解析：MAGIC(2B)=0xABCD | FLAGS(1B) | LEN(2B big-endian) | PAYLOAD(LEN) | CRC(2B big-endian)
+ * CRC16-CCITT 只覆盖 PAYLOAD。每个字节 O(1) 处理，不移动缓冲区，可在中断中调用。
+ */
+#define FRAME_MAGIC_0       0xAB
+#define FRAME_MAGIC_1       0xCD
+#define FRAME_HEADER_LEN    5       // MAGIC + FLAGS + LEN
+#define FRAME_CRC_LEN       2
+
+// 解析状态
+#define FP_STATE_MAGIC0     0
+#define FP_STATE_MAGIC1     1
+#define FP_STATE_FLAGS      2
+#define FP_STATE_LEN_HI     3
+#define FP_STATE_LEN_LO     4
+#define FP_STATE_PAYLOAD    5
+#define FP_STATE_CRC_HI     6
+#define FP_STATE_CRC_LO     7
+
+// FrameParser_Feed 返回的事件
+#define FRAME_PARSE_NONE    0       // 需要更多字节
+#define FRAME_PARSE_START   1       // 帧头已收齐，调用方可用 FrameParser_SetDest 指定 payload 缓冲区
+#define FRAME_PARSE_DONE    2       // 一帧接收完成且 CRC 正确
+#define FRAME_PARSE_CRC_ERR 3       // 一帧接收完成但 CRC 错误
+#define FRAME_PARSE_LEN_ERR 4       // LEN 超过上限，已回到找 MAGIC
+
+typedef struct {
+    uint8_t state;          // FP_STATE_xxx
+    uint8_t flags;          // 当前帧 FLAGS
+    uint16_t len;           // 当前帧 PAYLOAD 长度
+    uint16_t pos;           // 已接收的 PAYLOAD 字节数
+    uint16_t crc;           // PAYLOAD 累计 CRC
+    uint16_t crcRx;         // 帧尾 CRC
+    uint16_t maxLen;        // 允许的最大 PAYLOAD 长度（目的缓冲区大小）
+    uint8_t *dst;           // PAYLOAD 目的缓冲区，NULL 表示跳过本帧 PAYLOAD
+} frame_parser_t;
+
+// 初始化解析器，maxLen 为目的缓冲区大小
+void FrameParser_Init(frame_parser_t *p, uint16_t maxLen);
+
+// 输入一个字节，返回 FRAME_PARSE_xxx
+uint8_t FrameParser_Feed(frame_parser_t *p, uint8_t data);
+
+// 收到 FRAME_PARSE_START 后设置本帧 PAYLOAD 的目的缓冲区（至少 maxLen 字节）
+void FrameParser_SetDest(frame_parser_t *p, uint8_t *dst);
+
+// 收到 FRAME_PARSE_START 后调用方按 FLAGS 判定 LEN 非法：放弃本帧，从下一个字节重新找 MAGIC
+void FrameParser_Reject(frame_parser_t *p);
+
+// 是否正在接收一帧（已匹配 MAGIC 首字节之后）
+#define FrameParser_IsBusy(p)   ((p)->state != FP_STATE_MAGIC0)
+
+#endif // FRAME_PARSER_H
@@ -0,0 +1,139 @@
+/******************************************************************************
+ ** @file frame_pool.c
+ **
+ ** @brief 接收帧槽池：UART 中断组帧后通过描述符队列交给主循环
+ **
+ ******************************************************************************/
+
+/******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include "base_types.h"
+#include "hc32l110.h"
+#include "frame_pool.h"
+
+/******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+#define FRAME_READY_MASK    (FRAME_READY_SIZE - 1u)
+
+/******************************************************************************
+ * Local variable definitions ('static')                                      *
+ ******************************************************************************/
+static frame_slot_t framePool[FRAME_POOL_SLOTS];
+
+// 就绪描述符队列：中断写 readyHead，主循环写 readyTail
+static uint8_t readyRing[FRAME_READY_SIZE];
+static volatile uint8_t readyHead = 0;
+static volatile uint8_t readyTail = 0;
+
+static volatile uint32_t frameDropCount = 0;
+
+/*****************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+
+// 初始化帧池
+void FramePool_Init(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < FRAME_POOL_SLOTS; i++) {
+        framePool[i].len = 0;
+        framePool[i].state = FRAME_SLOT_FREE;
+    }
+    readyHead = 0;
+    readyTail = 0;
+    frameDropCount = 0;
+}
+
+// 申请空闲帧槽（中断中调用）
+frame_slot_t *FramePool_Claim(uint8_t source)
+{
+    uint8_t i;
+
+    for (i = 0; i < FRAME_POOL_SLOTS; i++) {
+        if (framePool[i].state == FRAME_SLOT_FREE) {
+            framePool[i].state = FRAME_SLOT_FILLING;
+            framePool[i].source = source;
+            framePool[i].status = 0;
+            framePool[i].len = 0;
+            return &framePool[i];
+        }
+    }
+    frameDropCount++;
+    return NULL;
+}
+
+// 帧接收完成（中断中调用）
+void FramePool_Commit(frame_slot_t *slot)
+{
+    // 帧槽数不超过队列大小，就绪队列不会溢出
+    slot->state = FRAME_SLOT_READY;
+    readyRing[readyHead & FRAME_READY_MASK] = (uint8_t)(slot - framePool);
+    __DMB();  // 描述符先落地，再发布 readyHead
+    readyHead = (uint8_t)(readyHead + 1u);
+}
+
+// 放弃正在接收的帧（中断中调用）
+void FramePool_Abort(frame_slot_t *slot)
+{
+    slot->state = FRAME_SLOT_FREE;
+}
+
+// 取出一帧（主循环调用）
+frame_slot_t *FramePool_Next(void)
+{
+    uint8_t tail = readyTail;
+    frame_slot_t *slot;
+
+    if (readyHead == tail) {
+        return NULL;
+    }
+    __DMB();
+    slot = &framePool[readyRing[tail & FRAME_READY_MASK]];
+    readyTail = (uint8_t)(tail + 1u);
+    return slot;
+}
+
+// 归还帧槽（主循环调用）
+void FramePool_Release(frame_slot_t *slot)
+{
+    if (slot != NULL) {
+        __DMB();  // 数据处理完成后才允许中断重新写入
+        slot->state = FRAME_SLOT_FREE;
+    }
+}
+
+// 帧池是否空闲
+bool FramePool_IsIdle(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < FRAME_POOL_SLOTS; i++) {
+        if (framePool[i].state != FRAME_SLOT_FREE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 某个来源可用的帧槽数：空闲的加上该来源已占用的（不含其他来源占用的）
+uint8_t FramePool_Available(uint8_t source)
+{
+    uint8_t i;
+    uint8_t n = 0;
+
+    for (i = 0; i < FRAME_POOL_SLOTS; i++) {
+        if (framePool[i].state == FRAME_SLOT_FREE || framePool[i].source == source) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// 丢帧计数
+uint32_t FramePool_GetDropCount(void)
+{
+    return frameDropCount;
+}
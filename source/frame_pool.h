@@ -0,0 +1,67 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRAME_POOL_SLOTS    3       // 帧槽数量
+#define FRAME_SLOT_SIZE     260     // 单帧最大长度：V2 数据帧 259 字节，0xABCD 帧只存 PAYLOAD
+#define FRAME_READY_SIZE    4       // 就绪描述符队列大小，必须是2的幂且不小于帧槽数量
+
+// 帧来源
+#define FRAME_SRC_LPUART    0       // LPUART 0xABCD 帧
+#define FRAME_SRC_UART_V2   1       // UART1 图像传输 V2 帧（0x55 ... 0xAA）
+
+// 帧槽状态
+#define FRAME_SLOT_FREE     0
+#define FRAME_SLOT_FILLING  1       // 中断正在写入
+#define FRAME_SLOT_READY    2       // 已完整接收，等待主循环处理
+
+// 中断组帧时写入的校验结果（status 字段）
+#define FRAME_RX_CRC_OK     0x01
+#define FRAME_RX_BATCH      0x02    // 0xABCD 批量帧拆出的一页
+#define FRAME_RX_BATCH_END  0x04    // 批量帧的最后一页（CRC 错误时为不含数据的一槽），主机等待处理后的应答
+
+// 帧槽：中断直接把一整帧写入 data，主循环处理完再归还
+typedef struct {
+    uint8_t data[FRAME_SLOT_SIZE];  // 帧数据：V2 为整帧，0xABCD 帧为 PAYLOAD
+    uint16_t len;                   // data 中的有效长度
+    uint8_t source;                 // 帧来源 FRAME_SRC_xxx
+    uint8_t flags;                  // 0xABCD 帧的 FLAGS
+    uint8_t status;                 // 组帧阶段的附加信息
+    volatile uint8_t state;         // FRAME_SLOT_xxx
+} frame_slot_t;
+
+// 函数声明
+// 中断侧（所有 UART 中断优先级相同，不会互相嵌套，视为同一个生产者）
+
+// 初始化帧池（中断打开之前调用）
+void FramePool_Init(void);
+
+// 申请一个空闲帧槽，没有空闲时返回 NULL 并计入丢帧
+frame_slot_t *FramePool_Claim(uint8_t source);
+
+// 帧接收完成，放入就绪队列
+void FramePool_Commit(frame_slot_t *slot);
+
+// 放弃正在接收的帧
+void FramePool_Abort(frame_slot_t *slot);
+
+// 主循环侧
+
+// 取出最早完成的一帧，没有时返回 NULL
+frame_slot_t *FramePool_Next(void);
+
+// 处理完毕后归还帧槽
+void FramePool_Release(frame_slot_t *slot);
+
+// 是否有就绪帧或正在接收的帧
+bool FramePool_IsIdle(void);
+
+// 某个来源可用的帧槽数（空闲 + 该来源已占用），用于向主机通告 credit
+uint8_t FramePool_Available(uint8_t source);
+
+// 因无空闲帧槽而丢弃的帧数
+uint32_t FramePool_GetDropCount(void);
+
+#endif // FRAME_POOL_H
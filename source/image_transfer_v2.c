@@ -8,17 +8,34 @@
 #include "uart_interface.h"
 #include "flash_manager.h"
 #include "crc_utils.h"
+#include "frame_pool.h"
+#include "proto_router.h"
+#include "log.h"
 #include <string.h>
 #include <stdio.h>
-#include "uart.h"
 
 /******************************************************************************
  * Defines
  ******************************************************************************/
 
-// Debug output control
-// CRITICAL: Disable debug output during data transfer to avoid UART conflicts
-#define ENABLE_DEBUG_OUTPUT       0  // Set to 0 to disable debug logs during transfer, 1 to enable
+// Debug log control
+// CRITICAL: V2 帧和日志共用 UART1，二进制日志记录含任意字节（包括 0x55/0xAA），
+// 只按 0x55 找帧的主机会误判，默认关闭；调试时置 1 并用 tools/log_decode.py 分离
+#ifndef V2_ENABLE_LOG
+#define V2_ENABLE_LOG             0
+#endif
+
+#if V2_ENABLE_LOG
+    #define V2_LOG1(id, a)              LOG1(id, a)
+    #define V2_LOG2(id, a, b)           LOG2(id, a, b)
+    #define V2_LOG3(id, a, b, c)        LOG3(id, a, b, c)
+    #define V2_LOG4(id, a, b, c, d)     LOG4(id, a, b, c, d)
+#else
+    #define V2_LOG1(id, a)              do {} while (0)
+    #define V2_LOG2(id, a, b)           do {} while (0)
+    #define V2_LOG3(id, a, b, c)        do {} while (0)
+    #define V2_LOG4(id, a, b, c, d)     do {} while (0)
+#endif
 
 // Protocol Marks
 #define PROTO_START_MARK          0x55
@@ -27,12 +44,22 @@
 // Command Types
 #define CMD_START                 0x01
 #define CMD_END                   0x02
+#define CMD_START_WINDOW          0x06  // [0x55, 0x06, W_REQ, CHECKSUM, 0xAA]: windowed transfer
+#define CMD_BEGIN                 0x08  // [0x55, 0x08, SLOT, W_REQ, ID(4), CRC(4), CHECKSUM, 0xAA]: resumable transfer
+#define CMD_RESUME                0x09  // [0x55, 0x09, SLOT, W_REQ, ID(4), CRC(4), CHECKSUM, 0xAA]: continue transfer ID
+#define CMD_MANIFEST              0x0A  // [0x55, 0x0A, SLOT, CHECKSUM, 0xAA]: stored CRC32 of every frame
+#define CMD_END_DELTA             0x0B  // [0x55, 0x0B, SLOT, CHECKSUM, 0xAA]: END, frames not sent stay as stored
+#define CMD_HELLO                 0x0C  // [0x55, 0x0C, CHECKSUM, 0xAA]: capability query
 #define FRAME_TYPE_IMAGE_DATA     0x10  // Only data frames, no header frame
 
 // Response Types (Control Frames)
 #define RESP_READY                0x03
+#define RESP_READY_WINDOW         0x07  // [0x55, 0x07, W, K, CHECKSUM, 0xAA]: granted window / SACK interval
 #define RESP_ACK                  0x20
 #define RESP_NAK                  0x21
+#define RESP_SACK                 0x28  // [0x55, 0x28, CUM(2), BITMAP(8), CHECKSUM, 0xAA]
+#define RESP_MANIFEST             0x2A  // [0x55, 0x2A, SLOT, CRC(4) x 61, CHECKSUM, 0xAA]
+#define RESP_CAPS                 0x2C  // [0x55, 0x2C, CAPS(UARTIF_CAPS_LEN), CHECKSUM, 0xAA]
 
 // Detailed NAK Error Codes (for error diagnosis)
 // 这些错误代码用于区分不同类型的 NAK 原因
@@ -46,26 +73,34 @@
 #define RESP_COMPLETE             0x04
 #define RESP_FAIL                 0x05
 
-// Timeouts (in ms, checked via 1ms timer)
+// Timeouts (in ms, measured with the tick source)
 #define TIMEOUT_FRAME             3000
 #define TIMEOUT_IDLE              5000
+#define TIMEOUT_SACK              200   // Windowed: repeat SACK when frames are missing and the link goes quiet
 
 // Limits
 #define MAX_RETRIES               5
 #define IMAGE_PAGES               61
 #define FRAME_PAYLOAD_SIZE        248
+#define CTRL_FRAME_LEN            4     // [0x55, CMD, CHECKSUM, 0xAA]
+#define CTRL_WIN_FRAME_LEN        5     // [0x55, CMD, ARG, CHECKSUM, 0xAA]
+#define CTRL_XFER_FRAME_LEN       14    // [0x55, CMD, SLOT, W_REQ, ID(4), CRC(4), CHECKSUM, 0xAA]
+#define DATA_FRAME_LEN            259   // [0x55, TYPE, NUM(2), SLOT, CRC(4), PAYLOAD(248), CHECKSUM, 0xAA]
+#define SACK_FRAME_LEN            14
+#define MANIFEST_CHUNK            8     // Frame CRCs read from flash per step while streaming RESP_MANIFEST
 
-// Conditional debug macro
-#if ENABLE_DEBUG_OUTPUT
-    #define DEBUG_PRINTF(fmt, ...) UARTIF_uartPrintf(0, fmt, ##__VA_ARGS__)
-#else
-    #define DEBUG_PRINTF(fmt, ...) do {} while(0)
-#endif
+// Window: frames in flight are bounded by the frames the device can hold before the main loop drains them
+#define WINDOW_MAX                FRAME_POOL_SLOTS
 
 /******************************************************************************
  * Types
  ******************************************************************************/
 
+typedef enum {
+    RX_MODE_STOP_WAIT,          // One frame, one ACK/NAK
+    RX_MODE_WINDOW              // Up to W frames in flight, cumulative ACK + SACK bitmap
+} rx_mode_t;
+
 typedef enum {
     RX_STATE_IDLE,
     RX_STATE_WAITING_DATA,      // Waiting for 61 data frames
@@ -75,13 +110,20 @@ typedef enum {
 
 typedef struct {
     rx_state_t state;
-    uint8_t frame_buf[259];        // Single frame buffer
-    uint16_t frame_idx;            // Current position in frame
     uint16_t current_frame_num;    // Last frame number received
     uint8_t current_slot_id;       // Current slot ID
     uint32_t timeout_counter;
     uint32_t total_frames_received;
     uint64_t frame_bitmap;         // Track which frames received
+    rx_mode_t mode;
+    uint8_t window;                // Granted window (frames in flight)
+    uint8_t sack_interval;         // Send SACK after this many new frames
+    uint8_t frames_since_sack;
+    uint16_t cum_ack;              // Frames 0..cum_ack-1 all received
+    uint16_t gap_cum;              // cum_ack whose gap was already reported
+    uint32_t last_rx_tick;         // Tick of the last received frame
+    uint32_t last_sack_tick;       // Tick of the last SACK
+    uint8_t resumable;             // Started by CMD_BEGIN/CMD_RESUME: frames must carry current_slot_id
 } rx_context_t;
 
 /******************************************************************************
@@ -89,6 +131,12 @@ typedef struct {
  ******************************************************************************/
 
 static rx_context_t rx_ctx;
+static const volatile uint32_t *v2Tick = NULL;
+
+// ISR-side framing: the UART1 RX interrupt writes frames straight into a pool slot
+static frame_slot_t *rx_slot = NULL;
+static uint16_t rx_need = 0;
+static uint16_t rx_pos = 0;        // Bytes of the current frame, also counted while it is being dropped
 
 /******************************************************************************
  * Helper Functions
@@ -114,28 +162,16 @@ static uint8_t calc_checksum(const uint8_t *data, uint16_t len)
 static void send_ctrl_frame(uint8_t command)
 {
     uint8_t frame[4];
-    int i;
-//    char *cmd_str;
 
     frame[0] = PROTO_START_MARK;
     frame[1] = command;
     frame[2] = calc_checksum(&frame[0], 2);
     frame[3] = PROTO_STOP_MARK;
 
-    for (i = 0; i < 4; i++) {
-        Uart_SendData(UARTCH1, frame[i]);
-    }
+    (void)UARTIF_write(0, frame, sizeof(frame), UARTIF_TX_PRIORITY);
 
-    // CRITICAL: Do NOT output debug log after sending control frame
-    // It will interfere with UART protocol communication
-    // Use DEBUG_PRINTF instead which can be disabled
-    // switch (command) {
-    //     case RESP_READY:    cmd_str = "READY";    break;
-    //     case RESP_COMPLETE: cmd_str = "COMPLETE"; break;
-    //     case RESP_FAIL:     cmd_str = "FAIL";     break;
-    //     default:            cmd_str = "UNKNOWN";  break;
-    // }
-    // DEBUG_PRINTF("[IMG_V2] TX CTRL: %s (0x%02X)\r\n", cmd_str, command);
+    // Binary log record only: no text formatting on the protocol path
+    V2_LOG1(LOG_V2_TX_CTRL, command);
 }
 
 /**
@@ -146,7 +182,6 @@ static void send_ctrl_frame(uint8_t command)
 static void send_response(uint8_t resp_type, uint16_t frame_num)
 {
     uint8_t frame[6];
-    int i;
 
     frame[0] = PROTO_START_MARK;
     frame[1] = resp_type;
@@ -155,51 +190,331 @@ static void send_response(uint8_t resp_type, uint16_t frame_num)
     frame[4] = calc_checksum(&frame[0], 4);
     frame[5] = PROTO_STOP_MARK;
 
-    for (i = 0; i < 6; i++) {
-        Uart_SendData(UARTCH1, frame[i]);
+    (void)UARTIF_write(0, frame, sizeof(frame), UARTIF_TX_PRIORITY);
+
+    V2_LOG2(LOG_V2_TX_RESP, resp_type, frame_num);
+}
+
+static uint32_t now_ms(void)
+{
+    return (v2Tick != NULL) ? *v2Tick : 0u;
+}
+
+/**
+ * @brief Grant the window requested by CMD_START_WINDOW
+ */
+static void send_ready_window(void)
+{
+    uint8_t frame[6];
+
+    frame[0] = PROTO_START_MARK;
+    frame[1] = RESP_READY_WINDOW;
+    frame[2] = rx_ctx.window;
+    frame[3] = rx_ctx.sack_interval;
+    frame[4] = calc_checksum(&frame[0], 4);
+    frame[5] = PROTO_STOP_MARK;
+
+    (void)UARTIF_write(0, frame, sizeof(frame), UARTIF_TX_PRIORITY);
+    V2_LOG1(LOG_V2_TX_CTRL, RESP_READY_WINDOW);
+}
+
+/**
+ * @brief Send cumulative ACK + received bitmap (windowed mode)
+ * @note The host retransmits exactly the frames below its send point whose bit is clear
+ */
+static void send_sack(void)
+{
+    uint8_t frame[SACK_FRAME_LEN];
+    uint8_t i;
+
+    frame[0] = PROTO_START_MARK;
+    frame[1] = RESP_SACK;
+    frame[2] = (uint8_t)(rx_ctx.cum_ack & 0xFF);
+    frame[3] = (uint8_t)((rx_ctx.cum_ack >> 8) & 0xFF);
+    for (i = 0; i < 8; i++) {
+        frame[4 + i] = (uint8_t)(rx_ctx.frame_bitmap >> (8 * i));
+    }
+    frame[12] = calc_checksum(&frame[0], 12);
+    frame[13] = PROTO_STOP_MARK;
+
+    (void)UARTIF_write(0, frame, sizeof(frame), UARTIF_TX_PRIORITY);
+
+    rx_ctx.frames_since_sack = 0;
+    rx_ctx.last_sack_tick = now_ms();
+    V2_LOG2(LOG_V2_TX_RESP, RESP_SACK, rx_ctx.cum_ack);
+}
+
+/**
+ * @brief Answer CMD_HELLO with the capabilities shared by both links (see uart_interface.h)
+ * @note Does not touch the receive state, so a host may ask at any time
+ */
+static void send_caps(void)
+{
+    uint8_t frame[UARTIF_CAPS_LEN + 4];
+
+    frame[0] = PROTO_START_MARK;
+    frame[1] = RESP_CAPS;
+    UARTIF_getCaps(&frame[2]);
+    frame[UARTIF_CAPS_LEN + 2] = calc_checksum(&frame[0], UARTIF_CAPS_LEN + 2);
+    frame[UARTIF_CAPS_LEN + 3] = PROTO_STOP_MARK;
+
+    (void)UARTIF_write(0, frame, sizeof(frame), UARTIF_TX_PRIORITY);
+    V2_LOG1(LOG_V2_TX_CTRL, RESP_CAPS);
+}
+
+/**
+ * @brief Report a rejected data frame
+ * @note Windowed mode answers with a SACK: the frame number of a corrupt frame cannot be trusted
+ */
+static void reject_frame(uint8_t nak_code, uint16_t frame_num)
+{
+    if (rx_ctx.mode == RX_MODE_WINDOW) {
+        send_sack();
+    } else {
+        send_response(nak_code, frame_num);
+    }
+}
+
+/**
+ * @brief Windowed mode: advance the cumulative ACK and decide whether to SACK now
+ * @note SACK every sack_interval new frames, once per newly detected gap, and when the image is complete
+ */
+static void window_frame_stored(uint16_t frame_num)
+{
+    uint16_t cum_before = rx_ctx.cum_ack;
+
+    while (rx_ctx.cum_ack < IMAGE_PAGES && (rx_ctx.frame_bitmap & ((uint64_t)1 << rx_ctx.cum_ack))) {
+        rx_ctx.cum_ack++;
+    }
+    rx_ctx.frames_since_sack++;
+
+    if (rx_ctx.cum_ack >= IMAGE_PAGES || rx_ctx.frames_since_sack >= rx_ctx.sack_interval) {
+        send_sack();
+    } else if (frame_num != cum_before && rx_ctx.gap_cum != cum_before) {
+        // Out-of-order arrival: frame cum_before is missing, report the hole right away
+        rx_ctx.gap_cum = cum_before;
+        send_sack();
+    }
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Reset the receive context; frames in received are already in flash
+ */
+static void setup_rx(rx_mode_t mode, uint8_t window, uint64_t received)
+{
+    uint8_t i;
+
+    rx_ctx.state = RX_STATE_WAITING_DATA;
+    rx_ctx.mode = mode;
+    rx_ctx.frame_bitmap = received;
+    rx_ctx.total_frames_received = 0;
+    for (i = 0; i < IMAGE_PAGES; i++) {
+        if (received & ((uint64_t)1 << i)) {
+            rx_ctx.total_frames_received++;
+        }
+    }
+    rx_ctx.cum_ack = 0;
+    while (rx_ctx.cum_ack < IMAGE_PAGES && (received & ((uint64_t)1 << rx_ctx.cum_ack))) {
+        rx_ctx.cum_ack++;
+    }
+    rx_ctx.gap_cum = 0xFFFF;
+    rx_ctx.frames_since_sack = 0;
+    rx_ctx.resumable = 0;
+
+    if (window == 0) {
+        window = 1;
+    }
+    if (window > WINDOW_MAX) {
+        window = WINDOW_MAX;
+    }
+    rx_ctx.window = window;
+    // SACK after half a window so the host can refill before the window drains
+    rx_ctx.sack_interval = (uint8_t)((window >= 2) ? (window / 2) : 1);
+}
+
+/**
+ * @brief Start a plain (non-resumable) transfer and reserve flash for it
+ * @return 1 when the device is ready to receive
+ */
+static uint8_t start_transfer(rx_mode_t mode, uint8_t window)
+{
+    // Reserve the whole layer now so that garbage collection never stalls the data phase
+    FM_endTransfer();
+    if (FM_reserve(IMAGE_LAYER_PAGES) != FLASH_OK) {
+        rx_ctx.state = RX_STATE_IDLE;
+        send_ctrl_frame(RESP_FAIL);
+        return 0;
+    }
+
+    setup_rx(mode, window, 0);
+    return 1;
+}
+
+/**
+ * @brief CMD_BEGIN / CMD_RESUME: resumable transfer of one BW layer
+ * @note BEGIN records the transfer in flash; RESUME looks it up (also after a reboot) and
+ *       answers READY plus a SACK whose bitmap holds the frames already stored, so the host
+ *       sends only the gaps. An unknown ID, a changed image CRC or a garbage collection in
+ *       between makes RESUME fail: the host then starts over with BEGIN.
+ */
+static void resumable_transfer(uint8_t command, const uint8_t *frame)
+{
+    fm_transfer_t transfer;
+    uint64_t received = 0;
+    flash_result_t result;
+    uint8_t window = frame[3];
+
+    transfer.slotId = frame[2];
+    transfer.magic = MAGIC_BW_IMAGE_DATA;
+    transfer.transferId = get_le32(&frame[4]);
+    transfer.imageCrc = get_le32(&frame[8]);
+
+    if (command == CMD_BEGIN) {
+        result = FM_beginTransfer(&transfer);
+    } else {
+        result = FM_resumeTransfer(&transfer, &received);
+    }
+    if (result != FLASH_OK) {
+        rx_ctx.state = RX_STATE_IDLE;
+        send_ctrl_frame(RESP_FAIL);
+        return;
+    }
+
+    setup_rx((window > 1) ? RX_MODE_WINDOW : RX_MODE_STOP_WAIT, window, received);
+    rx_ctx.resumable = 1;
+    rx_ctx.current_slot_id = transfer.slotId;
+    if (rx_ctx.mode == RX_MODE_WINDOW) {
+        send_ready_window();
+    } else {
+        send_ctrl_frame(RESP_READY);
+    }
+    if (command == CMD_RESUME) {
+        V2_LOG4(LOG_V2_RESUME, transfer.transferId, transfer.slotId,
+             (uint32_t)(received >> 32), (uint32_t)received);
+        send_sack();
+    }
+}
+
+/**
+ * @brief CMD_MANIFEST: send the CRC32 stored in the page header of every frame of a slot
+ * @note Streamed in chunks to keep the stack small. The 32-byte priority lane drains
+ *       between chunks, so the frame is wrapped in UARTIF_holdPriority to keep
+ *       log/printf bytes out of it.
+ *       No image in the slot answers FAIL.
+ */
+static void send_manifest(uint8_t slot_id)
+{
+    uint8_t bytes[MANIFEST_CHUNK * 4];
+    uint32_t crcs[MANIFEST_CHUNK];
+    uint8_t sum = 0;
+    uint8_t first;
+    uint8_t n;
+    uint8_t i;
+    flash_result_t result;
+
+    for (first = 0; first < IMAGE_PAGES; first = (uint8_t)(first + n)) {
+        n = (uint8_t)((IMAGE_PAGES - first > MANIFEST_CHUNK) ? MANIFEST_CHUNK : (IMAGE_PAGES - first));
+        result = FM_readImageManifest(MAGIC_BW_IMAGE_DATA, slot_id, first, n, crcs);
+        if (result != FLASH_OK) {
+            if (first == 0) {
+                V2_LOG2(LOG_V2_MANIFEST, slot_id, result);
+                send_ctrl_frame(RESP_FAIL);
+                return;
+            }
+            // Frame already started: report the rest as changed so the host re-sends them
+            memset(crcs, 0, sizeof(crcs));
+        }
+        if (first == 0) {
+            bytes[0] = PROTO_START_MARK;
+            bytes[1] = RESP_MANIFEST;
+            bytes[2] = slot_id;
+            sum = calc_checksum(bytes, 3);
+            UARTIF_holdPriority(0, TRUE);
+            (void)UARTIF_write(0, bytes, 3, UARTIF_TX_PRIORITY);
+        }
+        for (i = 0; i < n; i++) {
+            bytes[4 * i] = (uint8_t)(crcs[i] & 0xFF);
+            bytes[4 * i + 1] = (uint8_t)((crcs[i] >> 8) & 0xFF);
+            bytes[4 * i + 2] = (uint8_t)((crcs[i] >> 16) & 0xFF);
+            bytes[4 * i + 3] = (uint8_t)((crcs[i] >> 24) & 0xFF);
+        }
+        sum = (uint8_t)(sum + calc_checksum(bytes, (uint16_t)(4 * n)));
+        (void)UARTIF_write(0, bytes, (uint16_t)(4 * n), UARTIF_TX_PRIORITY);
     }
+    bytes[0] = sum;
+    bytes[1] = PROTO_STOP_MARK;
+    (void)UARTIF_write(0, bytes, 2, UARTIF_TX_PRIORITY);
+    UARTIF_holdPriority(0, FALSE);
+    V2_LOG2(LOG_V2_MANIFEST, slot_id, FLASH_OK);
+}
 
-    // CRITICAL: Do NOT output debug log after sending response frame
-    // It will interfere with UART protocol communication
-    // Optional debug output (only when ENABLE_DEBUG_OUTPUT=1):
-    // DEBUG_PRINTF("[IMG_V2] TX RESP: type=0x%02X, frame=%d\r\n", resp_type, frame_num);
+/**
+ * @brief CMD_END_DELTA: commit a transfer that carried only the changed frames
+ * @note The new header points at the frames written by this transfer and at the
+ *       stored pages for all others, so unchanged frames are neither sent nor copied.
+ */
+static void end_delta(uint8_t slot_id)
+{
+    uint8_t slot_ok;
+
+    if (rx_ctx.state != RX_STATE_WAITING_DATA) {
+        send_ctrl_frame(RESP_FAIL);
+        return;
+    }
+    rx_ctx.state = RX_STATE_VERIFY_COMPLETE;
+
+    // Frames written for another slot cannot be part of this image
+    slot_ok = (uint8_t)((rx_ctx.resumable || rx_ctx.total_frames_received != 0) ? (rx_ctx.current_slot_id == slot_id) : 1);
+    if (slot_ok && FM_writeImageHeaderDelta(MAGIC_BW_IMAGE_HEADER, slot_id) == FLASH_OK) {
+        rx_ctx.current_slot_id = slot_id;
+        rx_ctx.state = RX_STATE_COMPLETE;
+        send_ctrl_frame(RESP_COMPLETE);
+    } else {
+        send_ctrl_frame(RESP_FAIL);
+    }
 }
 
 /**
  * @brief Process control frame (START/END)
  */
-static uint8_t process_ctrl_frame(void)
+static uint8_t process_ctrl_frame(const uint8_t *frame, uint16_t len)
 {
     uint8_t command;
     uint8_t checksum;
     uint8_t expected_checksum;
 
-    // Expected: [0x55, CMD, CHECKSUM, 0xAA]
-    if (rx_ctx.frame_idx < 4) {
-        DEBUG_PRINTF("[IMG_V2_DEBUG] CTRL frame incomplete: idx=%d/4\r\n", rx_ctx.frame_idx);
+    // Expected: [0x55, CMD, CHECKSUM, 0xAA], [0x55, CMD, ARG, CHECKSUM, 0xAA] or the 14-byte BEGIN/RESUME
+    if ((len != CTRL_FRAME_LEN && len != CTRL_WIN_FRAME_LEN && len != CTRL_XFER_FRAME_LEN)
+        || frame[len - 1] != PROTO_STOP_MARK) {
+        V2_LOG1(LOG_V2_CTRL_INCOMPLETE, len);
         return 0; // Not complete
     }
 
-    command = rx_ctx.frame_buf[1];
-    checksum = rx_ctx.frame_buf[2];
-    expected_checksum = calc_checksum(&rx_ctx.frame_buf[0], 2);
+    command = frame[1];
+    checksum = frame[len - 2];
+    expected_checksum = calc_checksum(&frame[0], (uint16_t)(len - 2));
 
-    DEBUG_PRINTF("[IMG_V2_DEBUG] CTRL frame check: cmd=0x%02X, checksum=%02X (expected=%02X)\r\n",
-                    command, checksum, expected_checksum);
+    V2_LOG3(LOG_V2_CTRL_CHECK, command, checksum, expected_checksum);
 
     if (checksum != expected_checksum) {
-        DEBUG_PRINTF("[IMG_V2] ERROR CTRL checksum error: got %02X, expected %02X\r\n", checksum, expected_checksum);
+        V2_LOG2(LOG_V2_CTRL_CHECKSUM, checksum, expected_checksum);
+        Router_CountError(ROUTE_V2);
         return 0;
     }
 
-    DEBUG_PRINTF("[IMG_V2] OK RX CTRL: cmd=0x%02X\r\n", command);
+    V2_LOG1(LOG_V2_CTRL_OK, command);
     return command;
 }
 
 /**
  * @brief Process data frame (image data only, no header)
  */
-static uint8_t process_data_frame(void)
+static uint8_t process_data_frame(const uint8_t *frame, uint16_t len)
 {
     uint8_t frame_type;
     uint16_t frame_num;
@@ -207,59 +522,73 @@ static uint8_t process_data_frame(void)
     uint32_t crc_rx;
     uint8_t checksum_rx;
     uint8_t checksum_calc;
-    uint8_t *payload;
+    const uint8_t *payload;
     uint32_t crc_calc;
     flash_result_t result;
     uint16_t data_key;
 
     // Expected: [0x55, FRAME_TYPE, FRAME_NUM_L, FRAME_NUM_H, SLOT_ID, CRC(4), PAYLOAD(248), CHECKSUM, 0xAA]
-    // frame_idx should be exactly 259 (including STOP_MARK)
-    if (rx_ctx.frame_idx != 259) {
-        DEBUG_PRINTF("[IMG_V2] ERROR: Frame size mismatch: idx=%d (expected=259)\r\n", rx_ctx.frame_idx);
+    // len should be exactly 259 (including STOP_MARK)
+    if (len != DATA_FRAME_LEN || frame[DATA_FRAME_LEN - 1] != PROTO_STOP_MARK) {
+        V2_LOG1(LOG_V2_FRAME_SIZE, len);
         // Extract frame number for NAK
-        if (rx_ctx.frame_idx >= 4) {
-            uint16_t frame_num = rx_ctx.frame_buf[2] | (rx_ctx.frame_buf[3] << 8);
-            send_response(RESP_NAK_INVALID_FRAME, frame_num);  // ✅ 详细错误代码：长度错误
+        if (len >= 4) {
+            frame_num = frame[2] | (frame[3] << 8);
+            reject_frame(RESP_NAK_INVALID_FRAME, frame_num);  // ✅ 详细错误代码：长度错误
         }
-        rx_ctx.frame_idx = 0;
         return 0; // Not valid
     }
 
-    frame_type = rx_ctx.frame_buf[1];
-    frame_num = rx_ctx.frame_buf[2] | (rx_ctx.frame_buf[3] << 8);
-    slot_id = rx_ctx.frame_buf[4];
-    crc_rx = rx_ctx.frame_buf[5] | (rx_ctx.frame_buf[6] << 8) |
-                      (rx_ctx.frame_buf[7] << 16) | (rx_ctx.frame_buf[8] << 24);
-    checksum_rx = rx_ctx.frame_buf[257];
-    checksum_calc = calc_checksum(&rx_ctx.frame_buf[0], 257);
+    frame_type = frame[1];
+    frame_num = frame[2] | (frame[3] << 8);
+    slot_id = frame[4];
+    crc_rx = frame[5] | (frame[6] << 8) |
+                      (frame[7] << 16) | (frame[8] << 24);
+    checksum_rx = frame[257];
+    checksum_calc = calc_checksum(&frame[0], 257);
 
     // Verify checksum
     if (checksum_rx != checksum_calc) {
-        DEBUG_PRINTF("[IMG_V2] DATA checksum error: rx=0x%02X, calc=0x%02X\r\n", checksum_rx, checksum_calc);
-        send_response(RESP_NAK_CHECKSUM, frame_num);  // ✅ 详细错误代码：Checksum 错误
-        rx_ctx.frame_idx = 0;
+        V2_LOG2(LOG_V2_DATA_CHECKSUM, checksum_rx, checksum_calc);
+        Router_CountError(ROUTE_V2);
+        reject_frame(RESP_NAK_CHECKSUM, frame_num);  // ✅ 详细错误代码：Checksum 错误
         return 0;
     }
 
     // Verify payload CRC
-    payload = &rx_ctx.frame_buf[9];
+    payload = &frame[9];
     crc_calc = calculate_crc32_default(payload, FRAME_PAYLOAD_SIZE);
 
     if (crc_rx != crc_calc) {
-        DEBUG_PRINTF("[IMG_V2] DATA CRC error: rx=0x%08lX, calc=0x%08lX\r\n", crc_rx, crc_calc);
-        send_response(RESP_NAK_CRC, frame_num);  // ✅ 详细错误代码：CRC 错误
-        rx_ctx.frame_idx = 0;
+        V2_LOG2(LOG_V2_DATA_CRC, crc_rx, crc_calc);
+        reject_frame(RESP_NAK_CRC, frame_num);  // ✅ 详细错误代码：CRC 错误
         return 0;
     }
 
     // Verify frame number is valid (0-60)
     if (frame_num > MAX_FRAME_NUM) {
-        DEBUG_PRINTF("[IMG_V2] Invalid frame_num: %d (max=%d)\r\n", frame_num, MAX_FRAME_NUM);
-        send_response(RESP_NAK_INVALID_FRAME, frame_num);  // ✅ 详细错误代码：帧号超范围
-        rx_ctx.frame_idx = 0;
+        V2_LOG2(LOG_V2_FRAME_NUM, frame_num, MAX_FRAME_NUM);
+        reject_frame(RESP_NAK_INVALID_FRAME, frame_num);  // ✅ 详细错误代码：帧号超范围
         return 0;
     }
 
+    // A resumable transfer owns one slot: a frame for another slot would end up in the wrong image
+    if (rx_ctx.resumable && slot_id != rx_ctx.current_slot_id) {
+        V2_LOG3(LOG_V2_SLOT_MISMATCH, frame_num, slot_id, rx_ctx.current_slot_id);
+        reject_frame(RESP_NAK_INVALID_FRAME, frame_num);
+        return 0;
+    }
+
+    // Retransmission of a frame already stored: acknowledge again without writing a second copy
+    if (rx_ctx.frame_bitmap & ((uint64_t)1 << frame_num)) {
+        if (rx_ctx.mode == RX_MODE_WINDOW) {
+            send_sack();
+        } else {
+            send_response(RESP_ACK, frame_num);
+        }
+        return 1;
+    }
+
     // Save frame info
     rx_ctx.current_frame_num = frame_num;
     rx_ctx.current_slot_id = slot_id;
@@ -271,15 +600,18 @@ static uint8_t process_data_frame(void)
     if (result == FLASH_OK) {
         rx_ctx.frame_bitmap |= ((uint64_t)1 << frame_num);
         rx_ctx.total_frames_received++;
-        DEBUG_PRINTF("[IMG_V2] Frame %d saved (total=%u): bitmap=0x%016llX\r\n",
-                         frame_num, rx_ctx.total_frames_received, rx_ctx.frame_bitmap);
-        send_response(RESP_ACK, frame_num);
+        V2_LOG4(LOG_V2_FRAME_SAVED, frame_num, rx_ctx.total_frames_received,
+             (uint32_t)(rx_ctx.frame_bitmap >> 32), (uint32_t)rx_ctx.frame_bitmap);
+        if (rx_ctx.mode == RX_MODE_WINDOW) {
+            window_frame_stored(frame_num);
+        } else {
+            send_response(RESP_ACK, frame_num);
+        }
     } else {
-        DEBUG_PRINTF("[IMG_V2] Frame write failed: %d\r\n", result);
-        send_response(RESP_NAK_FLASH_WRITE_FAIL, frame_num);  // ✅ 详细错误代码：Flash 写入失败
+        V2_LOG1(LOG_V2_WRITE_FAIL, result);
+        reject_frame(RESP_NAK_FLASH_WRITE_FAIL, frame_num);  // ✅ 详细错误代码：Flash 写入失败
     }
 
-    rx_ctx.frame_idx = 0;
     return 1; // Frame processed
 }
 
@@ -291,172 +623,171 @@ void ImageTransferV2_Init(void)
 {
     memset(&rx_ctx, 0, sizeof(rx_context_t));
     rx_ctx.state = RX_STATE_IDLE;
+    UARTIF_enableV2Framing(TRUE);
     UARTIF_uartPrintf(0, "[IMG_V2] Protocol V2 initialized\r\n");
     UARTIF_uartPrintf(0, "[IMG_V2] MAX_RETRIES=%d, IMAGE_PAGES=%d\r\n", MAX_RETRIES, IMAGE_PAGES);
     UARTIF_uartPrintf(0, "[IMG_V2] FRAME_PAYLOAD_SIZE=%d, TIMEOUT_FRAME=%dms\r\n", FRAME_PAYLOAD_SIZE, TIMEOUT_FRAME);
 }
 
+/**
+ * @brief Assemble V2 frames in the UART1 RX interrupt (protocol router handler)
+ * @note The router starts a frame on START_MARK; the frame length comes from the
+ *       type byte and the bytes go to a frame pool slot. Without a free slot the
+ *       frame is still consumed, so its bytes do not leak to the other protocols.
+ *       Checksum/CRC are verified in the main loop.
+ * @return ROUTE_xxx
+ */
+uint8_t ImageTransferV2_RxByte(uint8_t byte, uint8_t first)
+{
+    if (first) {
+        rx_slot = FramePool_Claim(FRAME_SRC_UART_V2);  // NULL: frame dropped (host will retry on timeout)
+        rx_pos = 0;
+        rx_need = CTRL_FRAME_LEN;
+    }
+
+    if (rx_slot != NULL) {
+        rx_slot->data[rx_pos] = byte;
+    }
+    rx_pos++;
+
+    if (rx_pos == 2) {
+        if (byte == CMD_START || byte == CMD_END || byte == CMD_HELLO) {
+            rx_need = CTRL_FRAME_LEN;
+        } else if (byte == CMD_START_WINDOW || byte == CMD_MANIFEST || byte == CMD_END_DELTA) {
+            rx_need = CTRL_WIN_FRAME_LEN;
+        } else if (byte == CMD_BEGIN || byte == CMD_RESUME) {
+            rx_need = CTRL_XFER_FRAME_LEN;
+        } else if (byte == FRAME_TYPE_IMAGE_DATA) {
+            rx_need = DATA_FRAME_LEN;
+        } else if (byte == PROTO_START_MARK) {
+            rx_pos = 1;  // Resync on the new START_MARK
+        } else {
+            // Not a V2 frame: give the byte back to the router
+            if (rx_slot != NULL) {
+                FramePool_Abort(rx_slot);
+                rx_slot = NULL;
+            }
+            return ROUTE_ERROR | ROUTE_AGAIN;
+        }
+        return ROUTE_MORE;
+    }
+
+    if (rx_pos < 2 || rx_pos < rx_need) {
+        return ROUTE_MORE;
+    }
+    if (rx_slot == NULL) {
+        return ROUTE_ERROR;
+    }
+    rx_slot->len = rx_pos;
+    FramePool_Commit(rx_slot);
+    rx_slot = NULL;
+    return ROUTE_DONE;
+}
+
+/**
+ * @brief Handle one complete V2 frame taken from the frame pool
+ */
+void ImageTransferV2_HandleFrame(const uint8_t *frame, uint16_t len)
+{
+    uint8_t frame_type;
+    uint8_t cmd;
+    uint16_t frame_num;
+    uint64_t expected_bitmap;
+    flash_result_t header_result;
+
+    rx_ctx.timeout_counter = 0;
+    rx_ctx.last_rx_tick = now_ms();
+    frame_type = frame[1];
+
+    if (frame_type == CMD_START || frame_type == CMD_END || frame_type == CMD_START_WINDOW
+        || frame_type == CMD_BEGIN || frame_type == CMD_RESUME
+        || frame_type == CMD_MANIFEST || frame_type == CMD_END_DELTA || frame_type == CMD_HELLO) {
+        cmd = process_ctrl_frame(frame, len);
+        if (cmd == CMD_START) {
+            // Reset state and bitmap for new transfer
+            if (start_transfer(RX_MODE_STOP_WAIT, 1)) {
+                send_ctrl_frame(RESP_READY);
+            }
+        } else if (cmd == CMD_START_WINDOW) {
+            // Window requested by the host, clamped to what the frame pool can hold
+            if (start_transfer(RX_MODE_WINDOW, frame[2])) {
+                send_ready_window();
+            }
+        } else if ((cmd == CMD_BEGIN || cmd == CMD_RESUME) && len == CTRL_XFER_FRAME_LEN) {
+            resumable_transfer(cmd, frame);
+        } else if (cmd == CMD_HELLO && len == CTRL_FRAME_LEN) {
+            send_caps();
+        } else if (cmd == CMD_MANIFEST && len == CTRL_WIN_FRAME_LEN) {
+            send_manifest(frame[2]);
+        } else if (cmd == CMD_END_DELTA && len == CTRL_WIN_FRAME_LEN) {
+            end_delta(frame[2]);
+        } else if (cmd == CMD_END) {
+            rx_ctx.state = RX_STATE_VERIFY_COMPLETE;
+
+            // Verify integrity: Check if all 61 frames received
+            expected_bitmap = ((uint64_t)1 << IMAGE_PAGES) - 1; // All 61 bits set
+
+            if ((rx_ctx.frame_bitmap & expected_bitmap) == expected_bitmap) {
+                // All frames verified! Now write image header automatically
+                header_result = FM_writeImageHeader(MAGIC_BW_IMAGE_HEADER, rx_ctx.current_slot_id);
+
+                if (header_result == FLASH_OK) {
+                    rx_ctx.state = RX_STATE_COMPLETE;
+                    send_ctrl_frame(RESP_COMPLETE);
+                } else {
+                    send_ctrl_frame(RESP_FAIL);
+                }
+            } else {
+                send_ctrl_frame(RESP_FAIL);
+            }
+        }
+    } else if (frame_type == FRAME_TYPE_IMAGE_DATA) {
+        if (rx_ctx.state == RX_STATE_WAITING_DATA) {
+            (void)process_data_frame(frame, len);
+            // Continue waiting for more frames
+        } else {
+            // Must NAK if state is wrong, otherwise PC waits for a response forever
+            frame_num = frame[2] | (frame[3] << 8);
+            V2_LOG2(LOG_V2_STATE_MISMATCH, rx_ctx.state, RX_STATE_WAITING_DATA);
+            send_response(RESP_NAK_STATE_MISMATCH, frame_num);  // ✅ 详细错误代码：状态不匹配
+        }
+    }
+}
+
 void ImageTransferV2_Process(void)
 {
-    uint8_t temp_buf[259];
-    uint16_t temp_idx = 0u;
-    uint16_t counter;
-    counter = UARTIF_fetchDataFromUart(temp_buf, &temp_idx);
-    if (counter > 0u)
-    {
-        UARTIF_uartPrintf(0, "counter is %d\n", counter);
-        UARTIF_uartPrintf(0, "temp_idx is %d\n", temp_idx);
-        UARTIF_uartPrintf(0, "temp_buf[0] is 0x%02x\n", temp_buf[0]);
-        UARTIF_uartPrintf(0, "temp_buf[1] is 0x%02x\n", temp_buf[1]);
-        // UARTIF_uartPrintf(0, "temp_buf[2] is 0x02%x\n", temp_buf[2]);
-        // UARTIF_uartPrintf(0, "temp_buf[temp_idx-1] is 0x02%x\n", temp_buf[temp_idx-1u]);
-        UARTIF_uartPrintf(0, "temp_buf[temp_idx-2] is 0x%02x\n", temp_buf[temp_idx-2u]);
-        UARTIF_uartPrintf(0, "temp_buf[temp_idx-1] is 0x%02x\n", temp_buf[temp_idx-1u]);
+    uint32_t now;
+    uint32_t idle;
 
+    // Frames are handled as they come out of the frame pool; only timers live here
+    if (rx_ctx.state == RX_STATE_IDLE) {
+        return;
     }
 
+    now = now_ms();
+    idle = now - rx_ctx.last_rx_tick;
+
+    if (idle > TIMEOUT_FRAME && rx_ctx.timeout_counter == 0) {
+        rx_ctx.timeout_counter = idle;
+        V2_LOG2(LOG_V2_TIMEOUT, rx_ctx.state, rx_ctx.timeout_counter);
+    }
+
+    // Windowed: if frames are still missing and the link went quiet (lost tail frames or a lost SACK),
+    // repeat the SACK so the host can retransmit; give up repeating once the host looks gone
+    if (rx_ctx.mode == RX_MODE_WINDOW && rx_ctx.state == RX_STATE_WAITING_DATA
+        && rx_ctx.cum_ack < IMAGE_PAGES && idle < TIMEOUT_IDLE
+        && (now - rx_ctx.last_sack_tick) >= TIMEOUT_SACK && idle >= TIMEOUT_SACK) {
+        send_sack();
+    }
 }
 
-// void ImageTransferV2_Process(void)
-// {
-//     uint8_t byte;
-//     uint16_t bytes_fetched;
-//     uint8_t temp_buf[259];
-//     uint16_t temp_idx;
-//     uint16_t i;
-//     uint8_t frame_type;
-//     uint8_t result;
-//     uint8_t cmd;
-//     uint16_t expected_frames;
-//     uint64_t expected_bitmap;
-//     flash_result_t header_result;
-//     // Try to fetch data from UART queue
-//     temp_idx = 0;
-//     // UARTIF_uartPrintf(0, "IT\r\n");
-
-//     bytes_fetched = UARTIF_fetchDataFromUart(temp_buf, &temp_idx);
-
-//     if (bytes_fetched == 0) {
-//         rx_ctx.timeout_counter++;
-//         if (rx_ctx.timeout_counter > TIMEOUT_FRAME && rx_ctx.state != RX_STATE_IDLE) {
-//             DEBUG_PRINTF("[IMG_V2] TIMEOUT in state %d (counter=%u)\r\n",
-//                             rx_ctx.state, rx_ctx.timeout_counter);
-//             rx_ctx.timeout_counter = 0;
-//         }
-//         return;
-//     }
-
-//     // ==================== Debug: Output received data ====================
-//     // DISABLED: Debug output during data transfer can interfere with UART communication
-//     // Uncomment only for troubleshooting if needed
-//     // UARTIF_uartPrintf(0, "[IMG_V2] RX %d bytes: ", bytes_fetched);
-//     // for (i = 0; i < temp_idx && i < 20; i++) {
-//     //     UARTIF_uartPrintf(0, "%02X ", temp_buf[i]);
-//     // }
-//     // if (temp_idx > 20) {
-//     //     UARTIF_uartPrintf(0, "...");
-//     // }
-//     // UARTIF_uartPrintf(0, " [state=%d]\r\n", rx_ctx.state);
-
-//     // Process fetched bytes
-//     for (i = 0; i < temp_idx; i++) {
-//         byte = temp_buf[i];
-
-//         // Look for START_MARK
-//         if (byte == PROTO_START_MARK) {
-//             rx_ctx.frame_idx = 0;
-//             rx_ctx.frame_buf[rx_ctx.frame_idx++] = byte;
-//             rx_ctx.timeout_counter = 0;
-//             continue;
-//         }
-
-//         // If not in frame, skip
-//         if (rx_ctx.frame_idx == 0) {
-//             continue;
-//         }
-
-//         // Add to frame
-//         if (rx_ctx.frame_idx < 259) {
-//             rx_ctx.frame_buf[rx_ctx.frame_idx++] = byte;
-//         } else {
-//             // CRITICAL: Frame buffer overflow detected
-//             // This means frame was too long without STOP_MARK
-//             // Send detailed NAK to notify PC of the error
-//             DEBUG_PRINTF("[IMG_V2] ERROR: Frame buffer overflow at idx=%d, resetting\r\n", rx_ctx.frame_idx);
-
-//             // Extract frame_num if possible (need at least 4 bytes)
-//             if (rx_ctx.frame_idx >= 4) {
-//                 uint16_t frame_num = rx_ctx.frame_buf[2] | (rx_ctx.frame_buf[3] << 8);
-//                 send_response(RESP_NAK_BUFFER_OVERFLOW, frame_num);  // ✅ 详细错误代码：缓冲区溢出
-//             }
-
-//             rx_ctx.frame_idx = 0;
-//             continue;
-//         }
-
-//         // Check for STOP_MARK
-//         if (byte == PROTO_STOP_MARK && rx_ctx.frame_idx >= 4) {
-//             // Try to process frame
-//             frame_type = rx_ctx.frame_buf[1];
-//             result = 0;
-
-//             if (frame_type == CMD_START || frame_type == CMD_END) {
-//                 cmd = process_ctrl_frame();
-//                 if (cmd == CMD_START) {
-//                     // Reset state and bitmap for new transfer
-//                     rx_ctx.state = RX_STATE_WAITING_DATA;
-//                     rx_ctx.frame_bitmap = 0;
-//                     rx_ctx.total_frames_received = 0;
-//                     send_ctrl_frame(RESP_READY);
-//                     // CRITICAL: Do NOT output log after sending READY
-//                     // It will interfere with PC understanding UART protocol
-//                     // DEBUG_PRINTF("[IMG_V2] Transfer started, waiting for 61 data frames...\r\n");
-//                 } else if (cmd == CMD_END) {
-//                     rx_ctx.state = RX_STATE_VERIFY_COMPLETE;
-
-//                     // Verify integrity: Check if all 61 frames received
-//                     expected_frames = IMAGE_PAGES; // 61 frames (0-60)
-//                     expected_bitmap = ((uint64_t)1 << IMAGE_PAGES) - 1; // All 61 bits set
-
-//                     if ((rx_ctx.frame_bitmap & expected_bitmap) == expected_bitmap) {
-//                         // All frames verified! Now write image header automatically
-//                         header_result = FM_writeImageHeader(MAGIC_BW_IMAGE_HEADER, rx_ctx.current_slot_id);
-
-//                         if (header_result == FLASH_OK) {
-//                             rx_ctx.state = RX_STATE_COMPLETE;
-//                             send_ctrl_frame(RESP_COMPLETE);
-//                             // CRITICAL: Do NOT output log after sending COMPLETE
-//                             // DEBUG_PRINTF("[IMG_V2] OK Transfer COMPLETE! All %u frames verified, header written (slot=%d)\r\n",
-//                             //                          rx_ctx.total_frames_received, rx_ctx.current_slot_id);
-//                         } else {
-//                             send_ctrl_frame(RESP_FAIL);
-//                             // DEBUG_PRINTF("[IMG_V2] ERROR Header write failed: %d\r\n", header_result);
-//                         }
-//                     } else {
-//                         send_ctrl_frame(RESP_FAIL);
-//                         // CRITICAL: Do NOT output log after sending FAIL
-//                         // DEBUG_PRINTF("[IMG_V2] ERROR Transfer FAILED! Missing frames. Bitmap=0x%016llX, Expected=0x%016llX\r\n",
-//                         //                         rx_ctx.frame_bitmap, expected_bitmap);
-//                     }
-//                 }
-//                 rx_ctx.frame_idx = 0;
-//             } else if (frame_type == FRAME_TYPE_IMAGE_DATA) {
-//                 if (rx_ctx.state == RX_STATE_WAITING_DATA) {
-//                     result = process_data_frame();
-//                     // Continue waiting for more frames
-//                 } else {
-//                     // CRITICAL FIX: Must send NAK if state is wrong
-//                     // Otherwise frame_idx is never reset and protocol hangs
-//                     uint16_t frame_num = rx_ctx.frame_buf[2] | (rx_ctx.frame_buf[3] << 8);
-//                     DEBUG_PRINTF("[IMG_V2] ERROR: Received data frame but state=%d (expected=%d), sending NAK\r\n",
-//                                 rx_ctx.state, RX_STATE_WAITING_DATA);
-//                     send_response(RESP_NAK_STATE_MISMATCH, frame_num);  // ✅ 详细错误代码：状态不匹配
-//                     rx_ctx.frame_idx = 0;  // CRITICAL: Reset frame buffer
-//                 }
-//             }
-//         }
-//     }
-// }
+/**
+ * @brief Set the millisecond tick used for protocol timers
+ */
+void ImageTransferV2_SetTickSource(const volatile uint32_t *tickMs)
+{
+    v2Tick = tickMs;
+}
 
 /**
  * @brief Get transfer statistics
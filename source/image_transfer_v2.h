@@ -29,10 +29,29 @@ typedef struct {
 void ImageTransferV2_Init(void);
 
 /**
- * @brief Process image transfer (call periodically, e.g., 1ms)
+ * @brief Process protocol timers (call from the main loop)
  */
 void ImageTransferV2_Process(void);
 
+/**
+ * @brief Set the millisecond tick used for timeouts and SACK repeats
+ */
+void ImageTransferV2_SetTickSource(const volatile uint32_t *tickMs);
+
+/**
+ * @brief Feed one received byte to the V2 framer (UART1 protocol router handler, RX ISR)
+ * @param first Non-zero for the START mark that opened the frame
+ * @return ROUTE_xxx (proto_router.h)
+ */
+uint8_t ImageTransferV2_RxByte(uint8_t byte, uint8_t first);
+
+/**
+ * @brief Handle one complete frame assembled by ImageTransferV2_RxByte()
+ * @param frame Frame bytes, starting with the 0x55 START mark
+ * @param len Frame length
+ */
+void ImageTransferV2_HandleFrame(const uint8_t *frame, uint16_t len);
+
 /**
  * @brief Get transfer statistics
  */
@@ -0,0 +1,101 @@
+/******************************************************************************
+ ** @file log.c
+ **
+ ** @brief 二进制日志：记录写入 RAM 队列，由主循环按串口发送空间输出
+ **
+ ******************************************************************************/
+
+/******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include "base_types.h"
+#include "hc32l110.h"
+#include "queue.h"
+#include "uart_interface.h"
+#include "log.h"
+
+/******************************************************************************
+ * Local variable definitions ('static')                                      *
+ ******************************************************************************/
+static Queue logRing;
+static uint8_t logStorage[LOG_RING_SIZE];
+static const volatile uint32_t *logTick = NULL;
+static uint32_t logDropCount = 0;
+
+/*****************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+
+static void putLe32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// 设置时间戳来源
+void LOG_SetTickSource(const volatile uint32_t *tickMs)
+{
+    logTick = tickMs;
+}
+
+// 写入一条日志记录
+void LOG_write(uint16_t id, uint8_t argc, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    uint8_t rec[8 + 4 * LOG_MAX_ARGS];
+    uint16_t len;
+    uint32_t primask;
+
+    if (argc > LOG_MAX_ARGS) {
+        argc = LOG_MAX_ARGS;
+    }
+    rec[0] = LOG_SYNC;
+    rec[1] = (uint8_t)id;
+    rec[2] = (uint8_t)(id >> 8);
+    rec[3] = argc;
+    putLe32(&rec[4], (logTick != NULL) ? *logTick : 0u);
+    putLe32(&rec[8], a0);
+    putLe32(&rec[12], a1);
+    putLe32(&rec[16], a2);
+    putLe32(&rec[20], a3);
+    len = (uint16_t)(8u + 4u * argc);
+
+    // 主循环和中断都可能写日志，入队期间关中断，保证记录完整且不交错
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (logRing.buffer == NULL) {
+        Queue_Init(&logRing, logStorage, sizeof(logStorage));
+    }
+    if (!Queue_EnqueueBuf(&logRing, rec, len)) {
+        logDropCount++;
+    }
+    __set_PRIMASK(primask);
+}
+
+// 按串口发送队列剩余空间输出，不等待
+void LOG_flush(void)
+{
+    const uint8_t *span;
+    uint16_t spanLen;
+    uint16_t space;
+
+    if (logRing.buffer == NULL) {
+        return;
+    }
+    space = UARTIF_txSpace(LOG_UART);
+    while (space > 0 && (spanLen = Queue_Peek(&logRing, &span)) > 0) {
+        if (spanLen > space) {
+            spanLen = space;
+        }
+        (void)UARTIF_write(LOG_UART, span, spanLen, UARTIF_TX_LOG);
+        Queue_Consume(&logRing, spanLen);
+        space = (uint16_t)(space - spanLen);
+    }
+}
+
+// 丢弃的记录数
+uint32_t LOG_GetDropCount(void)
+{
+    return logDropCount;
+}
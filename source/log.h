@@ -0,0 +1,35 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include "log_fmt.h"
+
+/*
+ * 二进制日志：调用处只写入 id、时间戳和参数，不做格式化
+ * 记录格式：SYNC(0xA5) | ID(2B LE) | ARGC(1B) | TICK_MS(4B LE) | ARGS(ARGC x 4B LE)
+ * 记录先进入 RAM 环形队列，主循环调用 LOG_flush() 按发送队列空间送到串口
+ */
+#define LOG_SYNC            0xA5
+#define LOG_MAX_ARGS        4
+#define LOG_RING_SIZE       64      // 必须是2的幂，最长记录 24 字节
+#define LOG_UART            0       // 输出串口：0 为 UART1
+
+#define LOG0(id)                LOG_write((id), 0, 0, 0, 0, 0)
+#define LOG1(id, a)             LOG_write((id), 1, (uint32_t)(a), 0, 0, 0)
+#define LOG2(id, a, b)          LOG_write((id), 2, (uint32_t)(a), (uint32_t)(b), 0, 0)
+#define LOG3(id, a, b, c)       LOG_write((id), 3, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), 0)
+#define LOG4(id, a, b, c, d)    LOG_write((id), 4, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d))
+
+// 设置时间戳来源（毫秒计数），未设置时时间戳为 0
+void LOG_SetTickSource(const volatile uint32_t *tickMs);
+
+// 写入一条日志记录，队列满时丢弃整条记录；可在中断中调用
+void LOG_write(uint16_t id, uint8_t argc, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+// 把队列中的记录送到串口发送队列（主循环调用）
+void LOG_flush(void);
+
+// 因队列满而丢弃的记录数
+uint32_t LOG_GetDropCount(void);
+
+#endif // LOG_H
@@ -0,0 +1,70 @@
+#ifndef LOG_FMT_H
+#define LOG_FMT_H
+
+/*
+ * 二进制日志格式表：X(id, "format")
+ * 固件只使用 id，格式字符串不进入固件，由 tools/log_decode.py 解析本文件还原文本。
+ * 参数一律按 32 位无符号传递，格式中可用 %d %u %x %X %c 及 l/ll 修饰（%s 不支持）。
+ * id 按表中顺序编号：只在末尾追加新条目，不要删除或插入，否则旧日志无法解码。
+ */
+#define LOG_FORMAT_TABLE(X) \
+    X(LOG_FM_RESET_SEGMENT,     "flash_manager: reset segment %u") \
+    X(LOG_FM_LAST_BLOCK,        "flash_manager found last block") \
+    X(LOG_FM_LAST_BLOCK_ERR,    "ERR: flash_manager 0x07! last block error") \
+    X(LOG_FM_UNKNOWN_MAGIC,     "ERR: flash_manager 0x06! unknow magic 0x%02x at 0x%06lx") \
+    X(LOG_FM_NEXT_WRITE,        "flash_manager next write address is 0x%04x") \
+    X(LOG_FM_FRAME_RANGE,       "ERR: flash_manager 0x09! image frame num out of range: %d") \
+    X(LOG_FM_FRAME_LOST,        "ERR: scanImageDataPages frame lost") \
+    X(LOG_FM_GC_ONGOING,        "Gc on going!") \
+    X(LOG_FM_GO_GC,             "go to gc %u") \
+    X(LOG_FM_CHIP_ERASE,        "flash_manager: chip erase (block plan %lu x100us)") \
+    X(LOG_FM_ERASE_RANGE,       "flash_manager: erase 0x%06lx - 0x%06lx") \
+    X(LOG_FM_COPY_DATA_FAIL,    "ERR: flash_manager 0x10! copy data page fail entry %d") \
+    X(LOG_FM_COPY_HEADER_FAIL,  "ERR: flash_manager 0x10! read image header into buffer fail") \
+    X(LOG_FM_COPY_IMAGE_FAIL,   "ERR: flash_manager 0x10! copy image data page fail entry %d frame %d") \
+    X(LOG_FM_UNKNOWN_FLASH,     "WARN: flash_manager unknown flash, use default size") \
+    X(LOG_FM_GEOMETRY,          "flash_manager flash id 0x%06lx size 0x%lx, segment size 0x%lx") \
+    X(LOG_FM_REGC_LOW,          "regc flash_manager low active") \
+    X(LOG_FM_REGC_HIGH,         "regc flash_manager high active") \
+    X(LOG_FM_REGC_RESET,        "flash_manager no active segment, reset 2 segments") \
+    X(LOG_FM_REGC_ERR,          "ERR: flash_manager 0x09! regc error, reset 2 segments") \
+    X(LOG_FM_GC_START,          "flash_manager start garbage collecting!") \
+    X(LOG_FM_GC_STEP,           "flash_manager garbage collecting step %u") \
+    X(LOG_FM_GC_HEADER_FAIL,    "ERR: flash_manager 0x08! write image header fail entry %d, type %d") \
+    X(LOG_FM_GC_DONE,           "flash_manager garbage collecting finished successfully!") \
+    X(LOG_FM_GC_ERR,            "ERR: flash_manager 0x08! gc error: %d") \
+    X(LOG_FM_HEADER_ERR,        "ERR: flash_manager 0x04! header%u error") \
+    X(LOG_FM_LOW_ACTIVE,        "flash_manager low active") \
+    X(LOG_FM_HIGH_ACTIVE,       "flash_manager high active") \
+    X(LOG_FM_GC_REDO,           "flash_manager GC redo!") \
+    X(LOG_FM_INIT_SG0,          "flash_manager start to init sg 0 else!") \
+    X(LOG_FM_RESERVE_GC,        "flash_manager reserve %d pages, free %d, go to gc") \
+    X(LOG_V2_TX_CTRL,           "[IMG_V2] TX CTRL: 0x%02X") \
+    X(LOG_V2_TX_RESP,           "[IMG_V2] TX RESP: type=0x%02X, frame=%d") \
+    X(LOG_V2_CTRL_INCOMPLETE,   "[IMG_V2_DEBUG] CTRL frame incomplete: len=%d/4") \
+    X(LOG_V2_CTRL_CHECK,        "[IMG_V2_DEBUG] CTRL frame check: cmd=0x%02X, checksum=%02X (expected=%02X)") \
+    X(LOG_V2_CTRL_CHECKSUM,     "[IMG_V2] ERROR CTRL checksum error: got %02X, expected %02X") \
+    X(LOG_V2_CTRL_OK,           "[IMG_V2] OK RX CTRL: cmd=0x%02X") \
+    X(LOG_V2_FRAME_SIZE,        "[IMG_V2] ERROR: Frame size mismatch: len=%d (expected=259)") \
+    X(LOG_V2_DATA_CHECKSUM,     "[IMG_V2] DATA checksum error: rx=0x%02X, calc=0x%02X") \
+    X(LOG_V2_DATA_CRC,          "[IMG_V2] DATA CRC error: rx=0x%08lX, calc=0x%08lX") \
+    X(LOG_V2_FRAME_NUM,         "[IMG_V2] Invalid frame_num: %d (max=%d)") \
+    X(LOG_V2_FRAME_SAVED,       "[IMG_V2] Frame %d saved (total=%u): bitmap=0x%08lX%08lX") \
+    X(LOG_V2_WRITE_FAIL,        "[IMG_V2] Frame write failed: %d") \
+    X(LOG_V2_STATE_MISMATCH,    "[IMG_V2] ERROR: Received data frame but state=%d (expected=%d), sending NAK") \
+    X(LOG_V2_TIMEOUT,           "[IMG_V2] TIMEOUT in state %d (counter=%u)") \
+    X(LOG_FM_TRANSFER_BEGIN,    "flash_manager transfer 0x%08lx begin: slot %u magic 0x%02x from page 0x%04x") \
+    X(LOG_FM_TRANSFER_RESUME,   "flash_manager transfer 0x%08lx resume: result %d, %u frames missing") \
+    X(LOG_V2_RESUME,            "[IMG_V2] RESUME transfer 0x%08lX slot %u: bitmap=0x%08lX%08lX") \
+    X(LOG_V2_SLOT_MISMATCH,     "[IMG_V2] Frame %d for slot %u, transfer slot %u") \
+    X(LOG_FM_IMAGE_DELTA,       "flash_manager delta image magic 0x%02x slot %u: %u new frames") \
+    X(LOG_V2_MANIFEST,          "[IMG_V2] MANIFEST slot %u: result %d")
+
+typedef enum {
+#define LOG_FMT_ENUM(id, fmt)   id,
+    LOG_FORMAT_TABLE(LOG_FMT_ENUM)
+#undef LOG_FMT_ENUM
+    LOG_ID_COUNT
+} log_id_t;
+
+#endif // LOG_FMT_H
@@ -44,6 +44,7 @@
 #include "w25q32.h"
 #include "flash_manager.h"
 #include "image_transfer_v2.h"
+#include "log.h"
 // #include "testCase.h"
 #include <stdlib.h>
 
@@ -600,6 +601,9 @@ int32_t main(void)
     E104_setSleepMode();
 
     timInit();
+    W25Q32_SetTickSource(&g_u32SystemTick, 20);  // 长时间擦除期间睡眠等待
+    LOG_SetTickSource(&g_u32SystemTick);         // 日志时间戳
+    ImageTransferV2_SetTickSource(&g_u32SystemTick);
 
     EPD_initGDEY042Z98();
     
@@ -741,6 +745,8 @@ int32_t main(void)
     while(1)
     {
         UARTIF_passThrough();
+        W25Q32_Poll();  // 后台擦除/编程完成时触发回调
+        LOG_flush();
         //UARTIF_uartPrintf(0, "%d", currentImageSlot);
 
         if (rotation == 1) {
@@ -765,12 +771,8 @@ int32_t main(void)
             rotation = 0;  // Reset rotation after handling
         }
 
-        // 5ms task: image transfer processing
-        // if (tg5ms)
-        // {
-        //     tg5ms = FALSE;
-        //     ImageTransferV2_Process();
-        // }
+        // 图像传输 V2 协议定时（超时、窗口模式 SACK 重发），未初始化时直接返回
+        ImageTransferV2_Process();
             // 如果串口/任务空闲且编码器无动作，则在进入睡眠前临时屏蔽短周期中断和串口中断，清除挂起标志，
         // 以避免噪声或未处理数据导致频繁唤醒。唤醒后恢复中断。
         // 如果处于交互模式且超时（30s）则退出交互模式，允许进入睡眠
@@ -797,6 +799,11 @@ int32_t main(void)
             Gpio_ClearIrq(2, 6);
             Gpio_ClearIrq(2, 5);
             UARTIF_uartPrintf(0, "sleep--\n");
+            LOG_flush();
+            UARTIF_flushTx();  // 发送完成中断会唤醒 MCU，先把发送队列发完
+
+            // flash 进入深度掉电，唤醒后第一次访问时自动退出
+            W25Q32_PowerDown();
 
             // 进入低功耗等待（WFI），任一已使能的中断将唤醒
             Lpm_GotoLpmMode();
@@ -0,0 +1,171 @@
+/******************************************************************************
+ ** @file proto_router.c
+ **
+ ** @brief 串口协议路由：按同步字节把每帧交给一个协议处理函数，并按协议统计
+ **
+ ******************************************************************************/
+
+/******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stddef.h>
+#include "hc32l110.h"
+#include "proto_router.h"
+
+/******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+// 1 = 用 SysTick（24 位递减，system_hc32l110c6ua.c 中自由运行）统计每个协议的处理耗时
+#ifndef ROUTER_PROFILE
+#define ROUTER_PROFILE      1
+#endif
+
+#if ROUTER_PROFILE
+#define ROUTER_NOW()        (SysTick->VAL)
+#define ROUTER_ELAPSED(t0)  (((t0) - SysTick->VAL) & 0x00FFFFFFu)
+#else
+#define ROUTER_NOW()        0u
+#define ROUTER_ELAPSED(t0)  0u
+#endif
+
+/******************************************************************************
+ * Local variable definitions ('static')                                      *
+ ******************************************************************************/
+// 中断中累加，主循环读取（32 位读写在 M0+ 上是原子的）
+static volatile route_stats_t routeStats[ROUTE_COUNT];
+
+/*****************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+
+// 按帧首字节查找协议，找不到时返回 fallback
+static const route_entry_t *routeMatch(const proto_router_t *r, uint8_t data)
+{
+    uint8_t i;
+
+    for (i = 0; i < r->count; i++)
+    {
+        if (r->table[i].sync == data)
+        {
+            return &r->table[i];
+        }
+    }
+    return r->fallback;
+}
+
+// 一帧结束：按处理函数的结果计帧或计错
+static void routeEnd(const route_entry_t *e, uint8_t res)
+{
+    if (res & ROUTE_ERROR)
+    {
+        routeStats[e->id].errors++;
+    }
+    else if (res & ROUTE_DONE)
+    {
+        routeStats[e->id].frames++;
+    }
+}
+
+// 初始化路由
+void Router_Init(proto_router_t *r, const route_entry_t *table, uint8_t count, const route_entry_t *fallback)
+{
+    r->table = table;
+    r->count = count;
+    r->fallback = fallback;
+    r->active = NULL;
+    r->unmatched = 0;
+}
+
+/**
+ * @brief 输入一个字节
+ * @note 空闲时按同步字节选协议；处理函数返回 ROUTE_AGAIN 时结束上一帧，本字节重新分派一次
+ */
+void Router_Feed(proto_router_t *r, uint8_t data)
+{
+    const route_entry_t *e = r->active;
+    uint8_t first = 0;
+    uint8_t res;
+    uint32_t t0 = ROUTER_NOW();
+
+    if (e == NULL)
+    {
+        e = routeMatch(r, data);
+        first = 1;
+    }
+    if (e == NULL)
+    {
+        r->unmatched++;
+        return;
+    }
+
+    res = e->feed(data, first);
+    if ((res & ROUTE_AGAIN) && !first)
+    {
+        /* 上一帧在本字节之前结束 */
+        routeEnd(e, res);
+        routeStats[e->id].ticks += ROUTER_ELAPSED(t0);
+        r->active = NULL;
+        t0 = ROUTER_NOW();
+        e = routeMatch(r, data);
+        if (e == NULL)
+        {
+            r->unmatched++;
+            return;
+        }
+        first = 1;
+        res = e->feed(data, first);
+    }
+    if ((res & ROUTE_AGAIN) && first)
+    {
+        res = ROUTE_ERROR;
+    }
+
+    routeStats[e->id].bytes++;
+    if (res != ROUTE_MORE)
+    {
+        routeEnd(e, res);
+        r->active = NULL;
+    }
+    else
+    {
+        r->active = e;
+    }
+    routeStats[e->id].ticks += ROUTER_ELAPSED(t0);
+}
+
+// 主循环发现的帧错误（与中断中的累加互斥）
+void Router_CountError(uint8_t id)
+{
+    if (id < ROUTE_COUNT)
+    {
+        __disable_irq();
+        routeStats[id].errors++;
+        __enable_irq();
+    }
+}
+
+// 读取协议统计
+void Router_GetStats(uint8_t id, route_stats_t *stats)
+{
+    if (id < ROUTE_COUNT && stats != NULL)
+    {
+        stats->bytes = routeStats[id].bytes;
+        stats->frames = routeStats[id].frames;
+        stats->errors = routeStats[id].errors;
+        stats->ticks = routeStats[id].ticks;
+    }
+}
+
+// 清零协议统计
+void Router_ResetStats(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < ROUTE_COUNT; i++)
+    {
+        routeStats[i].bytes = 0;
+        routeStats[i].frames = 0;
+        routeStats[i].errors = 0;
+        routeStats[i].ticks = 0;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef PROTO_ROUTER_H
+#define PROTO_ROUTER_H
+
+#include <stdint.h>
+
+/*
+ * 串口协议路由：空闲时按帧首字节（同步字节）在处理表中选一个协议，之后本帧的每个字节只交给它，
+ * 直到处理函数报告帧结束。每个字节只解析一次，可在中断中调用。
+ * 每个协议累计字节、帧、错误数与处理耗时（SysTick 计数），主循环随时读取。
+ */
+
+// 协议编号（统计数组下标）
+#define ROUTE_V2            0       // UART1 图像传输 V2（0x55 ... 0xAA）
+#define ROUTE_ABCD          1       // LPUART/E104 0xABCD 帧
+#define ROUTE_TEXT          2       // UART1 '#' 命令
+#define ROUTE_PASS          3       // UART1 其余字节，透传到 LPUART（没有帧，按字节计帧）
+#define ROUTE_COUNT         4
+
+// 处理函数返回值（位组合）
+#define ROUTE_MORE          0x00    // 本帧未结束
+#define ROUTE_DONE          0x01    // 本帧完整
+#define ROUTE_ERROR         0x02    // 本帧丢弃（同步丢失、长度/校验错误、没有帧槽）
+#define ROUTE_AGAIN         0x04    // 本帧在此字节之前结束，此字节按同步字节重新分派
+
+/**
+ * 协议处理函数：first 为本帧第一个字节时非 0
+ * 第一个字节返回 ROUTE_AGAIN 按 ROUTE_ERROR 处理（不会再分派）
+ */
+typedef uint8_t (*route_feed_t)(uint8_t data, uint8_t first);
+
+typedef struct {
+    uint8_t id;                 // ROUTE_xxx
+    uint8_t sync;               // 帧首字节
+    route_feed_t feed;
+} route_entry_t;
+
+typedef struct {
+    const route_entry_t *table;
+    uint8_t count;
+    const route_entry_t *fallback;  // 不匹配任何同步字节时使用，NULL 表示丢弃
+    const route_entry_t *active;    // 正在接收的协议，NULL 表示空闲
+    uint32_t unmatched;             // 没有协议接收的字节数
+} proto_router_t;
+
+typedef struct {
+    uint32_t bytes;
+    uint32_t frames;
+    uint32_t errors;
+    uint32_t ticks;             // 路由与处理函数累计耗时（SysTick 计数）
+} route_stats_t;
+
+// 初始化路由，table 在路由使用期间必须有效
+void Router_Init(proto_router_t *r, const route_entry_t *table, uint8_t count, const route_entry_t *fallback);
+
+// 输入一个字节
+void Router_Feed(proto_router_t *r, uint8_t data);
+
+// 主循环发现的帧错误（如 V2 校验和）计入协议错误数
+void Router_CountError(uint8_t id);
+
+// 读取/清零协议统计
+void Router_GetStats(uint8_t id, route_stats_t *stats);
+void Router_ResetStats(void);
+
+// 是否正在接收一帧
+#define Router_IsBusy(r)    ((r)->active != NULL)
+
+#endif // PROTO_ROUTER_H
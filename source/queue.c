@@ -22,6 +22,7 @@
  ******************************************************************************/
 #include "base_types.h"
 #include "queue.h"
+#include "hc32l110.h"
 
 /******************************************************************************
  * Local pre-processor symbols/macros ('#define')                            
@@ -45,95 +46,100 @@
 
 
 // 初始化队列
-void Queue_Init(Queue *q) {
+void Queue_Init(Queue *q, uint8_t *storage, uint16_t size) {
+    q->buffer = storage;
+    q->mask = (uint16_t)(size - 1u);
     q->head = 0;
     q->tail = 0;
-    q->size = 0;
-    q->queue_access = false;  // 初始化时，队列不被访问
 }
 
 // 判断队列是否为空
-bool Queue_IsEmpty(Queue *q) {
-    return q->size == 0;
+bool Queue_IsEmpty(const Queue *q) {
+    return q->head == q->tail;
 }
 
 // 判断队列是否已满
-bool Queue_IsFull(Queue *q) {
-    return q->size == QUEUE_SIZE;
+bool Queue_IsFull(const Queue *q) {
+    return Queue_Count(q) > q->mask;
 }
 
-// 将数据写入队列
-bool Queue_Enqueue(Queue *q, uint8_t data) {
-    // 如果队列正在被访问，直接返回失败
-    if (q->queue_access) {
-        return false;
-    }
+// 当前队列中的数据个数（16位计数回绕后相减仍然正确）
+uint16_t Queue_Count(const Queue *q) {
+    return (uint16_t)(q->head - q->tail);
+}
 
-    // 设置队列为被访问状态
-    q->queue_access = true;
+// 当前队列剩余空间
+uint16_t Queue_Free(const Queue *q) {
+    return (uint16_t)(q->mask + 1u - Queue_Count(q));
+}
+
+// 将数据写入队列，只能由生产者（中断）调用
+bool Queue_Enqueue(Queue *q, uint8_t data) {
+    uint16_t head = q->head;
 
-    if (Queue_IsFull(q)) {
-        q->queue_access = false;  // 操作完成后释放访问锁
+    if ((uint16_t)(head - q->tail) > q->mask) {
         return false;  // 队列满了，无法写入
     }
 
-    q->buffer[q->tail] = data;
-    q->tail = (q->tail + 1) % QUEUE_SIZE;  // 环形队列
-    q->size++;
-
-    q->queue_access = false;  // 操作完成后释放访问锁
+    q->buffer[head & q->mask] = data;
+    __DMB();  // 数据先落地，再发布 head
+    q->head = (uint16_t)(head + 1u);
     return true;
 }
 
-// 从队列中读取数据
-bool Queue_Dequeue(Queue *q, uint8_t *data) {
-    // 如果队列正在被访问，直接返回失败
-    if (q->queue_access) {
-        return false;
+// 整段写入，全部数据写完后才发布 head，消费者不会看到半段数据
+bool Queue_EnqueueBuf(Queue *q, const uint8_t *data, uint16_t len) {
+    uint16_t head = q->head;
+    uint16_t i;
+
+    if (len > Queue_Free(q)) {
+        return false;  // 空间不足，整段放弃
     }
 
-    // 设置队列为被访问状态
-    q->queue_access = true;
+    for (i = 0; i < len; i++) {
+        q->buffer[(uint16_t)(head + i) & q->mask] = data[i];
+    }
+    __DMB();
+    q->head = (uint16_t)(head + len);
+    return true;
+}
+
+// 从队列中读取数据，只能由消费者（主循环）调用
+bool Queue_Dequeue(Queue *q, uint8_t *data) {
+    uint16_t tail = q->tail;
 
-    if (Queue_IsEmpty(q)) {
-        q->queue_access = false;  // 操作完成后释放访问锁
+    if (q->head == tail) {
         return false;  // 队列为空，无法读取
     }
 
-    *data = q->buffer[q->head];
-    q->head = (q->head + 1) % QUEUE_SIZE;  // 环形队列
-    q->size--;
-
-    q->queue_access = false;  // 操作完成后释放访问锁
+    __DMB();  // 先确认 head，再读数据
+    *data = q->buffer[tail & q->mask];
+    q->tail = (uint16_t)(tail + 1u);
     return true;
 }
 
-// 从队列尾部输出数据
-bool Queue_DequeueTail(Queue *q, uint8_t *data) {
-    uint16_t tailIndex;
-    // 如果队列正在被访问，直接返回失败
-    if (q->queue_access) {
-        return false;
-    }
-
-    // 设置队列为被访问状态
-    q->queue_access = true;
+// 获取连续可读区间：不跨越缓冲区末尾，回绕部分在下一次 Peek 时返回
+uint16_t Queue_Peek(const Queue *q, const uint8_t **span) {
+    uint16_t tail = q->tail;
+    uint16_t count = (uint16_t)(q->head - tail);
+    uint16_t toEnd = (uint16_t)(q->mask + 1u - (tail & q->mask));
 
-    if (Queue_IsEmpty(q)) {
-        q->queue_access = false;  // 操作完成后释放访问锁
-        return false;  // 如果队列为空，返回false
+    __DMB();
+    if (span != NULL) {
+        *span = &q->buffer[tail & q->mask];
     }
+    return (count < toEnd) ? count : toEnd;
+}
 
-    // 计算队列尾部的位置
-    tailIndex = (q->tail - 1 + QUEUE_SIZE) % QUEUE_SIZE;
-    *data = q->buffer[tailIndex];
-
-    // 更新队列尾部
-    q->tail = tailIndex;
-    q->size--;
+// 移出 n 个数据
+void Queue_Consume(Queue *q, uint16_t n) {
+    uint16_t count = Queue_Count(q);
 
-    q->queue_access = false;  // 操作完成后释放访问锁
-    return true;
+    if (n > count) {
+        n = count;
+    }
+    __DMB();  // 数据读完后才释放空间给生产者
+    q->tail = (uint16_t)(q->tail + n);
 }
 
 // 将整个字符串写入队列
@@ -4,38 +4,48 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-#define QUEUE_SIZE 300  // 队列的最大大小
-
-// 队列结构定义
+// 单生产者/单消费者环形队列：生产者只写 head，消费者只写 tail，无需加锁
+// head/tail 为自由递增的16位计数，取下标时与 mask 相与
 typedef struct {
-    uint8_t buffer[QUEUE_SIZE];  // 存储数据的缓冲区
-    uint16_t head;               // 队列头部
-    uint16_t tail;               // 队列尾部
-    uint16_t size;               // 当前队列中的数据个数
-    bool queue_access;           // 访问标志，防止并发读写
+    uint8_t *buffer;             // 存储数据的缓冲区（由调用者提供）
+    uint16_t mask;               // 缓冲区大小 - 1
+    volatile uint16_t head;      // 写入计数（生产者）
+    volatile uint16_t tail;      // 读取计数（消费者）
 } Queue;
 
 // 函数声明
 
-// 初始化队列
-void Queue_Init(Queue *q);
+// 初始化队列（生产者与消费者都未运行时调用），size 必须是2的幂
+void Queue_Init(Queue *q, uint8_t *storage, uint16_t size);
 
 // 判断队列是否为空
-bool Queue_IsEmpty(Queue *q);
+bool Queue_IsEmpty(const Queue *q);
 
 // 判断队列是否已满
-bool Queue_IsFull(Queue *q);
+bool Queue_IsFull(const Queue *q);
+
+// 当前队列中的数据个数
+uint16_t Queue_Count(const Queue *q);
+
+// 当前队列剩余空间
+uint16_t Queue_Free(const Queue *q);
 
-// 将数据写入队列
+// 将数据写入队列（生产者）
 bool Queue_Enqueue(Queue *q, uint8_t data);
 
-// 从队列中读取数据
+// 将一段数据整体写入队列（生产者），空间不足时不写入任何数据
+bool Queue_EnqueueBuf(Queue *q, const uint8_t *data, uint16_t len);
+
+// 从队列中读取数据（消费者）
 bool Queue_Dequeue(Queue *q, uint8_t *data);
 
-// 从队列尾部读取数据
-bool Queue_DequeueTail(Queue *q, uint8_t *data);
+// 获取队列头部连续可读的一段数据，不移出队列（消费者），返回长度
+uint16_t Queue_Peek(const Queue *q, const uint8_t **span);
+
+// 移出 n 个已读取的数据（消费者），n 不超过 Queue_Count
+void Queue_Consume(Queue *q, uint16_t n);
 
-// 将整个字符串写入队列
+// 将整个字符串写入队列（生产者）
 bool Queue_EnqueueString(Queue *q, const char *str);
 
 
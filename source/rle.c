@@ -0,0 +1,149 @@
+/******************************************************************************
+ ** @file rle.c
+ **
+ ** @brief 可恢复的 RLE 解码：按到达顺序消费压缩数据，直接写入目的page缓冲区
+ **
+ ******************************************************************************/
+
+/******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <string.h>
+#include "rle.h"
+
+/*****************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+
+// 初始化解码器
+void RLE_DecodeInit(rle_decoder_t *d, uint8_t *out, uint16_t outCap)
+{
+    d->out = out;
+    d->outCap = outCap;
+    d->outPos = 0;
+    d->state = RLE_ST_CONTROL;
+    d->count = 0;
+}
+
+/**
+ * @brief 输入一段压缩数据
+ * @param in 压缩数据
+ * @param len 压缩数据长度
+ * @return RLE_OK 或 RLE_ERR_OVERFLOW
+ * @note 字面量按段 memcpy，重复按段 memset；输入可在任意字节处截断，下次调用继续。
+ *       整段都在本次输入中的控制序列直接解码，只有被截断的序列才走状态机
+ */
+uint8_t RLE_DecodeFeed(rle_decoder_t *d, const uint8_t *in, uint16_t len)
+{
+    uint8_t *out = d->out;
+    uint32_t outCap = d->outCap;    // 循环中用 32 位，省去每次运算后的 16 位截断
+    uint32_t outPos = d->outPos;
+    uint32_t count = d->count;
+    uint8_t state = d->state;
+    uint8_t result = RLE_OK;
+    uint32_t pos = 0;
+    uint32_t n;
+    uint8_t c;
+
+    // 接上次截断的序列
+    if (state == RLE_ST_REPEAT && len > 0u)
+    {
+        if (outPos + count > outCap)
+        {
+            return RLE_ERR_OVERFLOW;
+        }
+        memset(&out[outPos], in[pos++], count);
+        outPos += count;
+        state = RLE_ST_CONTROL;
+    }
+    else if (state == RLE_ST_LITERAL)
+    {
+        n = (len > count) ? count : len;
+        if (outPos + n > outCap)
+        {
+            return RLE_ERR_OVERFLOW;
+        }
+        memcpy(&out[outPos], in, n);
+        outPos += n;
+        pos = n;
+        count -= n;
+        if (count == 0u)
+        {
+            state = RLE_ST_CONTROL;
+        }
+    }
+    else
+    {
+        // RLE_ST_CONTROL，或没有输入
+    }
+
+    // 完整的控制序列
+    while (state == RLE_ST_CONTROL && pos < len)
+    {
+        c = in[pos++];
+        if (c >= 128u)
+        {
+            count = 257u - c;
+            if (pos >= len)
+            {
+                state = RLE_ST_REPEAT;      // 重复值在下一段输入中
+            }
+            else if (outPos + count > outCap)
+            {
+                result = RLE_ERR_OVERFLOW;
+                break;
+            }
+            else
+            {
+                memset(&out[outPos], in[pos++], count);
+                outPos += count;
+            }
+        }
+        else
+        {
+            n = c;
+            if (len - pos < n)
+            {
+                count = n - (len - pos);    // 字面量被截断：先复制已到达的部分
+                n = len - pos;
+                state = RLE_ST_LITERAL;
+            }
+            if (outPos + n > outCap)
+            {
+                result = RLE_ERR_OVERFLOW;
+                break;
+            }
+            memcpy(&out[outPos], &in[pos], n);
+            outPos += n;
+            pos += n;
+        }
+    }
+
+    d->outPos = (uint16_t)outPos;
+    d->count = (uint8_t)count;
+    d->state = state;
+    return result;
+}
+
+/**
+ * @brief 还原行差分
+ * @param buf 本页解码后的数据，原地还原
+ * @param len 本页长度（不小于 rowBytes）
+ * @param prevRow 图层中紧接本页之前的 rowBytes 个字节（图层第一页为全 0），不修改；
+ *                下一页的 prevRow 即本页还原后的最后 rowBytes 个字节，由调用方在本页确认写入后保存
+ * @param rowBytes 每行字节数
+ * @note 行与页不必对齐：图层偏移 k 的上一行就是 k - rowBytes，按递增顺序还原即可
+ */
+void RLE_UndoRowDelta(uint8_t *buf, uint16_t len, const uint8_t *prevRow, uint16_t rowBytes)
+{
+    uint16_t i;
+
+    for (i = 0; i < rowBytes; i++)
+    {
+        buf[i] ^= prevRow[i];
+    }
+    for (; i < len; i++)
+    {
+        buf[i] ^= buf[i - rowBytes];
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef RLE_H
+#define RLE_H
+
+#include <stdint.h>
+
+/*
+ * PackBits 风格 RLE：控制字节 n
+ *   n <  128：后跟 n 个字面量字节
+ *   n >= 128：后跟 1 个字节，重复 257 - n 次
+ * 解码器可分段输入（跨帧/跨块恢复），解码结果直接写入调用方给定的缓冲区
+ *
+ * 行差分（1bpp 图层）：编码前每字节与上一行同列字节异或，相邻行相同的部分变成 0x00 长串，
+ * 解码时 RLE 之后再用 RLE_UndoRowDelta 还原。编码器见 tools/img_codec.py
+ */
+
+// 返回值
+#define RLE_OK              0
+#define RLE_ERR_OVERFLOW    1       // 输出超过缓冲区大小
+
+// 解码状态
+#define RLE_ST_CONTROL      0       // 等待控制字节
+#define RLE_ST_LITERAL      1       // 正在复制字面量
+#define RLE_ST_REPEAT       2       // 等待重复值
+
+typedef struct {
+    uint8_t *out;           // 输出缓冲区
+    uint16_t outCap;        // 输出缓冲区大小
+    uint16_t outPos;        // 已输出字节数
+    uint8_t state;          // RLE_ST_xxx
+    uint8_t count;          // 字面量剩余字节数 / 重复次数
+} rle_decoder_t;
+
+// 初始化解码器
+void RLE_DecodeInit(rle_decoder_t *d, uint8_t *out, uint16_t outCap);
+
+// 输入一段压缩数据，可多次调用
+uint8_t RLE_DecodeFeed(rle_decoder_t *d, const uint8_t *in, uint16_t len);
+
+// 输入是否停在完整的控制序列边界上（用于判断压缩流是否被截断）
+#define RLE_DecodeIsComplete(d)     ((d)->state == RLE_ST_CONTROL)
+
+// 还原行差分：buf 原地与上一行异或，prevRow 为上一页最后一行（只读）
+void RLE_UndoRowDelta(uint8_t *buf, uint16_t len, const uint8_t *prevRow, uint16_t rowBytes);
+
+#endif // RLE_H
@@ -34,9 +34,15 @@
 #include "gpio.h"
 #include "clk.h"
 #include "lpuart.h"
+#include "uart_interface.h"
 #include "queue.h"
+#include "frame_pool.h"
+#include "frame_parser.h"
+#include "proto_router.h"
+#include "rle.h"
+#include "image_transfer_v2.h"
 #include "drawWithFlash.h"
-#include "crc.h"
+#include "crc_utils.h"
 #include "base_types.h"
 
 
@@ -61,13 +67,70 @@ void UARTIF_uartPrintf(uint8_t uartNumber, const char *format, ...);
 /******************************************************************************
  * Local variable definitions ('static')                                      *
  ******************************************************************************/
-static Queue uartRecdata, lpUartRecdata;
-static uint8_t cmd = 0xff;
+static Queue uartRecdata;
+static uint8_t uartRxStorage[64];    // 只存透传字节，V2 帧与 '#' 命令在中断中已分走
+static volatile uint8_t cmd = 0xff;  // UART1 '#' 命令，中断写入，E104_executeCommand 取走
 static uint32_t uartRxCount = 0;  // 统计UART接收字节数
 static uint32_t queueOverflowCount = 0;  // 统计队列溢出次数
 
-char buffer[256]; // 假设最大字符串长度为 256
-size_t bufferIndex = 0;
+/* 中断驱动发送：每个通道一个优先通道（协议应答）和一个普通通道（透传/日志），
+ * 主循环写入环形队列，发送完成中断取下一个字节写入 SBUF
+ * 片上 RAM 只有 4KB（栈 0x300），队列尽量小：数据写满时等待，日志写满时丢弃 */
+#define UART_TX_PRIO_SIZE       32
+#define UART_TX_SIZE            64
+#define LPUART_TX_PRIO_SIZE     32
+#define LPUART_TX_SIZE          64
+typedef struct {
+    Queue prio;                  // 优先通道，中断先发送
+    Queue normal;                // 普通通道
+    volatile boolean_t busy;     // 正在发送（等待发送完成中断）
+    volatile boolean_t hold;     // 优先通道的帧还没写完：优先队列空时等待，不切到普通通道
+    uint32_t dropped;            // 普通通道满时丢弃的日志字节数
+} uart_tx_t;
+static uart_tx_t uartTx, lpuartTx;
+static uint8_t uartTxPrioStorage[UART_TX_PRIO_SIZE];
+static uint8_t uartTxStorage[UART_TX_SIZE];
+static uint8_t lpuartTxPrioStorage[LPUART_TX_PRIO_SIZE];
+static uint8_t lpuartTxStorage[LPUART_TX_SIZE];
+
+/* LPUART 中断组帧：0xABCD 帧的 PAYLOAD 直接写入帧槽 */
+static frame_parser_t lpParser;
+static frame_slot_t *lpRxSlot = NULL;
+
+/* 批量帧：PAYLOAD = K 个 [页FLAGS | 页长度 | 页数据]，每页拆进一个帧槽，整帧 CRC 通过后一起提交。
+   K 受帧槽数量限制（接收 RAM），主机用 "BATCH:<K>" 协商 */
+#define LP_BATCH_MAX_PAGES  FRAME_POOL_SLOTS
+#define LP_BATCH_MAX_LEN    (LP_BATCH_MAX_PAGES * (2u + 255u))
+#define LP_BATCH_PAGE_FLAGS 0
+#define LP_BATCH_PAGE_LEN   1
+#define LP_BATCH_PAGE_DATA  2
+typedef struct {
+    frame_slot_t *slots[LP_BATCH_MAX_PAGES];
+    uint8_t count;               // 已申请的帧槽数
+    uint8_t state;               // LP_BATCH_PAGE_xxx
+    uint8_t len;                 // 当前页长度
+    uint8_t pos;                 // 当前页已收字节
+    boolean_t bad;               // 页数超过 K 或没有空闲帧槽，整帧作废
+} lp_batch_t;
+static lp_batch_t lpBatch;
+
+/* 接收路由：每个串口一张处理表，空闲时按帧首字节分派，一帧的字节只交给一个协议。
+   UART1：'#' 命令、V2 帧（ImageTransferV2_Init 后才注册），其余字节透传到 LPUART；LPUART：0xABCD 帧 */
+static uint8_t textRoute(uint8_t data, uint8_t first);
+static uint8_t passRoute(uint8_t data, uint8_t first);
+static uint8_t abcdRoute(uint8_t data, uint8_t first);
+static const route_entry_t uartRoutes[] = {
+    { ROUTE_TEXT, '#', textRoute },
+    { ROUTE_V2, 0x55, ImageTransferV2_RxByte }
+};
+#define UART_ROUTES_NO_V2   1u      // 未启用 V2 时只用表中第一项
+static const route_entry_t uartPassRoute = { ROUTE_PASS, 0, passRoute };
+static const route_entry_t lpuartRoutes[] = {
+    { ROUTE_ABCD, FRAME_MAGIC_0, abcdRoute }
+};
+static proto_router_t uartRouter;
+static proto_router_t lpuartRouter;
+static uint8_t textState = 0;       // '#' 命令：0 = 等命令字节，1 = 等行尾，2 = 已收 CR
 
 /* 支持接收多页（每页 PAGE_SIZE 字节），最多 60 页。接收到每页后写入 flash，但不立即刷新显示。
     接收方通过发送文本命令 "DISPLAY" (不含引号，结尾以 CR/LF) 来触发一次性显示已接收的所有页。
@@ -85,112 +148,370 @@ static bool lastImageIsRed = false;
 static uint8_t redLayerReceived = 0;    // 0=未收, 1=已收
 static uint8_t blackLayerReceived = 0;  // 0=未收, 1=已收
 
-/* Frame magic for new protocol */
-#define FRAME_MAGIC_0 0xAB
-#define FRAME_MAGIC_1 0xCD
-/* 最大允许的单帧有效负载长度（安全上限） */
-#define FRAME_MAX_PAYLOAD 1024
-/* 静态解压缓冲区，避免栈溢出 */
-static uint8_t decompressBuffer[PAGE_SIZE];
-/* 注意：不再为 clear 页分配独立静态缓冲（原 clearPageBuffer 被移除），
- * 在需要写入全白/全黑页时复用 decompressBuffer 以节省静态内存。
- */
+/* 主机帧 FLAGS：bit0 RLE 压缩，bit1 红色图层，bit2 行差分（只与 bit0 同时使用） */
+#define FRAME_FLAG_COMPRESSED 0x01
+#define FRAME_FLAG_RED        0x02
+#define FRAME_FLAG_ROW_DELTA  0x04
+#define FRAME_FLAG_BATCH      0x08  /* 批量帧：PAYLOAD 中每页自带 FLAGS（bit0~2）与长度 */
+/* 设备应答帧：与主机帧格式相同，FLAGS bit7 置位表示设备应答，PAYLOAD[0] 为状态码 */
+#define FRAME_FLAG_RESPONSE 0x80
+#define FRAME_FLAG_CREDIT   0x40    /* 应答 PAYLOAD 末尾附 1 字节 credit 上限（见 creditLimit） */
+#define FRAME_STATUS_READY  0x00  /* 空间已就绪，可继续发送 */
+#define FRAME_STATUS_BUSY   0x01  /* 设备正在垃圾回收，主机需等待 READY */
+#define FRAME_STATUS_NO_SPACE 0x02  /* Flash 空间不足，本次传输被拒绝 */
+#define FRAME_STATUS_RESUME   0x03  /* 续传：PAYLOAD = 状态 | 已收页位图(8B LE) | 本次上电已收齐的图层(bit0 黑 bit1 红) */
+#define FRAME_STATUS_NO_TRANSFER 0x04  /* 没有可续传的传输，主机需 BEGIN 后从第 0 页重发 */
+#define FRAME_STATUS_MANIFEST 0x05  /* 增量更新：PAYLOAD = 状态 | 61 页各自的 CRC32(4B LE) */
+#define FRAME_STATUS_NO_IMAGE 0x06  /* 槽位中没有该图层，无法增量更新，主机需整层上传 */
+#define FRAME_STATUS_BATCH    0x07  /* "BATCH:<K>" 的应答：PAYLOAD = 状态 | 批量帧最多页数 K */
+#define FRAME_STATUS_BATCH_ACK 0x08 /* 批量帧处理完：PAYLOAD = 状态 | 写入的页数（CRC 错误为 0）| 下一页页号 */
+#define FRAME_STATUS_CAPS     0x09  /* "HELLO" 的应答：PAYLOAD = 状态 | 能力描述（UARTIF_CAPS_LEN 字节） */
+#define FRAME_STATUS_CREDIT   0x0A  /* "CREDIT" 的应答，credit 模式下每处理完一帧也发一次：PAYLOAD = 状态 | credit 上限 */
+#define FRAME_RESPONSE_MAX    (1u + UARTIF_CAPS_LEN)
+
+/* 图层每行字节数（400 像素，1bpp），行差分按此跨页还原 */
+#define IMAGE_ROW_BYTES     50
+#define IMAGE_ROWS          300
+/* 图层中上一页的最后一行（行差分解码用） */
+static uint8_t rowTail[IMAGE_ROW_BYTES];
+/* rowTail 属于哪一页，0xFF 表示无效：续传跳页后，行差分页必须紧跟在已还原的上一页之后 */
+static uint8_t rowTailPage = 0xFF;
+
+/* 可续传传输（"BEGIN:"/"RESUME:" 开始）：页可以乱序补发，已收页记在位图中，收齐后写图层头 */
+#define ALL_PAGES_MASK      (((uint64_t)1u << (MAX_FRAME_NUM + 1)) - 1u)
+static bool lpResumable = false;
+static uint64_t pageBitmap = 0;
 
 // 接收处理函数原型
 static void processReceivedBuffer(void);
+static void processLpuartFrame(const uint8_t *payload, uint16_t payloadLen, uint8_t flags, uint8_t crcOk);
+
+/* 批量帧应答：本批开始时已写入的页数 */
+static uint16_t lpPagesWritten = 0;
+static uint16_t lpBatchMark = 0;
+static bool lpBatchOpen = false;
+/* 第一页就没有帧槽的批量帧：中断中计数，主循环补回 0 页的应答，主机不会一直等 */
+static volatile uint8_t lpBatchLost = 0;
+static uint8_t lpBatchLostAcked = 0;
+
+/* credit 流控：主机累计发送的单帧数（不含批量帧）不超过设备通告的上限，在途帧就不会超过可用帧槽。
+   上限 = 已处理完的帧 + 中断中没有帧槽而跳过的帧 + 本链路可用帧槽，按 8 位回绕，"CREDIT" 时从 0 计。
+   线路上损坏的帧（MAGIC/LEN 错）设备看不到，无法计入：主机用完上限后超时没有新通告就重发 "CREDIT" 重新同步 */
+static uint8_t lpFramesDone = 0;            // 主循环处理完的单帧
+static volatile uint8_t lpFramesSkipped = 0; // 中断中因没有帧槽跳过的单帧
+static uint8_t lpCreditBase = 0;
+static bool lpCreditMode = false;           // 每处理完一帧主动通告上限
 
 /* 标记从第一包开始直到显示完成的传输过程（用于阻止进入低功耗） */
 static volatile bool transferInProgress = false;
 
-/* 软件 CRC16-CCITT (poly 0x1021, init 0xFFFF)，用于与硬件驱动结果比对 */
-static uint16_t crc16_ccitt(const uint8_t *data, uint32_t len)
+/**
+ * @brief 当前 credit 上限：主机自 "CREDIT" 起累计发送的单帧数小于该值时可以继续发送
+ */
+static uint8_t creditLimit(void)
 {
-    uint16_t crc = 0xFFFF;
-    uint32_t i;
-    for (i = 0; i < len; ++i)
-    {
-        crc ^= ((uint16_t)data[i]) << 8;
-        {
-            uint8_t j;
-            for (j = 0; j < 8; ++j)
-            {
-                if (crc & 0x8000u)
-                {
-                    crc = (uint16_t)((crc << 1) ^ 0x1021u);
-                }
-                else
-                {
-                    crc = (uint16_t)(crc << 1);
-                }
+    return (uint8_t)(lpFramesDone + lpFramesSkipped - lpCreditBase + FramePool_Available(FRAME_SRC_LPUART));
+}
+
+/**
+ * @brief 通过 LPUART 向主机发送设备应答帧（0xABCD 帧格式），PAYLOAD 末尾附 credit 上限
+ * @param payload 应答 PAYLOAD，payload[0] 为状态码 FRAME_STATUS_xxx
+ * @param len PAYLOAD 长度（不超过 FRAME_RESPONSE_MAX，不含 credit 字节）
+ */
+static void sendFrameResponse(const uint8_t *payload, uint8_t len)
+{
+    uint8_t frame[FRAME_HEADER_LEN + FRAME_RESPONSE_MAX + 1 + FRAME_CRC_LEN];
+    uint16_t crc;
+
+    frame[0] = FRAME_MAGIC_0;
+    frame[1] = FRAME_MAGIC_1;
+    frame[2] = FRAME_FLAG_RESPONSE | FRAME_FLAG_CREDIT;
+    frame[3] = 0x00;
+    memcpy(&frame[FRAME_HEADER_LEN], payload, len);
+    frame[FRAME_HEADER_LEN + len] = creditLimit();
+    len++;
+    frame[4] = len;
+    crc = crc16_ccitt(&frame[FRAME_HEADER_LEN], len);
+    frame[FRAME_HEADER_LEN + len] = (uint8_t)(crc >> 8);
+    frame[FRAME_HEADER_LEN + len + 1] = (uint8_t)(crc & 0xFF);
+
+    (void)UARTIF_write(2, frame, (uint16_t)(FRAME_HEADER_LEN + len + FRAME_CRC_LEN), UARTIF_TX_PRIORITY);
+}
+
+/**
+ * @brief 发送只含状态码的设备应答帧
+ * @param status 状态码 FRAME_STATUS_xxx
+ */
+static void sendFrameStatus(uint8_t status)
+{
+    sendFrameResponse(&status, 1);
+}
+
+/**
+ * @brief "MANIFEST:<槽位 1-8>,<B|R>"：回 FRAME_STATUS_MANIFEST 与已存图层每页的 CRC32
+ * @note 应答 245 字节，分段读取、分段写入优先队列，栈上只放一段；
+ *       优先队列只有 32 字节，段之间会发空，用 UARTIF_holdPriority 防止日志/透传插入帧中间
+ */
+static void sendManifest(const char *arg)
+{
+    uint8_t buf[8 * 4];
+    uint32_t crcs[8];
+    uint16_t crc = CRC16_CCITT_INIT;
+    uint8_t slotId;
+    uint8_t magic;
+    uint8_t first;
+    uint8_t n;
+    uint8_t i;
+    char *end;
+    unsigned long v;
+    flash_result_t fres;
+
+    v = strtoul(arg, &end, 10);
+    if (end == arg || v < 1u || v > MAX_IMAGE_ENTRIES || end[0] != ',' ||
+        (end[1] != 'B' && end[1] != 'R') || end[2] != '\0') {
+        UARTIF_uartPrintf(0, "MANIFEST invalid: %s\r\n", arg);
+        return;
+    }
+    slotId = (uint8_t)(v - 1u);
+    magic = (end[1] == 'R') ? MAGIC_RED_IMAGE_DATA : MAGIC_BW_IMAGE_DATA;
+
+    for (first = 0; first <= MAX_FRAME_NUM; first = (uint8_t)(first + n)) {
+        n = (uint8_t)((MAX_FRAME_NUM + 1 - first > 8) ? 8 : (MAX_FRAME_NUM + 1 - first));
+        fres = FM_readImageManifest(magic, slotId, first, n, crcs);
+        if (fres != FLASH_OK) {
+            if (first == 0) {
+                UARTIF_uartPrintf(0, "MANIFEST slot=%u: no image err=%d\r\n", slotId, fres);
+                sendFrameStatus(FRAME_STATUS_NO_IMAGE);
+                return;
             }
+            /* 帧已开始发送：其余页报告为已改动，主机会重新上传 */
+            memset(crcs, 0, sizeof(crcs));
+        }
+        if (first == 0) {
+            buf[0] = FRAME_MAGIC_0;
+            buf[1] = FRAME_MAGIC_1;
+            buf[2] = FRAME_FLAG_RESPONSE | FRAME_FLAG_CREDIT;
+            buf[3] = 0x00;
+            buf[4] = (uint8_t)(1u + 4u * (MAX_FRAME_NUM + 1u) + 1u);
+            buf[5] = FRAME_STATUS_MANIFEST;
+            crc = crc16_ccitt_update(crc, &buf[5], 1);
+            UARTIF_holdPriority(2, TRUE);
+            (void)UARTIF_write(2, buf, FRAME_HEADER_LEN + 1u, UARTIF_TX_PRIORITY);
         }
+        for (i = 0; i < n; i++) {
+            buf[4u * i] = (uint8_t)(crcs[i] & 0xFF);
+            buf[4u * i + 1u] = (uint8_t)((crcs[i] >> 8) & 0xFF);
+            buf[4u * i + 2u] = (uint8_t)((crcs[i] >> 16) & 0xFF);
+            buf[4u * i + 3u] = (uint8_t)((crcs[i] >> 24) & 0xFF);
+        }
+        crc = crc16_ccitt_update(crc, buf, 4u * n);
+        (void)UARTIF_write(2, buf, (uint16_t)(4u * n), UARTIF_TX_PRIORITY);
     }
-    return crc;
+    /* 与 sendFrameResponse 一样，末尾附 credit 上限 */
+    buf[0] = creditLimit();
+    crc = crc16_ccitt_update(crc, buf, 1);
+    buf[1] = (uint8_t)(crc >> 8);
+    buf[2] = (uint8_t)(crc & 0xFF);
+    (void)UARTIF_write(2, buf, 1u + FRAME_CRC_LEN, UARTIF_TX_PRIORITY);
+    UARTIF_holdPriority(2, FALSE);
 }
 
 /**
- * @brief RLE 解压缩（就地解压到固定248字节缓冲区）
- * @param compressed 压缩数据
- * @param compLen 压缩数据长度
- * @param output 输出缓冲区（必须至少248字节）
- * @param maxOutLen 输出缓冲区最大长度
- * @return 解压后的实际长度，失败返回0
+ * @brief "COMMIT"：增量更新结束，BEGIN 之后只发送了改动的页，其余页沿用已存图层
+ * @note 成功回 READY；槽位中没有该图层回 FRAME_STATUS_NO_IMAGE
  */
-static size_t decompressPageRLE(const uint8_t *compressed, size_t compLen,
-                                uint8_t *output, size_t maxOutLen)
+static void commitDeltaLayer(void)
 {
-    size_t inPos = 0;
-    size_t outPos = 0;
-		uint8_t count;
-		uint8_t value;
-		size_t runLength;
-		size_t literalLen;
+    flash_result_t fres;
+    uint32_t crc;
+
+    if (!lpResumable) {
+        UARTIF_uartPrintf(0, "COMMIT without BEGIN\r\n");
+        return;
+    }
+    lpResumable = false;
+    fres = FM_writeImageHeaderDelta(lastImageIsRed ? MAGIC_RED_IMAGE_HEADER : MAGIC_BW_IMAGE_HEADER,
+                                    (uint8_t)currentImageSlot);
+    if (fres != FLASH_OK) {
+        UARTIF_uartPrintf(0, "COMMIT slot=%u fail err=%d\r\n", currentImageSlot, fres);
+        sendFrameStatus(FRAME_STATUS_NO_IMAGE);
+        return;
+    }
 
-	
+    if (lastImageIsRed) {
+        redLayerReceived = 1;
+    } else {
+        blackLayerReceived = 1;
+    }
+    /* 对侧图层已在 flash 中时保持不变，DISPLAY 不再把它清空 */
+    if (FM_readImageManifest(lastImageIsRed ? MAGIC_BW_IMAGE_DATA : MAGIC_RED_IMAGE_DATA,
+                             (uint8_t)currentImageSlot, 0, 1, &crc) == FLASH_OK) {
+        redLayerReceived = 1;
+        blackLayerReceived = 1;
+    }
+    UARTIF_uartPrintf(0, "COMMIT slot=%u isRed=%u pages=0x%08lX%08lX\r\n", currentImageSlot, lastImageIsRed,
+                      (unsigned long)(pageBitmap >> 32), (unsigned long)pageBitmap);
+    sendFrameStatus(FRAME_STATUS_READY);
+}
 
-    while (inPos < compLen) {
-        if (inPos >= compLen) break;
+/**
+ * @brief DISPLAY 前补全缺少的一层：整层写为空白并写图层头
+ * @param dataMagic 数据页魔数
+ * @param headerMagic 图层头魔数
+ * @param fill 空白值（黑白层 0xFF，红色层 0x00）
+ * @return flash_result_t 失败时不写图层头，槽位中保留原来的图层
+ * @note FM_writePageBuffer 不做垃圾回收，先预留整层：BEGIN/RESUME 只预留本层，重启后也没有预留
+ */
+static flash_result_t clearMissingLayer(uint8_t dataMagic, uint8_t headerMagic, uint8_t fill)
+{
+    flash_result_t fres;
+    uint16_t j;
+    uint16_t wid;
+
+    fres = FM_reserve(IMAGE_LAYER_PAGES);
+    for (j = 0; (fres == FLASH_OK) && (j <= MAX_FRAME_NUM); ++j) {
+        memset(FM_getPageBuffer(), fill, PAYLOAD_SIZE);
+        wid = (uint16_t)(j | ((uint16_t)currentImageSlot << 8));
+        fres = FM_writePageBuffer(dataMagic, wid, PAYLOAD_SIZE);
+    }
+    if (fres == FLASH_OK) {
+        fres = FM_writeImageHeader(headerMagic, currentImageSlot);
+    }
+    if (fres != FLASH_OK) {
+        UARTIF_uartPrintf(0, "CLEAR magic=0x%02X slot=%u fail at page %u err=%d\r\n",
+                          dataMagic, currentImageSlot, j, fres);
+    }
+    return fres;
+}
 
-        count = compressed[inPos++];
+/**
+ * @brief 新图像传输开始时预留 flash 空间，需要垃圾回收时先通知主机等待
+ * @param extraPages 图层之外额外预留的 page（可续传传输的记录页）
+ * @param notifyReady 通知过 BUSY 后是否回 READY（FALSE 时由调用方应答）
+ * @return flash_result_t 预留结果
+ */
+static flash_result_t reserveForTransfer(uint16_t extraPages, boolean_t notifyReady)
+{
+    flash_result_t fres;
+    uint16_t pages;
+    boolean_t busy = FALSE;
+
+    /* 两层都未收到时按红黑两层预留（含 DISPLAY 补全对侧层），否则只预留本层 */
+    pages = (redLayerReceived || blackLayerReceived) ? IMAGE_LAYER_PAGES : (uint16_t)(2u * IMAGE_LAYER_PAGES);
+    pages = (uint16_t)(pages + extraPages);
+    if (FM_getFreePages() < pages)
+    {
+        busy = TRUE;
+        sendFrameStatus(FRAME_STATUS_BUSY);
+    }
 
-        if (count >= 128) {
-            /* 重复模式：257 - count = 实际重复次数 */
-            if (inPos >= compLen) {
-                UARTIF_uartPrintf(0, "RLE ERR: missing repeat value at pos %u\r\n", (unsigned)inPos);
-                return 0;
-            }
+    fres = FM_reserve(pages);
+    if (fres != FLASH_OK)
+    {
+        UARTIF_uartPrintf(0, "Flash reserve %u pages fail err=%d\r\n", pages, fres);
+        sendFrameStatus(FRAME_STATUS_NO_SPACE);
+    }
+    else if (busy && notifyReady)
+    {
+        sendFrameStatus(FRAME_STATUS_READY);
+    }
+    return fres;
+}
 
-            value = compressed[inPos++];
-            runLength = 257 - count;
+/**
+ * @brief 解析可续传传输参数 "<槽位 1-8>,<B|R>,<传输ID hex>,<图像CRC32 hex>"
+ * @return TRUE 解析成功
+ */
+static boolean_t parseTransferArgs(const char *arg, fm_transfer_t *transfer)
+{
+    char *end;
+    unsigned long v;
 
-            if (outPos + runLength > maxOutLen) {
-                UARTIF_uartPrintf(0, "RLE ERR: buffer overflow, need %u have %u\r\n",
-                                  (unsigned)(outPos + runLength), (unsigned)maxOutLen);
-                return 0;
-            }
+    v = strtoul(arg, &end, 10);
+    if (end == arg || v < 1u || v > MAX_IMAGE_ENTRIES || end[0] != ',' ||
+        (end[1] != 'B' && end[1] != 'R') || end[2] != ',') {
+        return FALSE;
+    }
+    transfer->slotId = (uint8_t)(v - 1u);
+    transfer->magic = (end[1] == 'R') ? MAGIC_RED_IMAGE_DATA : MAGIC_BW_IMAGE_DATA;
 
-            memset(&output[outPos], value, runLength);
-            outPos += runLength;
-        } else {
-            /* 字面量模式 */
-            literalLen = count;
+    arg = &end[3];
+    transfer->transferId = (uint32_t)strtoul(arg, &end, 16);
+    if (end == arg || end[0] != ',') {
+        return FALSE;
+    }
+    arg = &end[1];
+    transfer->imageCrc = (uint32_t)strtoul(arg, &end, 16);
+    return (end != arg && end[0] == '\0') ? TRUE : FALSE;
+}
 
-            if (inPos + literalLen > compLen) {
-                UARTIF_uartPrintf(0, "RLE ERR: insufficient literal data at pos %u\r\n", (unsigned)inPos);
-                return 0;
-            }
-            if (outPos + literalLen > maxOutLen) {
-                UARTIF_uartPrintf(0, "RLE ERR: buffer overflow in literal mode\r\n");
-                return 0;
-            }
+/**
+ * @brief "BEGIN:" 开始 / "RESUME:" 继续一次可续传的图层传输
+ * @note BEGIN 预留空间、写入传输记录后回 READY，主机从第 0 页发送；
+ *       RESUME 回 FRAME_STATUS_RESUME 与已写入的页（重启后同样有效），主机用 "PAGE:<n>" 只补发缺页；
+ *       传输ID、图像CRC不符或中间发生过垃圾回收时回 FRAME_STATUS_NO_TRANSFER，主机重新 BEGIN
+ */
+static void startResumableTransfer(const char *arg, boolean_t resume)
+{
+    fm_transfer_t transfer;
+    uint64_t received = 0;
+    flash_result_t fres;
+    uint8_t resp[10];
+    uint8_t i;
+
+    if (!parseTransferArgs(arg, &transfer)) {
+        UARTIF_uartPrintf(0, "%s invalid: %s\r\n", resume ? "RESUME" : "BEGIN", arg);
+        return;
+    }
 
-            memcpy(&output[outPos], &compressed[inPos], literalLen);
-            inPos += literalLen;
-            outPos += literalLen;
+    currentImageSlot = (int8_t)transfer.slotId;
+    lastImageIsRed = (transfer.magic == MAGIC_RED_IMAGE_DATA);
+    if (resume) {
+        fres = FM_resumeTransfer(&transfer, &received);
+        if (fres != FLASH_OK) {
+            UARTIF_uartPrintf(0, "RESUME 0x%08lX: no transfer err=%d\r\n", (unsigned long)transfer.transferId, fres);
+            lpResumable = false;
+            sendFrameStatus(FRAME_STATUS_NO_TRANSFER);
+            return;
+        }
+    } else {
+        /* 多预留一页给传输记录，FM_beginTransfer 不会再触发垃圾回收 */
+        if (reserveForTransfer(1u, FALSE) != FLASH_OK) {
+            lpResumable = false;
+            return;
         }
+        fres = FM_beginTransfer(&transfer);
+        if (fres != FLASH_OK) {
+            UARTIF_uartPrintf(0, "BEGIN 0x%08lX fail err=%d\r\n", (unsigned long)transfer.transferId, fres);
+            lpResumable = false;
+            sendFrameStatus(FRAME_STATUS_NO_SPACE);
+            return;
+        }
+    }
+
+    lpResumable = true;
+    transferInProgress = true;
+    pageBitmap = received;
+    rowTailPage = 0xFF;
+    /* 从第一个缺页开始接收 */
+    receivedPageCount = 0;
+    while (receivedPageCount < MAX_FRAME_NUM && (pageBitmap & ((uint64_t)1u << receivedPageCount))) {
+        receivedPageCount++;
     }
 
-    return outPos;
+    if (resume) {
+        resp[0] = FRAME_STATUS_RESUME;
+        for (i = 0; i < 8u; i++) {
+            resp[1 + i] = (uint8_t)(pageBitmap >> (8u * i));
+        }
+        /* 重启后对侧图层的接收记录已丢失，主机据此决定是否重发对侧图层 */
+        resp[9] = (uint8_t)((blackLayerReceived ? 0x01u : 0u) | (redLayerReceived ? 0x02u : 0u));
+        sendFrameResponse(resp, sizeof(resp));
+    } else {
+        sendFrameStatus(FRAME_STATUS_READY);
+    }
+    UARTIF_uartPrintf(0, "%s slot=%u isRed=%u next page=%u\r\n", resume ? "RESUME" : "BEGIN",
+                      currentImageSlot, lastImageIsRed, receivedPageCount);
 }
 
 /******************************************************************************
@@ -201,22 +522,261 @@ static size_t decompressPageRLE(const uint8_t *compressed, size_t compLen,
  * Function implementation - global ('extern') and local ('static')
  ******************************************************************************/
 
-void UART_rxIntCallback(void)
+/**
+ * @brief 从发送队列取下一个字节，优先通道优先
+ */
+static boolean_t txNextByte(uart_tx_t *tx, uint8_t *byte)
 {
-    volatile char data = 0;
-    data = Uart_ReceiveData(UARTCH1);
-    uartRxCount++;
+    if (Queue_Dequeue(&tx->prio, byte)) return TRUE;
+    if (tx->hold) return FALSE;  // 帧的下一段还没入队，普通通道不能插在帧中间
+    if (Queue_Dequeue(&tx->normal, byte)) return TRUE;
+    return FALSE;
+}
+
+static void UART_txIntCallback(void)
+{
+    uint8_t byte;
+
+    if (txNextByte(&uartTx, &byte))
+    {
+        M0P_UART1->SBUF = byte;
+    }
+    else
+    {
+        uartTx.busy = FALSE;
+    }
+}
+
+static void LPUART_txIntCallback(void)
+{
+    uint8_t byte;
 
-    if (Queue_Enqueue(&uartRecdata, data))
+    if (txNextByte(&lpuartTx, &byte))
     {
-        Uart_ClrStatus(UARTCH1,UartRxFull);
+        M0P_LPUART->SBUF = byte;
     }
     else
     {
-        // 队列满，数据丢失
+        lpuartTx.busy = FALSE;
+    }
+}
+
+/**
+ * @brief 发送空闲时写入第一个字节启动发送，之后由发送完成中断接力
+ */
+static void txKick(uart_tx_t *tx)
+{
+    uint32_t primask;
+    uint8_t byte;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (!tx->busy && txNextByte(tx, &byte))
+    {
+        tx->busy = TRUE;
+        if (tx == &uartTx)
+        {
+            Uart_ClrStatus(UARTCH1, UartTxEmpty);
+            M0P_UART1->SBUF = byte;
+        }
+        else
+        {
+            LPUart_ClrStatus(LPUartTxEmpty);
+            M0P_LPUART->SBUF = byte;
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 非阻塞发送
+ * @param uartNumber 0 为 UART1，2 为 LPUART
+ * @param data 数据
+ * @param len 长度
+ * @param lane UARTIF_TX_LOG 空间不足时整段丢弃并计数；
+ *             UARTIF_TX_DATA / UARTIF_TX_PRIORITY 等待空间，每段整体入队不被拆开
+ * @return boolean_t FALSE 表示日志被丢弃
+ * @note 优先通道一段超过队列长度时分块入队，期间保持 hold，普通通道不会插入段中间；
+ *       一帧分多次写入时用 UARTIF_holdPriority 把整帧包起来。
+ *       hold 期间普通通道写满不再等待（只有持有者自己在主循环写），按日志丢弃
+ */
+boolean_t UARTIF_write(uint8_t uartNumber, const uint8_t *data, uint16_t len, uint8_t lane)
+{
+    uart_tx_t *tx;
+    Queue *q;
+    uint16_t chunk;
+    boolean_t held;
+
+    if (uartNumber == 0) tx = &uartTx;
+    else if (uartNumber == 2) tx = &lpuartTx;
+    else return FALSE;
+    q = (lane == UARTIF_TX_PRIORITY) ? &tx->prio : &tx->normal;
+    if (q->buffer == NULL) return FALSE;  // 串口尚未初始化
+
+    if (lane == UARTIF_TX_LOG || (tx->hold && lane != UARTIF_TX_PRIORITY))
+    {
+        if (!Queue_EnqueueBuf(q, data, len))
+        {
+            tx->dropped += len;
+            return FALSE;
+        }
+        txKick(tx);
+        return TRUE;
+    }
+
+    held = tx->hold;
+    if (lane == UARTIF_TX_PRIORITY)
+    {
+        tx->hold = TRUE;
+    }
+    while (len > 0)
+    {
+        chunk = (len > (uint16_t)(q->mask + 1u)) ? (uint16_t)(q->mask + 1u) : len;
+        while (!Queue_EnqueueBuf(q, data, chunk))
+        {
+            txKick(tx);  // 队列满，等待中断发送腾出空间
+        }
+        data += chunk;
+        len -= chunk;
+    }
+    tx->hold = held;
+    txKick(tx);
+    return TRUE;
+}
+
+/**
+ * @brief 一帧分多次写入优先通道时，在第一段之前置 hold、最后一段之后清除
+ * @param uartNumber 0 为 UART1，2 为 LPUART
+ * @param hold TRUE：优先队列发空后中断等待下一段；FALSE：恢复普通通道
+ * @note 只在主循环中使用，hold 期间不要等待普通通道
+ */
+void UARTIF_holdPriority(uint8_t uartNumber, boolean_t hold)
+{
+    uart_tx_t *tx;
+
+    if (uartNumber == 0) tx = &uartTx;
+    else if (uartNumber == 2) tx = &lpuartTx;
+    else return;
+    tx->hold = hold;
+    if (!hold)
+    {
+        txKick(tx);  // 等待期间普通通道积压的数据
+    }
+}
+
+/**
+ * @brief 填写 HELLO/CAPS 能力描述（UARTIF_CAPS_LEN 字节），主机据此选择窗口、批量页数与压缩方式
+ */
+void UARTIF_getCaps(uint8_t *caps)
+{
+    uint16_t freePages = FM_getFreePages();
+
+    caps[0] = UARTIF_PROTO_VERSION;
+    caps[1] = UARTIF_CAPS_LINK_V2 | UARTIF_CAPS_LINK_ABCD;
+    caps[2] = (uint8_t)(LP_BATCH_MAX_LEN & 0xFF);
+    caps[3] = (uint8_t)((LP_BATCH_MAX_LEN >> 8) & 0xFF);
+    caps[4] = FRAME_POOL_SLOTS;         // V2 窗口与批量帧都受帧槽数量限制
+    caps[5] = LP_BATCH_MAX_PAGES;
+    caps[6] = UARTIF_CAPS_RLE | UARTIF_CAPS_ROW_DELTA | UARTIF_CAPS_BATCH |
+              UARTIF_CAPS_RESUME | UARTIF_CAPS_DELTA | UARTIF_CAPS_SACK | UARTIF_CAPS_CREDIT;
+    caps[7] = MAX_IMAGE_ENTRIES;
+    caps[8] = (uint8_t)((IMAGE_ROW_BYTES * 8u) & 0xFF);
+    caps[9] = (uint8_t)((IMAGE_ROW_BYTES * 8u) >> 8);
+    caps[10] = (uint8_t)(IMAGE_ROWS & 0xFF);
+    caps[11] = (uint8_t)(IMAGE_ROWS >> 8);
+    caps[12] = 2;                       // 黑白 + 红
+    caps[13] = (uint8_t)(freePages & 0xFF);
+    caps[14] = (uint8_t)(freePages >> 8);
+    caps[15] = PAGE_SIZE;
+}
+
+/**
+ * @brief 普通发送通道剩余空间（字节），未初始化时为 0
+ */
+uint16_t UARTIF_txSpace(uint8_t uartNumber)
+{
+    uart_tx_t *tx;
+
+    if (uartNumber == 0) tx = &uartTx;
+    else if (uartNumber == 2) tx = &lpuartTx;
+    else return 0;
+    if (tx->normal.buffer == NULL) return 0;
+    return Queue_Free(&tx->normal);
+}
+
+/**
+ * @brief 等待两个通道的发送队列全部发完（进入低功耗前调用）
+ */
+void UARTIF_flushTx(void)
+{
+    while (uartTx.busy || lpuartTx.busy)
+    {
+        txKick(&uartTx);
+        txKick(&lpuartTx);
+    }
+}
+
+/**
+ * @brief 获取日志因发送队列满而丢弃的字节数
+ */
+void UARTIF_getTxStats(uint32_t *uartDropped, uint32_t *lpuartDropped)
+{
+    if (uartDropped != NULL) *uartDropped = uartTx.dropped;
+    if (lpuartDropped != NULL) *lpuartDropped = lpuartTx.dropped;
+}
+
+/**
+ * @brief '#' 命令：'#' 后一个字节为命令（E104_executeCommand 取走），可跟 CR/LF
+ */
+static uint8_t textRoute(uint8_t data, uint8_t first)
+{
+    if (first)
+    {
+        textState = 0;
+        return ROUTE_MORE;
+    }
+    if (textState == 0)
+    {
+        cmd = data;
+        textState = 1;
+        return ROUTE_MORE;
+    }
+    if (data == '\r' && textState == 1)
+    {
+        textState = 2;
+        return ROUTE_MORE;
+    }
+    if (data == '\n')
+    {
+        return ROUTE_DONE;
+    }
+    /* 没有行尾：命令在此字节之前结束 */
+    return ROUTE_DONE | ROUTE_AGAIN;
+}
+
+/**
+ * @brief 透传：字节进入接收队列，主循环转发到 LPUART
+ */
+static uint8_t passRoute(uint8_t data, uint8_t first)
+{
+    (void)first;
+    if (!Queue_Enqueue(&uartRecdata, data))
+    {
+        // 队列满，数据丢失（不在中断中输出，避免影响时序）
         queueOverflowCount++;
-        // 注：不在中断中输出，避免影响时序
+        return ROUTE_ERROR;
     }
+    return ROUTE_DONE;
+}
+
+void UART_rxIntCallback(void)
+{
+    uint8_t data;
+
+    data = (uint8_t)Uart_ReceiveData(UARTCH1);
+    Uart_ClrStatus(UARTCH1,UartRxFull);
+    uartRxCount++;
+    Router_Feed(&uartRouter, data);
 }
 
 void UART_errIntCallback(void)
@@ -225,23 +785,204 @@ void UART_errIntCallback(void)
 
 }
 
-void LPUART_rxIntCallback(void)
+/**
+ * @brief 批量帧 PAYLOAD 的一个字节：按页拆分到帧槽（中断中调用）
+ */
+static void lpBatchFeed(uint8_t data)
 {
-    volatile char data = 0;
-    data = LPUart_ReceiveData();
+    frame_slot_t *slot = NULL;
+
+    switch (lpBatch.state)
+    {
+    case LP_BATCH_PAGE_FLAGS:
+        if (!lpBatch.bad && lpBatch.count < LP_BATCH_MAX_PAGES)
+        {
+            slot = FramePool_Claim(FRAME_SRC_LPUART);
+        }
+        if (slot == NULL)
+        {
+            lpBatch.bad = TRUE;
+        }
+        else
+        {
+            slot->flags = (uint8_t)(data & (FRAME_FLAG_COMPRESSED | FRAME_FLAG_RED | FRAME_FLAG_ROW_DELTA));
+            lpBatch.slots[lpBatch.count++] = slot;
+        }
+        lpBatch.state = LP_BATCH_PAGE_LEN;
+        break;
+
+    case LP_BATCH_PAGE_LEN:
+        lpBatch.len = data;
+        lpBatch.pos = 0;
+        if (!lpBatch.bad)
+        {
+            lpBatch.slots[lpBatch.count - 1u]->len = data;
+        }
+        lpBatch.state = (data != 0u) ? LP_BATCH_PAGE_DATA : LP_BATCH_PAGE_FLAGS;
+        break;
 
-    if (Queue_Enqueue(&lpUartRecdata, data))
+    default:
+        if (!lpBatch.bad)
+        {
+            lpBatch.slots[lpBatch.count - 1u]->data[lpBatch.pos] = data;
+        }
+        if (++lpBatch.pos >= lpBatch.len)
+        {
+            lpBatch.state = LP_BATCH_PAGE_FLAGS;
+        }
+        break;
+    }
+}
+
+/**
+ * @brief 批量帧结束：CRC 正确时按顺序提交所有页，否则只提交一个空槽让主循环回应答
+ * @note 一个帧槽都没申请到时记入 lpBatchLost，由主循环应答
+ */
+static void lpBatchEnd(boolean_t crcOk)
+{
+    uint8_t i;
+
+    if (lpBatch.count == 0u)
     {
-        LPUart_ClrStatus(LPUartRxFull);
+        lpBatchLost++;
+        return;
+    }
+    if (crcOk && !lpBatch.bad && lpBatch.state == LP_BATCH_PAGE_FLAGS)
+    {
+        for (i = 0; i < lpBatch.count; i++)
+        {
+            lpBatch.slots[i]->status = (uint8_t)(FRAME_RX_CRC_OK | FRAME_RX_BATCH |
+                                                 ((i + 1u == lpBatch.count) ? FRAME_RX_BATCH_END : 0u));
+            FramePool_Commit(lpBatch.slots[i]);
+        }
+    }
+    else
+    {
+        for (i = 1; i < lpBatch.count; i++)
+        {
+            FramePool_Abort(lpBatch.slots[i]);
+        }
+        lpBatch.slots[0]->len = 0;
+        lpBatch.slots[0]->status = FRAME_RX_BATCH | FRAME_RX_BATCH_END;
+        FramePool_Commit(lpBatch.slots[0]);
+    }
+    lpBatch.count = 0;
+}
+
+/**
+ * @brief 0xABCD 帧（LPUART 路由处理函数）：由解析器逐字节处理，PAYLOAD 直接写入帧槽
+ * @note 完整帧放入帧池就绪队列，主循环每次处理一帧；没有空闲帧槽时跳过本帧 PAYLOAD。
+ *       批量帧的 PAYLOAD 由 lpBatchFeed 按页拆到多个帧槽
+ */
+static uint8_t abcdRoute(uint8_t data, uint8_t first)
+{
+    uint8_t event;
+    uint8_t res = ROUTE_MORE;
+
+    (void)first;
+    if (lpParser.state == FP_STATE_PAYLOAD && (lpParser.flags & FRAME_FLAG_BATCH))
+    {
+        lpBatchFeed(data);
+    }
+    event = FrameParser_Feed(&lpParser, data);
+    switch (event)
+    {
+    case FRAME_PARSE_START:
+        if (lpParser.flags & FRAME_FLAG_BATCH)
+        {
+            lpBatch.count = 0;
+            lpBatch.state = LP_BATCH_PAGE_FLAGS;
+            lpBatch.bad = FALSE;
+        }
+        else if (lpParser.len > FRAME_SLOT_SIZE)
+        {
+            /* 单帧最多一个帧槽；更长的 LEN 只能是长度字节出错，马上重新同步，不按它吞掉后面的帧 */
+            FrameParser_Reject(&lpParser);
+            res = ROUTE_ERROR;
+        }
+        else
+        {
+            lpRxSlot = FramePool_Claim(FRAME_SRC_LPUART);
+            if (lpRxSlot != NULL)
+            {
+                lpRxSlot->flags = lpParser.flags;
+                FrameParser_SetDest(&lpParser, lpRxSlot->data);
+            }
+        }
+        break;
+
+    case FRAME_PARSE_DONE:
+    case FRAME_PARSE_CRC_ERR:
+        res = (event == FRAME_PARSE_DONE) ? ROUTE_DONE : ROUTE_ERROR;
+        if (lpParser.flags & FRAME_FLAG_BATCH)
+        {
+            if (lpBatch.bad)
+            {
+                res = ROUTE_ERROR;
+            }
+            lpBatchEnd((event == FRAME_PARSE_DONE) ? TRUE : FALSE);
+        }
+        else if (lpRxSlot != NULL)
+        {
+            lpRxSlot->len = lpParser.len;
+            if (event == FRAME_PARSE_DONE)
+            {
+                lpRxSlot->status = FRAME_RX_CRC_OK;
+            }
+            FramePool_Commit(lpRxSlot);
+            lpRxSlot = NULL;
+        }
+        else
+        {
+            res = ROUTE_ERROR;      // 没有帧槽，本帧已跳过
+            lpFramesSkipped++;
+        }
+        break;
+
+    case FRAME_PARSE_LEN_ERR:
+        res = ROUTE_ERROR;
+        break;
+
+    default:
+        if (lpParser.state == FP_STATE_MAGIC0)
+        {
+            res = ROUTE_ERROR | ROUTE_AGAIN;    // 0xAB 后不是 0xCD
+        }
+        break;
     }
+    return res;
+}
+
+/**
+ * @brief LPUART 接收中断：字节交给 LPUART 路由
+ */
+void LPUART_rxIntCallback(void)
+{
+    uint8_t data;
+
+    data = LPUart_ReceiveData();
+    LPUart_ClrStatus(LPUartRxFull);
+    Router_Feed(&lpuartRouter, data);
+}
+
+/**
+ * @brief 打开/关闭 UART1 的图像传输 V2 中断组帧
+ */
+void UARTIF_enableV2Framing(boolean_t enable)
+{
+    /* 换表时路由回到空闲，正在接收的字节重新按同步字节分派 */
+    __disable_irq();
+    Router_Init(&uartRouter, uartRoutes,
+                enable ? (uint8_t)(sizeof(uartRoutes) / sizeof(uartRoutes[0])) : UART_ROUTES_NO_V2,
+                &uartPassRoute);
+    __enable_irq();
 }
 
 void UARTIF_uartPrintf(uint8_t uartNumber, const char *format, ...)
 {
     char buffer[256]; // 缓冲区，用于存储格式化后的字符串
     va_list args;     // 可变参数列表
-    uint8_t len = 0;
-    uint8_t i = 0;
+    int len = 0;
 
     // 初始化可变参数
     va_start(args, format);
@@ -252,32 +993,16 @@ void UARTIF_uartPrintf(uint8_t uartNumber, const char *format, ...)
     // 清理可变参数列表
     va_end(args);
 
-    // 如果格式化成功，逐字节发送字符串
+    // 截断时只发送缓冲区内的部分
+    if (len >= (int)sizeof(buffer)) {
+        len = (int)sizeof(buffer) - 1;
+    }
+
+    // 放入发送队列，由中断发送；普通通道较小，主循环中等待空间，
+    // 中断中或关中断时等不到发送完成中断，队列满时丢弃本行
     if (len > 0) {
-        for (i = 0; i < len; i++) 
-        {
-            // 调用 Uart_SendData 发送字符
-            if (uartNumber == 0)
-            {
-                if (Uart_SendData(UARTCH1, (uint8_t)buffer[i]) != Ok) 
-                {
-                    // 发送失败处理（根据实际需求添加）
-                    break;
-                }
-            }
-           else if (uartNumber == 2)
-           {
-               if (LPUart_SendData((uint8_t)buffer[i]) != Ok)
-               {
-                   // 发送失败处理（根据实际需求添加）
-                   break;
-               }
-           }
-           else
-           {
-               // do nothing
-           }
-        }
+        (void)UARTIF_write(uartNumber, (const uint8_t *)buffer, (uint16_t)len,
+                           ((__get_IPSR() != 0u) || (__get_PRIMASK() != 0u)) ? UARTIF_TX_LOG : UARTIF_TX_DATA);
     }
 }
 
@@ -319,7 +1044,7 @@ void UARTIF_uartInit(void)
     Clk_SetPeripheralGate(ClkPeripheralCrc, TRUE);
 
     stcUartIrqCb.pfnRxIrqCb = UART_rxIntCallback;
-    stcUartIrqCb.pfnTxIrqCb = NULL;
+    stcUartIrqCb.pfnTxIrqCb = UART_txIntCallback;
     stcUartIrqCb.pfnRxErrIrqCb = UART_errIntCallback;
     stcConfig.pstcIrqCb = &stcUartIrqCb;
     stcConfig.bTouchNvic = TRUE;
@@ -342,12 +1067,18 @@ void UARTIF_uartInit(void)
     Bt_Run(TIM1);
 
     Uart_Init(UARTCH1, &stcConfig);
+    Router_Init(&uartRouter, uartRoutes, UART_ROUTES_NO_V2, &uartPassRoute);
+    Queue_Init(&uartRecdata, uartRxStorage, sizeof(uartRxStorage));
+    Queue_Init(&uartTx.prio, uartTxPrioStorage, sizeof(uartTxPrioStorage));
+    Queue_Init(&uartTx.normal, uartTxStorage, sizeof(uartTxStorage));
+    Queue_Init(&lpuartTx.prio, lpuartTxPrioStorage, sizeof(lpuartTxPrioStorage));
+    Queue_Init(&lpuartTx.normal, lpuartTxStorage, sizeof(lpuartTxStorage));
+
     Uart_EnableIrq(UARTCH1,UartRxIrq);
+    Uart_EnableIrq(UARTCH1,UartTxIrq);
     Uart_ClrStatus(UARTCH1,UartRxFull);
     Uart_EnableFunc(UARTCH1,UartRx);
-
-    Queue_Init(&uartRecdata);
-    Queue_Init(&lpUartRecdata);
+    FramePool_Init();
 
 }
 
@@ -357,10 +1088,10 @@ boolean_t UARTIF_isUartRecEmpty(void)
     return Queue_IsEmpty(&uartRecdata) ? TRUE : FALSE;
 }
 
-// 返回内部 LPUART 接收队列是否为空（TRUE 表示空）
+// 返回帧池是否空闲（没有正在接收或等待处理的帧，TRUE 表示空）
 boolean_t UARTIF_isLpUartRecEmpty(void)
 {
-    return Queue_IsEmpty(&lpUartRecdata) ? TRUE : FALSE;
+    return FramePool_IsIdle() ? TRUE : FALSE;
 }
 
 void UARTIF_lpuartInit(void)
@@ -401,7 +1132,7 @@ void UARTIF_lpuartInit(void)
    stcConfig.pstcRunMode = &stcRunMode;
 
    stcLPUartIrqCb.pfnRxIrqCb = LPUART_rxIntCallback;
-   stcLPUartIrqCb.pfnTxIrqCb = NULL;
+   stcLPUartIrqCb.pfnTxIrqCb = LPUART_txIntCallback;
    stcLPUartIrqCb.pfnRxErrIrqCb = NULL;
    stcConfig.pstcIrqCb = &stcLPUartIrqCb;
    stcConfig.bTouchNvic = TRUE;
@@ -427,340 +1158,405 @@ void UARTIF_lpuartInit(void)
    Bt_Cnt16Set(TIM2,u16timer);
    Bt_Run(TIM2);
 
+   FrameParser_Init(&lpParser, LP_BATCH_MAX_LEN);     // 单帧的 LEN 在 abcdRoute 中按 FRAME_SLOT_SIZE 检查
+   Router_Init(&lpuartRouter, lpuartRoutes, (uint8_t)(sizeof(lpuartRoutes) / sizeof(lpuartRoutes[0])), NULL);
    LPUart_EnableFunc(LPUartRx);
    LPUart_EnableIrq(LPUartRxIrq);
+   LPUart_EnableIrq(LPUartTxIrq);
    LPUart_ClrStatus(LPUartRxFull);
 }
 
-void UARTIF_passThrough(void)
+/**
+ * @brief 打印各协议的接收统计（文本命令 "ROUTES"）：字节、帧、错误数与每字节耗时（SysTick 计数）
+ */
+static void printRouteStats(void)
+{
+    static const char *const names[ROUTE_COUNT] = { "V2", "ABCD", "TEXT", "PASS" };
+    route_stats_t st;
+    uint8_t i;
+
+    for (i = 0; i < ROUTE_COUNT; i++)
+    {
+        Router_GetStats(i, &st);
+        UARTIF_uartPrintf(0, "ROUTE %s: bytes=%lu frames=%lu errors=%lu ticks/byte=%lu\r\n", names[i],
+                          (unsigned long)st.bytes, (unsigned long)st.frames, (unsigned long)st.errors,
+                          (unsigned long)((st.bytes != 0u) ? (st.ticks / st.bytes) : 0u));
+    }
+    UARTIF_uartPrintf(0, "ROUTE unmatched: uart=%lu lpuart=%lu\r\n",
+                      (unsigned long)uartRouter.unmatched, (unsigned long)lpuartRouter.unmatched);
+}
+
+/**
+ * @brief 处理一帧完整的 0xABCD 帧（LPUART 中断已组帧并校验 CRC）
+ * @param payload 帧 PAYLOAD
+ * @param payloadLen PAYLOAD 长度
+ * @param flags 帧头 FLAGS
+ * @param crcOk 中断中 payload CRC 的校验结果
+ */
+static void processLpuartFrame(const uint8_t *payload, uint16_t payloadLen, uint8_t flags, uint8_t crcOk)
 {
-	   uint8_t data = 0;
-    if (!Queue_IsEmpty(&uartRecdata))
+    /* pre-declare variables to satisfy older C compilers */
+    uint8_t isCompressed = 0;
+    size_t copyLen = 0;
+    char tmp[64];  /* 减小到64字节，足够DISPLAY命令 */
+    uint16_t id = 0;
+    flash_result_t fres = FLASH_OK;
+    size_t finalLen = 0;
+    const uint8_t *pData = NULL; /* 指向最终数据的指针 */
+    uint8_t *pageBuf = NULL;     /* 压缩帧解码目的：flash page 缓冲区 */
+    uint8_t isRed;
+    uint8_t dataMagic;
+    rle_decoder_t rle;
+
+    isCompressed = flags & FRAME_FLAG_COMPRESSED;
+    /* flags bit1 (0x02) 用于指示颜色：0=黑色，1=红色 */
+    isRed = (flags & FRAME_FLAG_RED) ? 1u : 0u;
+
+    if (!crcOk)
+    {
+        /* CRC 错误，丢弃本帧（中断已从帧尾之后重新找 MAGIC） */
+        UARTIF_uartPrintf(0, "CRC ERR: len=%u\r\n", payloadLen);
+        return;
+    }
+
+    /* CRC 校验通过，处理payload */
+    if (isCompressed)
     {
-        Queue_Dequeue(&uartRecdata, &data);
-        if (data == '#')
+        /* 压缩帧只用于页数据。第一页先预留空间：垃圾回收会占用 page 缓冲区，必须在解码之前完成 */
+        if (!lpResumable && receivedPageCount == 0 && reserveForTransfer(0u, TRUE) != FLASH_OK) {
+            return;
+        }
+
+        /* 直接解码到即将写入 flash 的 page 缓冲区，不再经过中间缓冲 */
+        pageBuf = FM_getPageBuffer();
+        RLE_DecodeInit(&rle, pageBuf, PAGE_SIZE);
+        if (RLE_DecodeFeed(&rle, payload, payloadLen) != RLE_OK || !RLE_DecodeIsComplete(&rle)) {
+            UARTIF_uartPrintf(0, "RLE decompress FAILED: payloadLen=%u\r\n", payloadLen);
+            /* 丢弃此帧 */
+            return;
+        }
+
+        finalLen = rle.outPos;
+        if (finalLen != PAGE_SIZE) {
+            UARTIF_uartPrintf(0, "RLE decompress size mismatch: got %u expected %u\r\n", (unsigned)finalLen, (unsigned)PAGE_SIZE);
+            /* 丢弃此帧 */
+            return;
+        }
+        pData = pageBuf;
+    }
+    else
+    {
+        /* 未压缩，直接使用帧槽中的数据 */
+        if (payloadLen > PAGE_SIZE) {
+            UARTIF_uartPrintf(0, "Payload too large: %u > %u\r\n", payloadLen, PAGE_SIZE);
+            return;
+        }
+        pData = payload;
+        finalLen = payloadLen;
+    }
+
+    /* 根据finalLen判断是页数据还是控制命令 */
+    if (finalLen == PAGE_SIZE)
+    {
+        /* 写入Flash（直接写入，不经过testWritePage，因为CRC已在帧层验证） */
+        id = (uint16_t)(receivedPageCount | ((uint16_t)currentImageSlot << 8));
+        if (lpResumable) {
+            /* 续传：颜色由 BEGIN/RESUME 指定，已在 flash 中的页不再写第二份 */
+            if ((isRed != 0) != lastImageIsRed) {
+                UARTIF_uartPrintf(0, "Page %u color mismatch, dropped\r\n", receivedPageCount);
+                return;
+            }
+            if (pageBitmap & ((uint64_t)1u << receivedPageCount)) {
+                UARTIF_uartPrintf(0, "Page %u already stored\r\n", receivedPageCount);
+                if (receivedPageCount < MAX_FRAME_NUM) {
+                    receivedPageCount++;
+                }
+                return;
+            }
+        } else if (receivedPageCount == 0) {
+            /* 若是本张图片的第一包，使用 flags 指定颜色（整张图片同色） */
+            /* 第一包：先预留整层空间，保证数据阶段不再触发垃圾回收（压缩帧已在解码前预留） */
+            if (!isCompressed && reserveForTransfer(0u, TRUE) != FLASH_OK) {
+                return;
+            }
+            /* 不可续传的传输：结束之前未完成的可续传传输 */
+            FM_endTransfer();
+            pageBitmap = 0;
+            /* 恢复为原始逻辑：flags 中 1 表示红色 */
+            lastImageIsRed = (isRed != 0);
+            /* 第一次接收到本图像的第一页，标记传输开始 */
+            transferInProgress = true;
+        }
+        dataMagic = lastImageIsRed ? MAGIC_RED_IMAGE_DATA : MAGIC_BW_IMAGE_DATA;
+        /* 行差分：与上一行异或还原。每页写入成功后记下最后一行，供下一页的第一行使用 */
+        if (receivedPageCount == 0) {
+            memset(rowTail, 0, sizeof(rowTail));
+        }
+        if (isCompressed && (flags & FRAME_FLAG_ROW_DELTA)) {
+            /* 续传跳页后上一行未知：跳过的第一页须以非行差分方式发送 */
+            if (receivedPageCount != 0 && rowTailPage != (uint8_t)(receivedPageCount - 1u)) {
+                UARTIF_uartPrintf(0, "Page %u row delta without page %u, dropped\r\n",
+                                  receivedPageCount, receivedPageCount - 1u);
+                return;
+            }
+            RLE_UndoRowDelta(pageBuf, PAGE_SIZE, rowTail, IMAGE_ROW_BYTES);
+        }
+        /* 数据的颜色（RED/BW）已由发送端通过 flags 指定。
+         * 发送端应负责对 RED 通道做按位取反以匹配设备约定，
+         * 因此此处直接把接收到的数据写入 flash，避免在 MCU 栈上分配大数组。
+         */
+        if (isCompressed) {
+            fres = FM_writePageBuffer(dataMagic, id, PAGE_SIZE);
+        } else {
+            fres = FM_writeData(dataMagic, id, pData, PAGE_SIZE);
+        }
+        if (fres == FLASH_OK) {
+            /* Page written OK */
+            /* 写失败时保留原来的上一行，重传的本页仍可按行差分还原 */
+            memcpy(rowTail, &pData[PAGE_SIZE - IMAGE_ROW_BYTES], IMAGE_ROW_BYTES);
+            rowTailPage = (uint8_t)receivedPageCount;
+            pageBitmap |= ((uint64_t)1u << receivedPageCount);
+            lpPagesWritten++;
+            /* 颜色已在写入前根据第一包的 flags 处理 */
+            /* 如果这是最后一页（frame == MAX_FRAME_NUM），则视为本张图片接收完成，写入 image header 并清空对侧通道（不触发显示） */
+            /* 可续传传输则在所有页都收齐时完成 */
+            if (lpResumable ? (pageBitmap == ALL_PAGES_MASK) : (receivedPageCount == MAX_FRAME_NUM))
+            {
+                lpResumable = false;
+                
+                UARTIF_uartPrintf(0, "[PAGE_WRITE] Final page received! slot=%u, page=%u, isRed=%u, redRecv=%u, blackRecv=%u\r\n",
+                                currentImageSlot, receivedPageCount, lastImageIsRed, redLayerReceived, blackLayerReceived);
+                
+                /* Image receive complete */
+                // 追踪接收状态
+                if (lastImageIsRed) {
+                    redLayerReceived = 1;
+                } else {
+                    blackLayerReceived = 1;
+                }
+                
+                if (lastImageIsRed) {
+                    /* RED layer complete */
+                    fres = FM_writeImageHeader(MAGIC_RED_IMAGE_HEADER, currentImageSlot);
+                } else {
+                    fres = FM_writeImageHeader(MAGIC_BW_IMAGE_HEADER, currentImageSlot);
+                }
+
+                if (fres != FLASH_OK) {
+                    UARTIF_uartPrintf(0, "Image header write fail slot=%u err=%d\r\n",
+                                      currentImageSlot, fres);
+                } else {
+                    UARTIF_uartPrintf(0, "Image header written slot=%u\r\n",
+                                      currentImageSlot);
+                }
+            }
+            else
+            {
+                /* 继续接收下一页 */
+                if (receivedPageCount < MAX_FRAME_NUM)
+                {
+                    receivedPageCount++;
+                }
+                else
+                {
+                    UARTIF_uartPrintf(0, "Reached max pages: %d\r\n", MAX_PAGES_SUPPORTED);
+                }
+            }
+        } else {
+            UARTIF_uartPrintf(0, "Flash write fail: page %u id=0x%04X err=%d\r\n",
+                              receivedPageCount, id, fres);
+        }
+    }
+    else
+    {
+        /* 控制命令 */
+        copyLen = (finalLen < sizeof(tmp)-1) ? finalLen : (sizeof(tmp)-1);
+        memcpy(tmp, pData, copyLen);
+        tmp[copyLen] = '\0';
+        UARTIF_uartPrintf(0, "CTRL: '%s'\r\n", tmp);
+
+        /* 控制帧不再改变颜色，颜色由首包决定以保持简单一致 */
+
+        if (strcmp(tmp, "DISPLAY") == 0)
         {
-            Queue_Dequeue(&uartRecdata, &cmd);
+            UARTIF_uartPrintf(0, "DISPLAY: rendering %d pages\r\n", receivedPageCount);
+            UARTIF_uartPrintf(0, "DEBUG: redLayerReceived=%u, blackLayerReceived=%u, lastImageIsRed=%u\r\n", 
+                              redLayerReceived, blackLayerReceived, lastImageIsRed);
             
-            while (Queue_Dequeue(&uartRecdata, &data));
+            /* 如果缺少某层，补全清除 */
+            fres = FLASH_OK;
+            if (redLayerReceived && !blackLayerReceived) {
+                /* 已收红色，缺黑色 - 清除黑色页 */
+                UARTIF_uartPrintf(0, "DISPLAY: RED layer only, clearing BW pages\r\n");
+                fres = clearMissingLayer(MAGIC_BW_IMAGE_DATA, MAGIC_BW_IMAGE_HEADER, 0xFF);
+            } else if (!redLayerReceived && blackLayerReceived) {
+                /* 已收黑色，缺红色 - 清除红色页 */
+                UARTIF_uartPrintf(0, "DISPLAY: BW layer only, clearing RED pages\r\n");
+                fres = clearMissingLayer(MAGIC_RED_IMAGE_DATA, MAGIC_RED_IMAGE_HEADER, 0x00);
+            }
+            if (fres != FLASH_OK) {
+                /* 补全失败不显示（否则是空白页与旧帧混在一起），保留接收状态，主机可重发 DISPLAY */
+                sendFrameStatus(FRAME_STATUS_NO_SPACE);
+                return;
+            }
+
+            EPD_WhiteScreenGDEY042Z98UsingFlashDate(currentImageSlot);
+            receivedPageCount = 0;
+            lpResumable = false;
+            pageBitmap = 0;
+            /* 显示完成后清理传输标志，准备下一个图像 */
+            transferInProgress = false;
+            /* DISPLAY processed */
+            redLayerReceived = 0;
+            blackLayerReceived = 0;
         }
-        else
+        else if (strncmp(tmp, "SET_SLOT:", 9) == 0)
         {
-            LPUart_SendData(data);
-            while (Queue_Dequeue(&uartRecdata, &data)) 
+            int v = atoi(&tmp[9]);
+            if (v >= 1 && v <= 8)
             {
-                LPUart_SendData(data);
+                currentImageSlot = (uint8_t)(v - 1);
+                UARTIF_uartPrintf(0, "SET_SLOT -> %d (slotIndex=%u)\r\n", v, currentImageSlot);
+                /* 重置已接收页计数，准备写入新槽 */
+                receivedPageCount = 0;
+                lpResumable = false;
+                pageBitmap = 0;
             }
-
+            else
+            {
+                UARTIF_uartPrintf(0, "SET_SLOT invalid: %s\r\n", tmp);
+            }
+        }
+        else if (strcmp(tmp, "RESET_PAGES") == 0)
+        {
+            UARTIF_uartPrintf(0, "RESET_PAGES\r\n");
+            receivedPageCount = 0;
+            lpResumable = false;
+            pageBitmap = 0;
         }
+        else if (strncmp(tmp, "BEGIN:", 6) == 0)
+        {
+            startResumableTransfer(&tmp[6], FALSE);
+        }
+        else if (strncmp(tmp, "RESUME:", 7) == 0)
+        {
+            startResumableTransfer(&tmp[7], TRUE);
+        }
+        else if (strncmp(tmp, "MANIFEST:", 9) == 0)
+        {
+            sendManifest(&tmp[9]);
+        }
+        else if (strncmp(tmp, "CREDIT", 6) == 0)
+        {
+            /* "CREDIT" 打开 credit 通告并从本帧开始计数（本帧算第 1 帧），"CREDIT:0" 关闭；
+               之前到达的帧都已处理完，主机丢帧后重发 "CREDIT" 即可精确重新同步 */
+            lpCreditMode = (strcmp(tmp, "CREDIT:0") != 0);
+            lpCreditBase = (uint8_t)(lpFramesDone + lpFramesSkipped);
+            sendFrameStatus(FRAME_STATUS_CREDIT);
+        }
+        else if (strcmp(tmp, "ROUTES") == 0)
+        {
+            printRouteStats();
+        }
+        else if (strcmp(tmp, "HELLO") == 0)
+        {
+            uint8_t resp[FRAME_RESPONSE_MAX];
+            resp[0] = FRAME_STATUS_CAPS;
+            UARTIF_getCaps(&resp[1]);
+            sendFrameResponse(resp, sizeof(resp));
+        }
+        else if (strncmp(tmp, "BATCH:", 6) == 0)
+        {
+            /* 协商批量帧页数：不超过帧槽数量 */
+            int v = atoi(&tmp[6]);
+            uint8_t resp[2];
+            resp[0] = FRAME_STATUS_BATCH;
+            resp[1] = (uint8_t)((v < 1) ? 1 : ((v > LP_BATCH_MAX_PAGES) ? LP_BATCH_MAX_PAGES : v));
+            sendFrameResponse(resp, sizeof(resp));
+        }
+        else if (strcmp(tmp, "COMMIT") == 0)
+        {
+            commitDeltaLayer();
+        }
+        else if (strncmp(tmp, "PAGE:", 5) == 0)
+        {
+            /* 续传时跳到下一个要补发的页 */
+            int v = atoi(&tmp[5]);
+            if (lpResumable && v >= 0 && v <= MAX_FRAME_NUM)
+            {
+                receivedPageCount = (uint16_t)v;
+            }
+            else
+            {
+                UARTIF_uartPrintf(0, "PAGE invalid: %s\r\n", tmp);
+            }
+        }
+    }
+}
 
-        // while (Queue_Dequeue(&uartRecdata, &data)) 
-        // {
-        //     LPUart_SendData(data);
-        // }
-        data = 0;
+void UARTIF_passThrough(void)
+{
+    frame_slot_t *slot = NULL;
+    const uint8_t *span = NULL;
+    uint16_t spanLen = 0;
+    uint8_t resp[3];
+    bool single = false;
+
+    /* 接收队列只有路由判定为透传的字节，'#' 命令与 V2 帧已在中断中分走 */
+    while ((spanLen = Queue_Peek(&uartRecdata, &span)) > 0)
+    {
+        (void)UARTIF_write(2, span, spanLen, UARTIF_TX_DATA);
+        Queue_Consume(&uartRecdata, spanLen);
     }
 
-    if (!Queue_IsEmpty(&lpUartRecdata))
+    /* 每次处理一帧中断已组好的帧 */
+    slot = FramePool_Next();
+    if (slot != NULL)
     {
-        while (Queue_Dequeue(&lpUartRecdata, &data)) 
+        if (slot->source == FRAME_SRC_LPUART)
         {
-            /* 先回显到 UART1 */
-            //Uart_SendData(UARTCH1, data);
-
-                /* 将字节追加到缓冲区（不再依赖回车） */
-                if (bufferIndex < sizeof(buffer) - 1)
-                {
-                    buffer[bufferIndex++] = (char)data;
-                }
+            if ((slot->status & FRAME_RX_BATCH) && !lpBatchOpen)
+            {
+                lpBatchOpen = true;
+                lpBatchMark = lpPagesWritten;
+            }
+            processLpuartFrame(slot->data, slot->len, slot->flags,
+                               (uint8_t)(slot->status & FRAME_RX_CRC_OK));
+            if (slot->status & FRAME_RX_BATCH_END)
+            {
+                /* 一批一个应答：主机据此发下一批或重发本批 */
+                lpBatchOpen = false;
+                resp[0] = FRAME_STATUS_BATCH_ACK;
+                resp[1] = (uint8_t)(lpPagesWritten - lpBatchMark);
+                resp[2] = (uint8_t)receivedPageCount;
+                sendFrameResponse(resp, sizeof(resp));
+            }
+            single = ((slot->status & FRAME_RX_BATCH) == 0u);
+        }
+        else if (slot->source == FRAME_SRC_UART_V2)
+        {
+            ImageTransferV2_HandleFrame(slot->data, slot->len);
+        }
+        FramePool_Release(slot);
 
-                /* 尝试从缓冲区头部解析若干完整帧：
-                 * 新帧格式：MAGIC(2B)=0xABCD | FLAGS(1B) | LEN(2B big-endian) | PAYLOAD(len) | CRC(2B)
-                 */
-                while (bufferIndex >= 7) /* minimal frame header with FLAGS */
-                {
-                    /* pre-declare variables to satisfy older C compilers */
-                    size_t k;
-                    uint8_t flags = 0;
-                    uint16_t payloadLen = 0;
-                    size_t frameTotal = 0;
-                    uint16_t sw_calc = 0;
-                    uint8_t high = 0;
-                    uint8_t low = 0;
-                    uint16_t recv_crc = 0;
-                    uint8_t isCompressed = 0;
-                    size_t copyLen = 0;
-                    char tmp[64];  /* 减小到64字节，足够DISPLAY命令 */
-                    uint16_t i = 0;
-                    uint16_t id = 0;
-                    flash_result_t fres = FLASH_OK;
-                    size_t finalLen = 0;
-                    uint8_t *pData = NULL; /* 指向最终数据的指针 */
-                    uint8_t isRed;
-                    uint8_t dataMagic;
-                    uint8_t clearDataMagic;
-                    uint8_t headerMagic;
-                    uint8_t showMode;
-                    /* 查找并对齐到 MAGIC 开头 */
-                    if ((uint8_t)buffer[0] != FRAME_MAGIC_0 || (uint8_t)buffer[1] != FRAME_MAGIC_1)
-                    {
-                        k = 1;
-                        for (; k + 1 < bufferIndex; ++k)
-                        {
-                            if ((uint8_t)buffer[k] == FRAME_MAGIC_0 && (uint8_t)buffer[k+1] == FRAME_MAGIC_1) break;
-                        }
-                        if (k + 1 >= bufferIndex)
-                        {
-                            /* 未找到 MAGIC，清空缓冲区以避免无限增长 */
-                            bufferIndex = 0;
-                            break;
-                        }
-                        /* 丢弃前 k 字节并继续 */
-                        memmove(buffer, &buffer[k], bufferIndex - k);
-                        bufferIndex -= k;
-                        continue;
-                    }
-
-                    /* 至少需要 5 字节以读取 FLAGS + LEN */
-                    if (bufferIndex < 5) break;
-
-                    flags = (uint8_t)buffer[2];
-                    payloadLen = (((uint8_t)buffer[3]) << 8) | (uint8_t)buffer[4];           
-                    isCompressed = flags & 0x01;
-                    /* flags bit1 (0x02) 用于指示颜色：0=黑色，1=红色 */
-                    isRed = (flags & 0x02) ? 1u : 0u;
-
-                    if (payloadLen > FRAME_MAX_PAYLOAD)
-                    {
-                        /* 非法长度，丢弃首字节重同步 */
-                        memmove(buffer, &buffer[1], bufferIndex - 1);
-                        bufferIndex -= 1;
-                        continue;
-                    }
-
-                    frameTotal = 2 + 1 + 2 + (size_t)payloadLen + 2; /* MAGIC+FLAGS+LEN+PAYLOAD+CRC */
-                    if (bufferIndex < frameTotal) break; /* 等待更多字节 */
-
-                    /* 计算并比较 CRC（对压缩后的 payload 计算） */
-                    sw_calc = crc16_ccitt((uint8_t *)&buffer[5], (uint32_t)payloadLen);
-                    high = (uint8_t)buffer[5 + payloadLen];
-                    low = (uint8_t)buffer[5 + payloadLen + 1];
-                    recv_crc = ((uint16_t)high << 8) | (uint16_t)low;
-
-                    if (sw_calc == recv_crc)
-                    {
-                        /* CRC 校验通过，处理payload */
-                        if (isCompressed)
-                        {
-                            /* 解压到静态缓冲区 */
-                            finalLen = decompressPageRLE((uint8_t *)&buffer[5], payloadLen,
-                                                         decompressBuffer, PAGE_SIZE);
-
-                            if (finalLen == 0) {
-                                UARTIF_uartPrintf(0, "RLE decompress FAILED: payloadLen=%u\r\n", payloadLen);
-                                /* 丢弃此帧 */
-                                if (bufferIndex > frameTotal) {
-                                    memmove(buffer, &buffer[frameTotal], bufferIndex - frameTotal);
-                                }
-                                bufferIndex -= frameTotal;
-                                continue;
-                            }
-                            
-                            if (finalLen != PAGE_SIZE) {
-                                UARTIF_uartPrintf(0, "RLE decompress size mismatch: got %u expected %u\r\n", (unsigned)finalLen, (unsigned)PAGE_SIZE);
-                                /* 丢弃此帧 */
-                                if (bufferIndex > frameTotal) {
-                                    memmove(buffer, &buffer[frameTotal], bufferIndex - frameTotal);
-                                }
-                                bufferIndex -= frameTotal;
-                                continue;
-                            }
-
-                            /* RLE OK */
-                            pData = decompressBuffer;
-                        }
-                        else
-                        {
-                            /* 未压缩，直接使用buffer中的数据 */
-                            if (payloadLen > PAGE_SIZE) {
-                                UARTIF_uartPrintf(0, "Payload too large: %u > %u\r\n", payloadLen, PAGE_SIZE);
-                                if (bufferIndex > frameTotal) {
-                                    memmove(buffer, &buffer[frameTotal], bufferIndex - frameTotal);
-                                }
-                                bufferIndex -= frameTotal;
-                                continue;
-                            }
-                            pData = (uint8_t *)&buffer[5];
-                            finalLen = payloadLen;
-                        }
-
-                        /* 根据finalLen判断是页数据还是控制命令 */
-                        if (finalLen == PAGE_SIZE)
-                        {
-                            /* 写入Flash（直接写入，不经过testWritePage，因为CRC已在帧层验证） */
-                            id = (uint16_t)(receivedPageCount | ((uint16_t)currentImageSlot << 8));
-                            /* 若是本张图片的第一包，使用 flags 指定颜色（整张图片同色） */
-                            if (receivedPageCount == 0) {
-                                /* 恢复为原始逻辑：flags 中 1 表示红色 */
-                                lastImageIsRed = (isRed != 0);
-                                /* 第一次接收到本图像的第一页，标记传输开始 */
-                                transferInProgress = true;
-                            }
-                            dataMagic = lastImageIsRed ? MAGIC_RED_IMAGE_DATA : MAGIC_BW_IMAGE_DATA;
-                            /* 数据的颜色（RED/BW）已由发送端通过 flags 指定。
-                             * 发送端应负责对 RED 通道做按位取反以匹配设备约定，
-                             * 因此此处直接把接收到的 pData 写入 flash，避免在 MCU 栈上分配大数组。
-                             */
-                            fres = FM_writeData(dataMagic, id, pData, PAGE_SIZE);
-                            if (fres == FLASH_OK) {
-                                /* Page written OK */
-                                /* 颜色已在写入前根据第一包的 flags 处理 */
-                                /* 如果这是最后一页（frame == MAX_FRAME_NUM），则视为本张图片接收完成，写入 image header 并清空对侧通道（不触发显示） */
-                                if (receivedPageCount == MAX_FRAME_NUM)
-                                {
-                                    
-                                    UARTIF_uartPrintf(0, "[PAGE_WRITE] Final page received! slot=%u, page=%u, isRed=%u, redRecv=%u, blackRecv=%u\r\n",
-                                                    currentImageSlot, receivedPageCount, lastImageIsRed, redLayerReceived, blackLayerReceived);
-                                    
-                                    /* Image receive complete */
-                                    // 追踪接收状态
-                                    if (lastImageIsRed) {
-                                        redLayerReceived = 1;
-                                    } else {
-                                        blackLayerReceived = 1;
-                                    }
-                                    
-                                    if (lastImageIsRed) {
-                                        /* RED layer complete */
-                                        fres = FM_writeImageHeader(MAGIC_RED_IMAGE_HEADER, currentImageSlot);
-                                    } else {
-                                        fres = FM_writeImageHeader(MAGIC_BW_IMAGE_HEADER, currentImageSlot);
-                                    }
-
-                                    if (fres != FLASH_OK) {
-                                        UARTIF_uartPrintf(0, "Image header write fail slot=%u err=%d\r\n",
-                                                          currentImageSlot, fres);
-                                    } else {
-                                        UARTIF_uartPrintf(0, "Image header written slot=%u\r\n",
-                                                          currentImageSlot);
-                                    }
-                                }
-                                else
-                                {
-                                    /* 继续接收下一页 */
-                                    if (receivedPageCount < MAX_FRAME_NUM)
-                                    {
-                                        receivedPageCount++;
-                                    }
-                                    else
-                                    {
-                                        UARTIF_uartPrintf(0, "Reached max pages: %d\r\n", MAX_PAGES_SUPPORTED);
-                                    }
-                                }
-                            } else {
-                                UARTIF_uartPrintf(0, "Flash write fail: page %u id=0x%04X err=%d\r\n",
-                                                  receivedPageCount, id, fres);
-                            }
-                        }
-                        else
-                        {
-                            /* 控制命令 */
-                            copyLen = (finalLen < sizeof(tmp)-1) ? finalLen : (sizeof(tmp)-1);
-                            memcpy(tmp, pData, copyLen);
-                            tmp[copyLen] = '\0';
-                            UARTIF_uartPrintf(0, "CTRL: '%s'\r\n", tmp);
-
-                            /* 控制帧不再改变颜色，颜色由首包决定以保持简单一致 */
-
-                            if (strcmp(tmp, "DISPLAY") == 0)
-                            {
-                                UARTIF_uartPrintf(0, "DISPLAY: rendering %d pages\r\n", receivedPageCount);
-                                UARTIF_uartPrintf(0, "DEBUG: redLayerReceived=%u, blackLayerReceived=%u, lastImageIsRed=%u\r\n", 
-                                                  redLayerReceived, blackLayerReceived, lastImageIsRed);
-                                
-                                /* 如果缺少某层，补全清除 */
-                                if (redLayerReceived && !blackLayerReceived) {
-                                    /* 已收红色，缺黑色 - 清除黑色页 */
-                                    uint16_t j;
-                                    uint16_t wid;                                    
-                                    for (j = 0; j <= MAX_FRAME_NUM; ++j) {
-                                        memset(buffer, 0xFF, PAYLOAD_SIZE);
-                                        wid = (uint16_t)(j | ((uint16_t)currentImageSlot << 8));
-                                        FM_writeData(MAGIC_BW_IMAGE_DATA, wid, buffer, PAYLOAD_SIZE);
-                                        if (fres != FLASH_OK) {
-                                            UARTIF_uartPrintf(0, "CLEAR BW page %u fail id=0x%04X err=%d\n", j, wid, fres);
-                                            break;
-                                        }
-                                    }
-                                    fres = FM_writeImageHeader(MAGIC_BW_IMAGE_HEADER, currentImageSlot);
-                                    UARTIF_uartPrintf(0, "DISPLAY: RED layer only, clearing BW pages\r\n");
-                                } else if (!redLayerReceived && blackLayerReceived) {
-                                    /* 已收黑色，缺红色 - 清除红色页 */
-                                    uint16_t j;
-                                    uint16_t wid;
-                                    for (j = 0; j <= MAX_FRAME_NUM; ++j) {
-                                        memset(buffer, 0x00, PAYLOAD_SIZE);
-                                        wid = (uint16_t)(j | ((uint16_t)currentImageSlot << 8));
-                                        FM_writeData(MAGIC_RED_IMAGE_DATA, wid, buffer, PAYLOAD_SIZE);
-                                        if (fres != FLASH_OK) {
-                                            UARTIF_uartPrintf(0, "CLEAR BW page %u fail id=0x%04X err=%d\n", j, wid, fres);
-                                            break;
-                                        }
-                                    }
-                                    fres = FM_writeImageHeader(MAGIC_RED_IMAGE_HEADER, currentImageSlot);
-                                    UARTIF_uartPrintf(0, "DISPLAY: BW layer only, clearing RED pages\r\n");
-                                }
-
-                                EPD_WhiteScreenGDEY042Z98UsingFlashDate(currentImageSlot);
-                                receivedPageCount = 0;
-                                /* 显示完成后清理传输标志，准备下一个图像 */
-                                transferInProgress = false;
-                                /* DISPLAY processed */
-                                redLayerReceived = 0;
-                                blackLayerReceived = 0;
-                            }
-                            else if (strncmp(tmp, "SET_SLOT:", 9) == 0)
-                            {
-                                int v = atoi(&tmp[9]);
-                                if (v >= 1 && v <= 8)
-                                {
-                                    currentImageSlot = (uint8_t)(v - 1);
-                                    UARTIF_uartPrintf(0, "SET_SLOT -> %d (slotIndex=%u)\r\n", v, currentImageSlot);
-                                    /* 重置已接收页计数，准备写入新槽 */
-                                    receivedPageCount = 0;
-                                }
-                                else
-                                {
-                                    UARTIF_uartPrintf(0, "SET_SLOT invalid: %s\r\n", tmp);
-                                }
-                            }
-                            else if (strcmp(tmp, "RESET_PAGES") == 0)
-                            {
-                                UARTIF_uartPrintf(0, "RESET_PAGES\r\n");
-                                receivedPageCount = 0;
-                            }
-                        }
-
-                        /* 移除已处理的完整帧并继续解析后续帧 */
-                        if (bufferIndex > frameTotal)
-                        {
-                            memmove(buffer, &buffer[frameTotal], bufferIndex - frameTotal);
-                        }
-                        bufferIndex -= frameTotal;
-                        continue;
-                    }
-                    else
-                    {
-                        /* CRC 错误 */
-                        UARTIF_uartPrintf(0, "CRC ERR: recv=0x%04X calc=0x%04X\r\n", recv_crc, sw_calc);
-                        memmove(buffer, &buffer[1], bufferIndex - 1);
-                        bufferIndex -= 1;
-                        continue;
-                    }
-                }
-            // }
+        /* 帧槽归还后上限才增加：credit 模式下马上告诉主机 */
+        if (single)
+        {
+            lpFramesDone++;
+            if (lpCreditMode)
+            {
+                sendFrameStatus(FRAME_STATUS_CREDIT);
+            }
         }
-        data = 0;
+    }
+    else if (lpBatchLostAcked != lpBatchLost)
+    {
+        /* 就绪帧都处理完再应答，不会排到之前的批量应答前面；0 页表示整批重发 */
+        lpBatchLostAcked++;
+        resp[0] = FRAME_STATUS_BATCH_ACK;
+        resp[1] = 0;
+        resp[2] = (uint8_t)receivedPageCount;
+        sendFrameResponse(resp, sizeof(resp));
     }
 }
 
@@ -932,28 +1728,10 @@ boolean_t UARTIF_isTransferActive(void)
     if (transferInProgress) return TRUE;
     if (receivedPageCount != 0) return TRUE;
     if (redLayerReceived || blackLayerReceived) return TRUE;
-    if (bufferIndex != 0) return TRUE;
+    if (FrameParser_IsBusy(&lpParser)) return TRUE;
     return FALSE;
 }
 
-uint16_t UARTIF_fetchDataFromUart(uint8_t *buf, uint16_t *idx)
-{
-    uint8_t byte;
-    uint16_t cnt = 0;
-    if (idx == NULL) return 0;
-    if (buf == NULL) return 0;
-
-    // 快速提取所有队列数据，不做阻塞操作（不做echo）
-    // 这确保数据帧能在单个处理周期内完整接收
-    while (!Queue_IsEmpty(&uartRecdata))
-    {
-        Queue_Dequeue(&uartRecdata, &byte);
-        buf[(*idx)++] = byte;
-        cnt++;
-    }
-    return cnt;
-}
-
 /**
  * @brief 获取UART接收统计信息
  * @param rxCount 指针，返回接收总字节数
@@ -6,13 +6,40 @@
 
 extern volatile int8_t currentImageSlot;
 
+// 发送通道：日志满则丢弃；透传数据与协议应答等待空间，协议应答优先发送
+#define UARTIF_TX_LOG       0
+#define UARTIF_TX_DATA      1
+#define UARTIF_TX_PRIORITY  2
+
 void UARTIF_uartPrintf(uint8_t uartNumber, const char *format, ...);
+boolean_t UARTIF_write(uint8_t uartNumber, const uint8_t *data, uint16_t len, uint8_t lane);
+void UARTIF_holdPriority(uint8_t uartNumber, boolean_t hold);
+uint16_t UARTIF_txSpace(uint8_t uartNumber);
+void UARTIF_flushTx(void);
+void UARTIF_getTxStats(uint32_t *uartDropped, uint32_t *lpuartDropped);
 void UARTIF_uartPrintfFloat(uint8_t uartNumber, const char *head, const float data);
 void UARTIF_uartInit(void);
 void UARTIF_lpuartInit(void);
 void UARTIF_passThrough(void);
 uint8_t UARTIF_passThroughCmd(void);
-uint16_t UARTIF_fetchDataFromUart(uint8_t *buf, uint16_t *idx);
+void UARTIF_enableV2Framing(boolean_t enable);
+
+/* HELLO/CAPS 能力描述（两条链路相同，小端）：
+   [0] 协议版本  [1] 链路协议位图  [2..3] 0xABCD 帧最大 PAYLOAD  [4] V2 最大窗口  [5] 批量帧最大页数
+   [6] 编解码/功能位图  [7] 槽位数  [8..9] 宽  [10..11] 高  [12] 图层数  [13..14] 空闲 flash 页  [15] 每页字节数 */
+#define UARTIF_PROTO_VERSION    1
+#define UARTIF_CAPS_LEN         16
+#define UARTIF_CAPS_LINK_V1     0x01    // 0xA5A5A5A5 帧（已移除，固件不再置位，保留位号）
+#define UARTIF_CAPS_LINK_V2     0x02    // UART1 0x55 ... 0xAA 帧
+#define UARTIF_CAPS_LINK_ABCD   0x04    // LPUART/E104 0xABCD 帧
+#define UARTIF_CAPS_RLE         0x01    // 0xABCD 页 RLE 压缩
+#define UARTIF_CAPS_ROW_DELTA   0x02    // 0xABCD 页行差分
+#define UARTIF_CAPS_BATCH       0x04    // 0xABCD 批量帧
+#define UARTIF_CAPS_RESUME      0x08    // 断线续传（V2 BEGIN/RESUME，LPUART BEGIN:/RESUME:）
+#define UARTIF_CAPS_DELTA       0x10    // 增量更新（MANIFEST + END_DELTA/COMMIT）
+#define UARTIF_CAPS_SACK        0x20    // V2 滑动窗口 + SACK
+#define UARTIF_CAPS_CREDIT      0x40    // 0xABCD 应答附 credit 上限（"CREDIT"）
+void UARTIF_getCaps(uint8_t *caps);
 void UARTIF_getUartStats(uint32_t *rxCount, uint32_t *overflowCount);
 void UARTIF_resetUartStats(void);
 
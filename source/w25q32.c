@@ -24,12 +24,24 @@
 #include "spi.h"
 #include "ddl.h"
 #include "w25q32.h"
+#include "lpm.h"
 #include "uart_interface.h"
 
 /******************************************************************************
  * Local pre-processor symbols/macros ('#define')                            
  ******************************************************************************/
-#define FLASH_TOTAL_SIZE        0x400000    // 4MB总容量
+#define FLASH_TOTAL_SIZE        (flashGeometry.totalSize)  // 运行时总容量
+
+#define SFDP_SIGNATURE          0x50444653u // "SFDP"
+#define SFDP_BFPT_ID            0xFF00u     // 基本参数表 ID
+#define SFDP_BFPT_MIN_DWORDS    9u          // 需要读取到 DWORD9（擦除类型3/4）
+#define JEDEC_MIN_CAPACITY_CODE 0x10u       // 64KB
+#define JEDEC_MAX_CAPACITY_CODE 0x20u       // 4GB，超出视为无效 ID
+#define JEDEC_ADDR3_CAPACITY_CODE 0x18u     // 16MB，无 SFDP 时容量上限
+
+#define OP_EWMA_SHIFT           3u          // EWMA 系数 1/8
+#define OP_POLL_DIVISOR         16u         // 预计耗时后的轮询间隔 = 预计耗时/16
+#define W25Q32_TRES1_WAIT_US    100u        // 唤醒等待时间（delay100us(1)）
 
 /******************************************************************************
  * Global variable definitions (declared in header file with 'extern')
@@ -42,10 +54,61 @@
 /******************************************************************************
  * Local function prototypes ('static')
  ******************************************************************************/
+static void sendCmdAddr(uint8_t cmd, uint32_t addr);
+static uint8_t readBegin(void);
+static void readEnd(uint8_t resume);
+static uint32_t waitUnits(uint32_t units);
+static void recordOpTime(w25q32_op_t op, uint32_t units);
+static void waitBusy(w25q32_op_t op);
+static uint8_t eraseBlocking(w25q32_op_t op, uint8_t cmd, uint32_t addr);
+static void releasePowerDown(void);
+static void readSfdp(uint32_t addr, uint8_t *buf, uint16_t len);
+static uint8_t parseSfdp(void);
 
 /******************************************************************************
  * Local variable definitions ('static')                                      *
  ******************************************************************************/
+/* 器件参数，默认为 W25Q32 */
+static w25q32_geometry_t flashGeometry = {
+    0,
+    W25Q32_TOTAL_SIZE,
+    3,
+    0,
+    {
+        { W25Q32_SECTOR_SIZE,  W25Q32_CMD_SECTOR_ERASE },
+        { 32768u,              W25Q32_CMD_32K_BLOCK_ERASE },
+        { W25Q32_BLOCK_SIZE,   W25Q32_CMD_64K_BLOCK_ERASE },
+        { 0, 0 }
+    }
+};
+
+/* 当前异步操作状态 */
+static w25q32_op_t asyncOp = W25Q32_OP_NONE;
+static uint32_t asyncAddr = 0;
+static w25q32_done_cb_t asyncCb = NULL;
+static void *asyncCtx = NULL;
+static uint8_t asyncSuspended = 0;
+
+/* 各操作的耗时统计，下标为 w25q32_op_t，时间单位 100us */
+static w25q32_op_stats_t opStats[W25Q32_OP_COUNT];
+/* 数据手册典型值，作为首次测量前的预估 */
+static const uint32_t opTypicalUnits[W25Q32_OP_COUNT] = {
+    0,          // NONE
+    450,        // tSE   45ms
+    1200,       // tBE1  120ms
+    1500,       // tBE2  150ms
+    100000,     // tCE   10s
+    7,          // tPP   0.7ms
+};
+/* 毫秒节拍源，设置后长时间等待期间进入 Lpm 睡眠 */
+static const volatile uint32_t *tickSourceMs = NULL;
+static uint16_t tickPeriodMs = 0;
+
+/* 深度掉电状态 */
+static uint8_t autoPowerDown = 1;
+static uint8_t powerDown = 0;
+static uint32_t powerDownStartMs = 0;
+static w25q32_power_stats_t powerStats;
 
 /******************************************************************************
  * Local pre-processor symbols/macros ('#define')                             
@@ -54,9 +117,197 @@
 /*****************************************************************************
  * Function implementation - global ('extern') and local ('static')
  ******************************************************************************/
-/* 片选控制函数 */
+/* 拉低CS并发送命令和24位地址（CS由调用者拉高） */
+static void sendCmdAddr(uint8_t cmd, uint32_t addr)
+{
+    uint8_t hdr[5];
+    uint8_t n = 0;
+
+    hdr[n++] = cmd;
+    if (flashGeometry.addrBytes == 4)
+    {
+        hdr[n++] = (uint8_t)((addr >> 24) & 0xFF);
+    }
+    hdr[n++] = (uint8_t)((addr >> 16) & 0xFF);
+    hdr[n++] = (uint8_t)((addr >> 8) & 0xFF);
+    hdr[n++] = (uint8_t)(addr & 0xFF);
+    W25Q32_CS(0);
+    Spi_SendBuf(hdr, n);
+}
+
+/* 读操作前：若有异步操作正在执行则挂起，返回是否需要在读完后恢复
+ * 不能挂起（整片擦除、挂起超时）时等待操作结束，不在忙状态下读 */
+static uint8_t readBegin(void)
+{
+    if ((asyncOp == W25Q32_OP_NONE) || asyncSuspended)
+    {
+        return 0;
+    }
+    if (W25Q32_Suspend() != W25Q32_OK)
+    {
+        W25Q32_WaitAsync();
+    }
+    return asyncSuspended;
+}
+
+/* 读操作后：恢复 readBegin() 挂起的操作 */
+static void readEnd(uint8_t resume)
+{
+    if (resume)
+    {
+        W25Q32_Resume();
+    }
+}
+
+/* 等待指定时间（100us 为单位），有节拍源且时间够长时睡眠等待，返回实际经过时间 */
+static uint32_t waitUnits(uint32_t units)
+{
+    uint32_t start;
+    uint32_t elapsedMs;
+
+    if ((tickSourceMs != NULL) && (units >= (uint32_t)tickPeriodMs * 20u))
+    {
+        // 节拍中断（以及其他中断）会唤醒 WFI，到时后返回
+        start = *tickSourceMs;
+        do
+        {
+            Lpm_GotoLpmMode();
+            elapsedMs = *tickSourceMs - start;
+        }
+        while (elapsedMs * 10u < units);
+        return elapsedMs * 10u;
+    }
+    delay100us(units);
+    return units;
+}
+
+/* 记录一次操作耗时：更新 EWMA（W25Q32_OP_STATS_DETAIL 时还有最值和直方图） */
+static void recordOpTime(w25q32_op_t op, uint32_t units)
+{
+    w25q32_op_stats_t *st = &opStats[op];
+#if W25Q32_OP_STATS_DETAIL
+    uint32_t bound = 4u;
+    uint8_t bin = 0;
+#endif
+
+    if (st->count == 0)
+    {
+        st->ewma = units;
+#if W25Q32_OP_STATS_DETAIL
+        st->min = units;
+        st->max = units;
+#endif
+    }
+    else
+    {
+        if (units >= st->ewma)
+        {
+            st->ewma += (units - st->ewma) >> OP_EWMA_SHIFT;
+        }
+        else
+        {
+            st->ewma -= (st->ewma - units) >> OP_EWMA_SHIFT;
+        }
+#if W25Q32_OP_STATS_DETAIL
+        if (units < st->min) st->min = units;
+        if (units > st->max) st->max = units;
+#endif
+    }
+    if (st->count < 0xffff)
+    {
+        st->count++;
+    }
+
+#if W25Q32_OP_STATS_DETAIL
+    // 直方图按 4 倍递增分桶：<0.4ms, <1.6ms, <6.4ms ... >=1.6s
+    while ((bin < W25Q32_HIST_BINS - 1) && (units >= bound))
+    {
+        bin++;
+        bound <<= 2;
+    }
+    if (st->hist[bin] < 0xffff)
+    {
+        st->hist[bin]++;
+    }
+#endif
+}
+
+/* 等待擦除/编程完成：先按学习到的耗时等待其 3/4，再按耗时/16 的间隔轮询 */
+static void waitBusy(w25q32_op_t op)
+{
+    uint32_t expected;
+    uint32_t interval;
+    uint32_t elapsed;
+
+    expected = W25Q32_GetExpectedTime(op);
+    interval = expected / OP_POLL_DIVISOR;
+    if (interval == 0)
+    {
+        interval = 1;
+    }
+
+    elapsed = 0;
+    if (expected >= 4u)
+    {
+        elapsed = waitUnits(expected - (expected >> 2));
+    }
+    while (W25Q32_ReadStatusReg() & W25Q32_SR1_BUSY)
+    {
+        elapsed += waitUnits(interval);
+    }
+    recordOpTime(op, elapsed);
+}
+
+/* 同步擦除：发送命令后等待完成
+ * 写使能没有生效（写保护、SPI 异常）时不发送擦除命令，返回 W25Q32_ERROR
+ */
+static uint8_t eraseBlocking(w25q32_op_t op, uint8_t cmd, uint32_t addr)
+{
+    W25Q32_WaitAsync();
+
+    W25Q32_WriteEnable();          // 使能写操作
+    if ((W25Q32_ReadStatusReg() & W25Q32_SR1_WEL) == 0)
+    {
+        return W25Q32_ERROR;
+    }
+    if (op == W25Q32_OP_ERASE_CHIP)
+    {
+        W25Q32_CS(0);
+        Spi_SendData(cmd);
+    }
+    else
+    {
+        sendCmdAddr(cmd, addr);
+    }
+    W25Q32_CS(1);
+    waitBusy(op);
+    return W25Q32_OK;
+}
+
+/* 发送退出深度掉电命令并等待 tRES1 */
+static void releasePowerDown(void)
+{
+    Gpio_SetIO(1, 4, 0);
+    Spi_SendData(W25Q32_CMD_RELEASE_POWER_DOWN);
+    Gpio_SetIO(1, 4, 1);
+    // tRES1 最大 3us，等待期间任何命令都会被忽略
+    delay100us(1);
+}
+
+/* 片选控制函数（处于深度掉电时，第一次拉低CS前先唤醒） */
 void W25Q32_CS(uint8_t state) 
 {
+    if ((state == 0) && powerDown)
+    {
+        powerDown = 0;
+        releasePowerDown();
+        powerStats.wakeCount++;
+        powerStats.wakePenaltyUs += W25Q32_TRES1_WAIT_US;
+        if (tickSourceMs != NULL)
+        {
+            powerStats.powerDownMs += *tickSourceMs - powerDownStartMs;
+        }
+    }
     Gpio_SetIO(1, 4, state); //DC输出高
 }
 
@@ -65,6 +316,8 @@ void W25Q32_Init(void)
 {
     Gpio_InitIO(1, 4, GpioDirOut);
     Gpio_SetIO(1, 4, 1);               //RST输出高
+    // MCU 复位时 flash 可能仍处于深度掉电，此时SPI尚未初始化，标记为掉电让第一次访问时唤醒
+    powerDown = 1;
 }
 
 /* 读取状态寄存器1 (BUSY位在bit0) */
@@ -147,143 +400,241 @@ uint32_t W25Q32_ReadID(void)
     return (idBuf[0] << 16) | (idBuf[1] << 8) | idBuf[2];
 }
 
-/* 扇区擦除 (4KB) */
-void W25Q32_EraseSector(uint32_t sectorAddr) 
-{    
-       uint8_t sts = 0;
+/* 读取SFDP表（固定3字节地址 + 8个dummy时钟） */
+static void readSfdp(uint32_t addr, uint8_t *buf, uint16_t len)
+{
+    uint8_t hdr[5];
 
-    W25Q32_WriteEnable();          // 使能写操作
+    hdr[0] = W25Q32_CMD_READ_SFDP;
+    hdr[1] = (uint8_t)((addr >> 16) & 0xFF);
+    hdr[2] = (uint8_t)((addr >> 8) & 0xFF);
+    hdr[3] = (uint8_t)(addr & 0xFF);
+    hdr[4] = 0x00;    // dummy
     W25Q32_CS(0);
+    Spi_SendBuf(hdr, sizeof(hdr));
+    Spi_ReceiveBuf(buf, len);
+    W25Q32_CS(1);
+}
 
-    Spi_SendData(W25Q32_CMD_SECTOR_ERASE);
-    Spi_SendData((uint8_t)((sectorAddr >> 16) & 0xFF));
-    Spi_SendData((uint8_t)((sectorAddr >> 8) & 0xFF));
-    Spi_SendData((uint8_t)(sectorAddr & 0xFF));
+/* 解析SFDP基本参数表（JESD216），成功返回 W25Q32_OK 并更新 flashGeometry */
+static uint8_t parseSfdp(void)
+{
+    uint8_t buf[SFDP_BFPT_MIN_DWORDS * 4u];
+    uint32_t dw;
+    uint32_t ptp;
+    uint32_t size;
+    uint8_t i;
+
+    readSfdp(0, buf, 16);
+    dw = (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+    // 第一个参数头必须是基本参数表，长度至少9个DWORD
+    if ((dw != SFDP_SIGNATURE) || (buf[8] != (uint8_t)(SFDP_BFPT_ID & 0xFF)) ||
+        (buf[15] != (uint8_t)(SFDP_BFPT_ID >> 8)) || (buf[11] < SFDP_BFPT_MIN_DWORDS))
+    {
+        return W25Q32_ERROR;
+    }
+    ptp = (uint32_t)buf[12] | ((uint32_t)buf[13] << 8) | ((uint32_t)buf[14] << 16);
 
-    UARTIF_uartPrintf(0, "Waiting for erase sector .");
+    readSfdp(ptp, buf, sizeof(buf));
 
-    W25Q32_CS(1);
-    do 
+    // DWORD2: 容量（bit31=0 时为 位数-1，否则为 2^N 位）
+    dw = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) | ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+    if (dw & 0x80000000u)
     {
-        sts = W25Q32_ReadStatusReg();
-        // UARTIF_uartPrintf(0, "Status Reg 1 is 0x%x ! \n", sts);
-        UARTIF_uartPrintf(0, ".");
-
-        delay1ms(50);
+        dw &= 0x7FFFFFFFu;
+        if ((dw < 3u) || (dw > 34u))
+        {
+            return W25Q32_ERROR;
+        }
+        size = (uint32_t)1u << (dw - 3u);
     }
-    while(sts & 0x01);
-    UARTIF_uartPrintf(0, "\n");
-    // W25Q32_WaitForReady();         // 等待擦除完成
-}
+    else
+    {
+        size = (dw >> 3) + 1u;
+    }
+    if (size < W25Q32_BLOCK_SIZE)
+    {
+        return W25Q32_ERROR;
+    }
+    flashGeometry.totalSize = size;
 
-void W25Q32_Erase32k(uint32_t addr) 
-{    
-       uint8_t sts = 0;
+    // DWORD1 bit18:17: 00 仅3字节，01 3/4字节，10 仅4字节
+    flashGeometry.addrBytes = (((buf[2] >> 1) & 0x03) == 0x02) ? 4 : 3;
 
-    W25Q32_WriteEnable();          // 使能写操作
-    W25Q32_CS(0);
+    // DWORD8/DWORD9: 4种擦除类型，每种为 [size 2^N][opcode]
+    for (i = 0; i < W25Q32_MAX_ERASE_TYPES; i++)
+    {
+        dw = buf[28u + i * 2u];
+        if ((dw == 0u) || (dw > 24u))
+        {
+            flashGeometry.erase[i].size = 0;
+            flashGeometry.erase[i].opcode = 0;
+        }
+        else
+        {
+            flashGeometry.erase[i].size = (uint32_t)1u << dw;
+            flashGeometry.erase[i].opcode = buf[29u + i * 2u];
+        }
+    }
+    flashGeometry.fromSfdp = 1;
+    return W25Q32_OK;
+}
 
-    Spi_SendData(W25Q32_CMD_32K_BLOCK_ERASE);
-    Spi_SendData((uint8_t)((addr >> 16) & 0xFF));
-    Spi_SendData((uint8_t)((addr >> 8) & 0xFF));
-    Spi_SendData((uint8_t)(addr & 0xFF));
-    UARTIF_uartPrintf(0, "Waiting for erase 32k .");
+/* 读取JEDEC ID和SFDP，得到运行时容量/擦除粒度/地址宽度
+ * SFDP 无效时按 JEDEC 容量码（2^N 字节，最多 16MB）推算，都无效时保持 W25Q32 默认值
+ */
+uint8_t W25Q32_ProbeGeometry(void)
+{
+    uint8_t cap;
+    uint8_t re = W25Q32_OK;
 
-    W25Q32_CS(1);
-    do 
+    flashGeometry.jedecId = W25Q32_ReadID();
+    if (parseSfdp() != W25Q32_OK)
     {
-        sts = W25Q32_ReadStatusReg();
-        // UARTIF_uartPrintf(0, "Status Reg 1 is 0x%x ! \n", sts);
-        UARTIF_uartPrintf(0, ".");
+        cap = (uint8_t)((flashGeometry.jedecId >> 16) & 0xFF);
+        if ((cap >= JEDEC_MIN_CAPACITY_CODE) && (cap <= JEDEC_MAX_CAPACITY_CODE) &&
+            ((flashGeometry.jedecId & 0xFF) != 0xFF) && ((flashGeometry.jedecId & 0xFF) != 0x00))
+        {
+            // 无 SFDP 时不切换 4 字节地址，只用前 16MB（flash 管理器也只管理 16MB），同时避免 1u << 32
+            if (cap > JEDEC_ADDR3_CAPACITY_CODE)
+            {
+                cap = JEDEC_ADDR3_CAPACITY_CODE;
+            }
+            flashGeometry.totalSize = (uint32_t)1u << cap;
+        }
+        else
+        {
+            re = W25Q32_ERROR;
+        }
+        flashGeometry.addrBytes = (flashGeometry.totalSize > 0x1000000u) ? 4 : 3;
+    }
 
-        delay1ms(100);
+    // 超过16MB的器件必须切换到4字节地址，之后所有地址命令都发送4字节
+    if (flashGeometry.totalSize > 0x1000000u)
+    {
+        W25Q32_CS(0);
+        Spi_SendData(W25Q32_CMD_ENTER_4B_MODE);
+        W25Q32_CS(1);
+        flashGeometry.addrBytes = 4;
     }
-    while(sts & 0x01);
-    UARTIF_uartPrintf(0, "\n");
+    return re;
+}
 
-    // W25Q32_WaitForReady();         // 等待擦除完成
+/* 获取运行时器件参数 */
+const w25q32_geometry_t *W25Q32_GetGeometry(void)
+{
+    return &flashGeometry;
 }
 
-void W25Q32_Erase64k(uint32_t addr) 
+/* 扇区擦除 (4KB) */
+uint8_t W25Q32_EraseSector(uint32_t sectorAddr) 
 {    
-       uint8_t sts = 0;
-
-    W25Q32_WriteEnable();          // 使能写操作
-    W25Q32_CS(0);
-
-    Spi_SendData(W25Q32_CMD_64K_BLOCK_ERASE);
-    Spi_SendData((uint8_t)((addr >> 16) & 0xFF));
-    Spi_SendData((uint8_t)((addr >> 8) & 0xFF));
-    Spi_SendData((uint8_t)(addr & 0xFF));
-    UARTIF_uartPrintf(0, "Waiting for erase 64k .");
+    return eraseBlocking(W25Q32_OP_ERASE_4K, W25Q32_CMD_SECTOR_ERASE, sectorAddr);
+}
 
-    W25Q32_CS(1);
-    do 
-    {
-        sts = W25Q32_ReadStatusReg();
-        // UARTIF_uartPrintf(0, "Status Reg 1 is 0x%x ! \n", sts);
-        UARTIF_uartPrintf(0, ".");
-        delay1ms(200);
-    }
-    while(sts & 0x01);
-    UARTIF_uartPrintf(0, "\n");
+uint8_t W25Q32_Erase32k(uint32_t addr) 
+{    
+    return eraseBlocking(W25Q32_OP_ERASE_32K, W25Q32_CMD_32K_BLOCK_ERASE, addr);
+}
 
-    // W25Q32_WaitForReady();         // 等待擦除完成
+uint8_t W25Q32_Erase64k(uint32_t addr) 
+{    
+    return eraseBlocking(W25Q32_OP_ERASE_64K, W25Q32_CMD_64K_BLOCK_ERASE, addr);
 }
 
 /* 整片擦除 */
-void W25Q32_EraseChip(void) 
+uint8_t W25Q32_EraseChip(void) 
 {
-    uint8_t sts = 0;
-    W25Q32_WriteEnable();
-    W25Q32_CS(0);
-    Spi_SendData(W25Q32_CMD_CHIP_ERASE);
-    UARTIF_uartPrintf(0, "Waiting for erase chip .");
+    return eraseBlocking(W25Q32_OP_ERASE_CHIP, W25Q32_CMD_CHIP_ERASE, 0);
+}
 
-    W25Q32_CS(1);
-    do 
+/* 擦除粒度对应的耗时统计类型（非 4K/32K/64K 的粒度按不小于它的最近一类统计） */
+w25q32_op_t W25Q32_EraseOpForSize(uint32_t size)
+{
+    if (size <= W25Q32_SECTOR_SIZE)
     {
-        sts = W25Q32_ReadStatusReg();
-        // UARTIF_uartPrintf(0, "Status Reg 1 is 0x%x ! \n", sts);
-        UARTIF_uartPrintf(0, ".");
-        delay1ms(200);
+        return W25Q32_OP_ERASE_4K;
     }
-    while(sts & 0x01);
-    UARTIF_uartPrintf(0, "\n");
+    return (size <= 32768u) ? W25Q32_OP_ERASE_32K : W25Q32_OP_ERASE_64K;
+}
 
-    // W25Q32_WaitForReady();         // 等待时间较长（秒级）
+/* 按 SFDP 擦除类型擦除（addr 须按 type->size 对齐） */
+uint8_t W25Q32_EraseBlock(const w25q32_erase_type_t *type, uint32_t addr)
+{
+    if ((type == NULL) || (type->size == 0u) || (type->opcode == 0u) ||
+        (addr & (type->size - 1u)) || (addr >= flashGeometry.totalSize))
+    {
+        return W25Q32_ERROR;
+    }
+    return eraseBlocking(W25Q32_EraseOpForSize(type->size), type->opcode, addr);
 }
 
 /* 读取数据 (支持跨页连续读) */
 uint8_t W25Q32_ReadData(uint32_t addr, uint8_t *buf, uint32_t len) 
 {
-    uint32_t i = 0;    
+    uint8_t re = W25Q32_OK;
+    uint8_t resume;
     if (buf == NULL || len == 0 || addr >= FLASH_TOTAL_SIZE)
     {
         return W25Q32_ERROR;
     }
 
-    W25Q32_CS(0);
+    resume = readBegin();
+    sendCmdAddr(W25Q32_CMD_READ_DATA, addr);
+    if (Spi_ReceiveBuf(buf, len) != Ok)
+    {
+        re = W25Q32_ERROR;
+    }
+    W25Q32_CS(1);
+    readEnd(resume);
 
-    Spi_SendData(W25Q32_CMD_READ_DATA);
-    Spi_SendData((uint8_t)((addr >> 16) & 0xFF));
-    Spi_SendData((uint8_t)((addr >> 8) & 0xFF));
-    Spi_SendData((uint8_t)(addr & 0xFF));
+    return re;
+}
 
+/* 快速连续读 (0x0B)
+ * 只发送一次命令和地址，CS保持拉低，按chunkLen分块读入buf，每块读满后调用cb
+ * len 不必是chunkLen的整数倍，最后一块按剩余长度回调；cb返回非0时提前结束
+ */
+uint8_t W25Q32_FastReadBurst(uint32_t addr, uint32_t len, uint8_t *buf, uint16_t chunkLen,
+                             w25q32_chunk_cb_t cb, void *ctx)
+{
+    uint16_t n;
+    uint8_t stop = 0;
+    uint8_t re = W25Q32_OK;
+    uint8_t resume;
 
-    for (;i < len;i++)
+    if (buf == NULL || cb == NULL || len == 0 || chunkLen == 0 ||
+        addr >= FLASH_TOTAL_SIZE || len > (FLASH_TOTAL_SIZE - addr))
     {
-        *(buf + i) = Spi_ReceiveData();
+        return W25Q32_ERROR;
+    }
+
+    resume = readBegin();
+    sendCmdAddr(W25Q32_CMD_FAST_READ, addr);
+    Spi_SendData(0x00);    // dummy
+
+    while ((len > 0) && (stop == 0))
+    {
+        n = (len > chunkLen) ? chunkLen : (uint16_t)len;
+        if (Spi_ReceiveBuf(buf, n) != Ok)
+        {
+            re = W25Q32_ERROR;
+            break;
+        }
+        stop = cb(addr, buf, n, ctx);
+        addr += n;
+        len -= n;
     }
     W25Q32_CS(1);
+    readEnd(resume);
 
-    return W25Q32_OK;
+    return re;
 }
 
 /* 写入数据 (页编程，单次最大256字节) */
 uint8_t W25Q32_WritePage(uint32_t addr, uint8_t *buf, uint16_t len) 
 {
-    uint32_t i = 0;
+    uint8_t re = W25Q32_OK;
 
     if (buf == NULL || len == 0 || addr >= FLASH_TOTAL_SIZE)
     {
@@ -295,23 +646,286 @@ uint8_t W25Q32_WritePage(uint32_t addr, uint8_t *buf, uint16_t len)
      len = W25Q32_PAGE_SIZE;
     }
 
+    W25Q32_WaitAsync();
     W25Q32_WriteEnable();          // 必须使能写操作
-    W25Q32_CS(0);
-    Spi_SendData(W25Q32_CMD_PAGE_PROGRAM);
-    Spi_SendData((uint8_t)((addr >> 16) & 0xFF));
-    Spi_SendData((uint8_t)((addr >> 8) & 0xFF));
-    Spi_SendData((uint8_t)(addr & 0xFF));
-    for (;i < len;i++)
+    sendCmdAddr(W25Q32_CMD_PAGE_PROGRAM, addr);
+    if (Spi_SendBuf(buf, len) != Ok)
+    {
+        re = W25Q32_ERROR;
+    }
+    W25Q32_CS(1);
+    waitBusy(W25Q32_OP_PROGRAM);   // 等待写入完成
+
+    W25Q32_WriteDisable();
+    return re;
+}
+
+/* 启动异步擦除，不等待完成 */
+uint8_t W25Q32_StartErase(w25q32_op_t op, uint32_t addr, w25q32_done_cb_t cb, void *ctx)
+{
+    uint8_t cmd;
+
+    if (asyncOp != W25Q32_OP_NONE || addr >= FLASH_TOTAL_SIZE)
+    {
+        return W25Q32_ERROR;
+    }
+    switch (op)
+    {
+        case W25Q32_OP_ERASE_4K:   cmd = W25Q32_CMD_SECTOR_ERASE;     break;
+        case W25Q32_OP_ERASE_32K:  cmd = W25Q32_CMD_32K_BLOCK_ERASE;  break;
+        case W25Q32_OP_ERASE_64K:  cmd = W25Q32_CMD_64K_BLOCK_ERASE;  break;
+        case W25Q32_OP_ERASE_CHIP: cmd = W25Q32_CMD_CHIP_ERASE;       break;
+        default: return W25Q32_ERROR;
+    }
+
+    W25Q32_WaitForReady();
+    W25Q32_WriteEnable();
+    if (op == W25Q32_OP_ERASE_CHIP)
+    {
+        W25Q32_CS(0);
+        Spi_SendData(cmd);
+    }
+    else
+    {
+        sendCmdAddr(cmd, addr);
+    }
+    W25Q32_CS(1);
+
+    asyncOp = op;
+    asyncAddr = addr;
+    asyncCb = cb;
+    asyncCtx = ctx;
+    asyncSuspended = 0;
+    return W25Q32_OK;
+}
+
+/* 启动异步页编程，不等待完成（buf 在函数返回后即可复用） */
+uint8_t W25Q32_StartWritePage(uint32_t addr, uint8_t *buf, uint16_t len, w25q32_done_cb_t cb, void *ctx)
+{
+    if (asyncOp != W25Q32_OP_NONE || buf == NULL || len == 0 || addr >= FLASH_TOTAL_SIZE)
     {
-        Spi_SendData(*(buf + i));
+        return W25Q32_ERROR;
     }
+    if (len > W25Q32_PAGE_SIZE)
+    {
+        len = W25Q32_PAGE_SIZE;
+    }
+
+    W25Q32_WaitForReady();
+    W25Q32_WriteEnable();
+    sendCmdAddr(W25Q32_CMD_PAGE_PROGRAM, addr);
+    Spi_SendBuf(buf, len);
     W25Q32_CS(1);
-    W25Q32_WaitForReady();         // 等待写入完成
 
+    asyncOp = W25Q32_OP_PROGRAM;
+    asyncAddr = addr;
+    asyncCb = cb;
+    asyncCtx = ctx;
+    asyncSuspended = 0;
+    return W25Q32_OK;
+}
+
+/* 查询异步操作：返回1表示仍在进行（含挂起状态），完成时调用回调并返回0 */
+uint8_t W25Q32_Poll(void)
+{
+    w25q32_op_t op;
+    w25q32_done_cb_t cb;
+
+    if (asyncOp == W25Q32_OP_NONE)
+    {
+        return 0;
+    }
+    if (asyncSuspended || (W25Q32_ReadStatusReg() & W25Q32_SR1_BUSY))
+    {
+        return 1;
+    }
+
+    op = asyncOp;
+    cb = asyncCb;
+    asyncOp = W25Q32_OP_NONE;
+    asyncCb = NULL;
     W25Q32_WriteDisable();
+    if (cb != NULL)
+    {
+        cb(op, asyncAddr, asyncCtx);
+    }
+    return 0;
+}
+
+/* 是否有未完成的异步操作 */
+uint8_t W25Q32_IsBusy(void)
+{
+    return (asyncOp != W25Q32_OP_NONE) ? 1 : 0;
+}
+
+/* 挂起正在执行的异步擦除/编程，挂起后可以读取（被擦除/编程的区域除外）
+ * 整片擦除或挂起超时返回 W25Q32_ERROR，此时芯片仍忙 */
+uint8_t W25Q32_Suspend(void)
+{
+    uint8_t i;
+
+    if (asyncOp == W25Q32_OP_NONE || asyncOp == W25Q32_OP_ERASE_CHIP)
+    {
+        // 整片擦除不支持挂起
+        return W25Q32_ERROR;
+    }
+    if (asyncSuspended)
+    {
+        return W25Q32_OK;
+    }
+    if ((W25Q32_ReadStatusReg() & W25Q32_SR1_BUSY) == 0)
+    {
+        // 已经完成，无需挂起，由 W25Q32_Poll() 收尾
+        return W25Q32_OK;
+    }
+
+    W25Q32_CS(0);
+    Spi_SendData(W25Q32_CMD_ERASE_SUSPEND);
+    W25Q32_CS(1);
+
+    // tSUS 最大 20us
+    for (i = 0; i < 10; i++)
+    {
+        delay100us(1);
+        if ((W25Q32_ReadStatusReg() & W25Q32_SR1_BUSY) == 0)
+        {
+            break;
+        }
+    }
+    // SUS 位未置位说明挂起命令到达前操作已结束
+    asyncSuspended = (W25Q32_ReadStatusReg2() & W25Q32_SR2_SUS) ? 1 : 0;
+    if (!asyncSuspended && (W25Q32_ReadStatusReg() & W25Q32_SR1_BUSY))
+    {
+        // 超时仍在忙，挂起命令未生效
+        return W25Q32_ERROR;
+    }
+    return W25Q32_OK;
+}
+
+/* 恢复被挂起的异步擦除/编程 */
+void W25Q32_Resume(void)
+{
+    if (!asyncSuspended)
+    {
+        return;
+    }
+    W25Q32_CS(0);
+    Spi_SendData(W25Q32_CMD_ERASE_RESUME);
+    W25Q32_CS(1);
+    asyncSuspended = 0;
+    // 恢复后至少间隔 tSUS 才能再次挂起
+    delay100us(1);
+}
+
+/* 等待异步操作结束（挂起状态会先恢复） */
+void W25Q32_WaitAsync(void)
+{
+    W25Q32_Resume();
+    while (W25Q32_Poll())
+    {
+        delay100us(1);
+    }
+}
+
+/* 设置毫秒节拍源（periodMs 为节拍更新周期），传 NULL 关闭睡眠等待 */
+void W25Q32_SetTickSource(const volatile uint32_t *tickMs, uint16_t periodMs)
+{
+    tickSourceMs = tickMs;
+    tickPeriodMs = periodMs;
+}
+
+/* 获取操作耗时统计 */
+const w25q32_op_stats_t *W25Q32_GetOpStats(w25q32_op_t op)
+{
+    if (op == W25Q32_OP_NONE || op >= W25Q32_OP_COUNT)
+    {
+        return NULL;
+    }
+    return &opStats[op];
+}
+
+/* 获取操作的预计耗时（100us）：有测量值时为EWMA，否则为数据手册典型值 */
+uint32_t W25Q32_GetExpectedTime(w25q32_op_t op)
+{
+    if (op == W25Q32_OP_NONE || op >= W25Q32_OP_COUNT)
+    {
+        return 0;
+    }
+    return (opStats[op].count != 0) ? opStats[op].ewma : opTypicalUnits[op];
+}
+
+/* 清除耗时统计，重新从数据手册典型值开始学习 */
+void W25Q32_ResetOpStats(void)
+{
+    W25Q32_memset(opStats, 0, sizeof(opStats));
+}
+
+/* 打印耗时统计（仅在调试时调用） */
+void W25Q32_DumpOpStats(void)
+{
+    uint8_t op;
+#if W25Q32_OP_STATS_DETAIL
+    uint8_t i;
+#endif
+
+    for (op = W25Q32_OP_ERASE_4K; op < W25Q32_OP_COUNT; op++)
+    {
+        UARTIF_uartPrintf(0, "flash op %d: n=%u ewma=%lu (x100us)", op, opStats[op].count, opStats[op].ewma);
+#if W25Q32_OP_STATS_DETAIL
+        UARTIF_uartPrintf(0, " min=%lu max=%lu hist", opStats[op].min, opStats[op].max);
+        for (i = 0; i < W25Q32_HIST_BINS; i++)
+        {
+            UARTIF_uartPrintf(0, " %u", opStats[op].hist[i]);
+        }
+#endif
+        UARTIF_uartPrintf(0, "\n");
+    }
+}
+
+/* 进入深度掉电 (0xB9)，下次访问时自动唤醒；有后台擦除/编程或已关闭自动掉电时保持standby */
+uint8_t W25Q32_PowerDown(void)
+{
+    if (powerDown)
+    {
+        return W25Q32_OK;
+    }
+    if (!autoPowerDown || (asyncOp != W25Q32_OP_NONE))
+    {
+        powerStats.skippedCount++;
+        return W25Q32_ERROR;
+    }
+
+    W25Q32_CS(0);
+    Spi_SendData(W25Q32_CMD_POWER_DOWN);
+    W25Q32_CS(1);
+    // tDP 最大 3us 后进入掉电，之后只响应 0xAB
+    powerDown = 1;
+    powerStats.powerDownCount++;
+    if (tickSourceMs != NULL)
+    {
+        powerDownStartMs = *tickSourceMs;
+    }
     return W25Q32_OK;
 }
 
+/* 开关睡眠前自动深度掉电（关闭时立即唤醒） */
+void W25Q32_SetAutoPowerDown(uint8_t enable)
+{
+    autoPowerDown = enable ? 1 : 0;
+    if (!autoPowerDown && powerDown)
+    {
+        // 借用 CS 拉低路径完成唤醒
+        W25Q32_CS(0);
+        W25Q32_CS(1);
+    }
+}
+
+/* 获取深度掉电统计 */
+const w25q32_power_stats_t *W25Q32_GetPowerStats(void)
+{
+    return &powerStats;
+}
+
 uint8_t W25Q32_memset(void *s, int c, size_t n)
 {
     uint8_t *p = (uint8_t *)s;
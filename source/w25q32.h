@@ -14,6 +14,7 @@
 
 /* 指令集 (参考数据手册) */
 #define W25Q32_CMD_READ_DATA        0x03
+#define W25Q32_CMD_FAST_READ        0x0B  // 快速读，地址后需1个dummy字节
 #define W25Q32_CMD_PAGE_PROGRAM     0x02
 #define W25Q32_CMD_SECTOR_ERASE     0x20
 #define W25Q32_CMD_CHIP_ERASE       0xC7
@@ -27,6 +28,18 @@
 #define W25Q32_CMD_WRITE_DISABLE    0x04
 
 #define W25Q32_CMD_JEDEC_ID         0x9F
+#define W25Q32_CMD_READ_SFDP        0x5A  // 读SFDP表，地址后需1个dummy字节
+#define W25Q32_CMD_ENTER_4B_MODE    0xB7  // 进入4字节地址模式（>16MB器件）
+
+#define W25Q32_CMD_ERASE_SUSPEND    0x75  // 擦除/编程挂起
+#define W25Q32_CMD_ERASE_RESUME     0x7A  // 擦除/编程恢复
+#define W25Q32_CMD_POWER_DOWN       0xB9  // 深度掉电
+#define W25Q32_CMD_RELEASE_POWER_DOWN 0xAB  // 退出深度掉电
+
+/* 状态寄存器位 */
+#define W25Q32_SR1_BUSY             0x01  // SR1 bit0: 忙
+#define W25Q32_SR1_WEL              0x02  // SR1 bit1: 写使能已锁存
+#define W25Q32_SR2_SUS              0x80  // SR2 bit7: 擦除/编程已挂起
 
 /* 存储参数 */
 #define W25Q32_PAGE_SIZE         256     // 页大小 (字节)
@@ -34,6 +47,78 @@
 #define W25Q32_BLOCK_SIZE        65536   // 块大小 (字节)
 #define W25Q32_TOTAL_SIZE        4194304 // 总容量 (4MB)
 
+/* 连续读回调：每读满一个chunk调用一次
+ * addr 为本chunk在flash中的起始地址，buf/len 为本chunk数据
+ * 返回0继续读取，非0立即结束本次连续读
+ * 注意：回调执行期间CS保持拉低，回调内不得访问SPI总线（包括EPD）
+ */
+typedef uint8_t (*w25q32_chunk_cb_t)(uint32_t addr, uint8_t *buf, uint16_t len, void *ctx);
+
+#define W25Q32_MAX_ERASE_TYPES  4   // SFDP 最多描述4种擦除粒度
+
+/* 擦除粒度（来自SFDP，size 为0表示无效） */
+typedef struct
+{
+    uint32_t size;
+    uint8_t opcode;
+} w25q32_erase_type_t;
+
+/* 运行时器件参数，W25Q32_ProbeGeometry() 之前为 W25Q32 默认值 */
+typedef struct
+{
+    uint32_t jedecId;           // W25Q32_ReadID() 的返回值
+    uint32_t totalSize;         // 总容量（字节）
+    uint8_t addrBytes;          // 3 或 4 字节地址
+    uint8_t fromSfdp;           // 1: 参数来自SFDP，0: 来自JEDEC容量码或默认值
+    w25q32_erase_type_t erase[W25Q32_MAX_ERASE_TYPES];
+} w25q32_geometry_t;
+
+/* 异步操作类型 */
+typedef enum
+{
+    W25Q32_OP_NONE = 0,
+    W25Q32_OP_ERASE_4K,
+    W25Q32_OP_ERASE_32K,
+    W25Q32_OP_ERASE_64K,
+    W25Q32_OP_ERASE_CHIP,
+    W25Q32_OP_PROGRAM
+} w25q32_op_t;
+
+#define W25Q32_OP_COUNT     6   // w25q32_op_t 取值个数
+#define W25Q32_HIST_BINS    8   // 耗时直方图桶数，按 4 倍递增
+
+/* 1 = 额外统计最值与耗时直方图（调试用，每类操作多 40 字节 RAM），0 = 只保留擦除规划用的 EWMA */
+#ifndef W25Q32_OP_STATS_DETAIL
+#define W25Q32_OP_STATS_DETAIL  0
+#endif
+
+/* 单类操作耗时统计，时间单位 100us */
+typedef struct
+{
+    uint32_t ewma;                      // 学习到的典型耗时
+    uint16_t count;
+#if W25Q32_OP_STATS_DETAIL
+    uint32_t min;
+    uint32_t max;
+    uint16_t hist[W25Q32_HIST_BINS];    // [0]:<0.4ms [1]:<1.6ms ... [7]:>=1.6s
+#endif
+} w25q32_op_stats_t;
+
+/* 深度掉电统计
+ * powerDownMs 依赖节拍源，main 睡眠期间 TIM0 中断关闭，这段时间不计入
+ */
+typedef struct
+{
+    uint32_t powerDownCount;    // 进入深度掉电次数
+    uint32_t skippedCount;      // 因后台操作或已关闭而保持standby的次数
+    uint32_t wakeCount;         // 唤醒次数
+    uint32_t powerDownMs;       // 深度掉电累计时间（节拍计时）
+    uint32_t wakePenaltyUs;     // 唤醒等待 tRES1 的累计时间
+} w25q32_power_stats_t;
+
+/* 异步操作完成回调，在 W25Q32_Poll() 中调用 */
+typedef void (*w25q32_done_cb_t)(w25q32_op_t op, uint32_t addr, void *ctx);
+
 /* 函数声明 */
 void W25Q32_Init(void);
 void W25Q32_CS(uint8_t state);  // 片选控制
@@ -43,11 +128,41 @@ uint8_t W25Q32_ReadStatusReg3(void);
 void W25Q32_WriteEnable(void);
 void W25Q32_WaitForReady(void);
 uint32_t W25Q32_ReadID(void);
-void W25Q32_EraseSector(uint32_t sectorAddr);
-void W25Q32_EraseChip(void);
+uint8_t W25Q32_ProbeGeometry(void);       // SPI 初始化后调用，读取JEDEC ID和SFDP
+const w25q32_geometry_t *W25Q32_GetGeometry(void);
+uint8_t W25Q32_EraseSector(uint32_t sectorAddr);
+uint8_t W25Q32_EraseChip(void);
 uint8_t W25Q32_ReadData(uint32_t addr, uint8_t *buf, uint32_t len);
+uint8_t W25Q32_FastReadBurst(uint32_t addr, uint32_t len, uint8_t *buf, uint16_t chunkLen,
+                             w25q32_chunk_cb_t cb, void *ctx);
 uint8_t W25Q32_WritePage(uint32_t addr, uint8_t *buf, uint16_t len);
-void W25Q32_Erase32k(uint32_t addr);
-void W25Q32_Erase64k(uint32_t addr);
+uint8_t W25Q32_Erase32k(uint32_t addr);
+uint8_t W25Q32_Erase64k(uint32_t addr);
+uint8_t W25Q32_EraseBlock(const w25q32_erase_type_t *type, uint32_t addr);  // 按 W25Q32_GetGeometry()->erase[] 擦除
+w25q32_op_t W25Q32_EraseOpForSize(uint32_t size);
 uint8_t W25Q32_memset(void *s, int c, size_t n);
+
+/* 异步擦除/编程：启动后立即返回，由 W25Q32_Poll() 查询完成并调用回调
+ * 同一时刻只允许一个异步操作；异步操作进行中调用读函数会自动挂起并在读完后恢复，
+ * 调用同步擦除/编程函数会先等待异步操作完成
+ */
+uint8_t W25Q32_StartErase(w25q32_op_t op, uint32_t addr, w25q32_done_cb_t cb, void *ctx);
+uint8_t W25Q32_StartWritePage(uint32_t addr, uint8_t *buf, uint16_t len, w25q32_done_cb_t cb, void *ctx);
+uint8_t W25Q32_Poll(void);
+uint8_t W25Q32_IsBusy(void);
+uint8_t W25Q32_Suspend(void);
+void W25Q32_Resume(void);
+void W25Q32_WaitAsync(void);
+
+/* 忙等待校准：擦除/编程按历史耗时等待，有节拍源时睡眠等待 */
+void W25Q32_SetTickSource(const volatile uint32_t *tickMs, uint16_t periodMs);
+const w25q32_op_stats_t *W25Q32_GetOpStats(w25q32_op_t op);
+void W25Q32_ResetOpStats(void);
+void W25Q32_DumpOpStats(void);
+uint32_t W25Q32_GetExpectedTime(w25q32_op_t op);   // 预计耗时（100us），供擦除规划使用
+
+/* 深度掉电：MCU 睡眠前调用，任意访问时自动唤醒 */
+uint8_t W25Q32_PowerDown(void);
+void W25Q32_SetAutoPowerDown(uint8_t enable);
+const w25q32_power_stats_t *W25Q32_GetPowerStats(void);
 #endif
@@ -0,0 +1,278 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+0xABCD 链路（LPUART / E104）上传一层图像：逐页连发、逐页应答、批量帧与 credit 流控的仿真
+
+用法:
+    python tools/credit_sim.py                                     # 默认：19200/115200 baud x 4/8/24 MHz
+    python tools/credit_sim.py --baud 115200 --mhz 4 24 --erase 400 --latency 30
+    python tools/credit_sim.py --loss 0.02 --resync 0                # 线路丢帧且主机不重新同步：credit 耗尽后停住
+
+设备模型与 source/uart_interface.c 一致：帧头收齐时申请帧槽（--slots 个，与 V2 共用），没有空闲槽则整帧跳过（溢出）；
+主循环按顺序每次处理一帧，处理完才归还帧槽。每页处理时间 = --cycles / MHz（解码 + CRC + SPI）+ --program（页编程），
+每写 --erase-every 页再加一次 --erase 的扇区擦除（擦除期间主循环阻塞）。
+接收中断每字节占 --isr-cycles 个周期，主循环只能用剩下的 CPU，低主频高波特率时处理明显变慢。
+
+主机策略：
+    stream  逐页连发，不等应答（现有做法）：设备跟不上时整页丢失，主机无从得知
+    ack     每页一个批量帧（K=1），等应答再发下一页
+    batch   一帧 K=--slots 页，每批一个应答
+    credit  先发 "CREDIT"，之后逐页连发，但累计发送的帧数不超过设备应答里的 credit 上限；
+            设备每处理完一帧回一个 9 字节的 credit 通告（上行，与下行并行）。
+            线路上丢的帧（MAGIC/LEN 损坏，--loss）设备收不到也无法计数，上限不再增长：
+            主机发完上限、--resync ms 内没有新通告时重发 "CREDIT"，设备按处理到 "CREDIT" 为止的帧重新计数
+输出：传输时间（到最后一页处理完）、写入页数、有效吞吐（每秒写入的图层字节）、溢出（跳过的页）、
+线路丢帧、credit 重新同步次数和上行字节数。丢失的页不在仿真中补发（实际由应答中的下一页/续传位图补发）。
+"""
+import argparse
+import heapq
+import random
+
+from img_codec import PAGE_SIZE, build_batch, build_frame, encode_layer, sample_text
+
+FRAME_OVERHEAD = 7
+HEADER_LEN = 5
+RESP_LEN = 7 + 1                # 应答帧（不含状态后的字段）+ credit 字节
+CREDIT_RESP = RESP_LEN + 1      # 状态 0x0A | credit
+BATCH_RESP = RESP_LEN + 3       # 状态 0x08 | 写入页数 | 下一页
+LIMIT_MS = 600000.0
+
+
+class Sim(object):
+    def __init__(self):
+        self.now = 0.0
+        self.q = []
+        self.seq = 0
+
+    def at(self, t, fn, *args):
+        self.seq += 1
+        heapq.heappush(self.q, (t, self.seq, fn, args))
+
+    def run(self):
+        while self.q:
+            t, _, fn, args = heapq.heappop(self.q)
+            if t > LIMIT_MS:
+                break
+            self.now = t
+            fn(*args)
+
+
+class Link(object):
+    """单向串行链路（8N1）+ 固定延迟；deliver 在帧头和帧尾到达时各调用一次"""
+
+    def __init__(self, sim, baud, latency):
+        self.sim = sim
+        self.byte_ms = 10000.0 / baud
+        self.latency = latency
+        self.free_at = 0.0
+        self.sent = 0
+
+    def send(self, nbytes, on_header, on_end, *args):
+        start = max(self.sim.now, self.free_at)
+        self.free_at = start + nbytes * self.byte_ms
+        self.sent += nbytes
+        if on_header is not None:
+            self.sim.at(start + HEADER_LEN * self.byte_ms + self.latency, on_header, *args)
+        if on_end is not None:
+            self.sim.at(self.free_at + self.latency, on_end, *args)
+        return self.free_at
+
+
+class Device(object):
+    def __init__(self, sim, up, args, mhz, baud):
+        self.sim = sim
+        self.up = up
+        self.slots = args.slots
+        self.held = 0               # 已申请的帧槽（正在接收 + 等待处理 + 正在处理）
+        self.ready = []
+        self.busy = False
+        self.written = 0
+        self.skipped = 0
+        self.done = 0               # 处理完的单帧
+        self.base = 0               # 处理 "CREDIT" 时的 done + skipped
+        self.credit_mode = False
+        self.host = None
+        self.last_done = 0.0
+        isr_load = min(0.9, (baud / 10000.0) * args.isr_cycles / (mhz * 1000.0))
+        self.slow = 1.0 / (1.0 - isr_load)
+        self.page_ms = args.cycles / (mhz * 1000.0) + args.program
+        self.erase_ms = args.erase
+        self.erase_every = args.erase_every
+
+    def limit(self):
+        return self.done + self.skipped - self.base + self.slots
+
+    # 帧头收齐：申请帧槽（批量帧按页数申请）
+    def on_header(self, frame):
+        need = max(1, len(frame["pages"]))      # 文本帧也占一个帧槽
+        if self.held + need > self.slots:
+            frame["dropped"] = True
+            return
+        self.held += need
+
+    def on_end(self, frame):
+        if frame.get("dropped"):
+            if frame["kind"] == "batch":
+                self.ready.append(dict(frame, pages=[]))    # 空槽：回 0 页应答
+                self.held += 1
+            else:
+                self.skipped += 1
+            self.kick()
+            return
+        self.ready.append(frame)
+        self.kick()
+
+    def kick(self):
+        if self.busy or not self.ready:
+            return
+        self.busy = True
+        frame = self.ready.pop(0)
+        t = 0.0
+        for _ in frame["pages"]:
+            t += self.page_ms
+            self.written += 1
+            if self.written % self.erase_every == 0:
+                t += self.erase_ms
+        self.sim.at(self.sim.now + t * self.slow, self.processed, frame)
+
+    def processed(self, frame):
+        self.busy = False
+        self.held -= max(1, len(frame["pages"]))
+        self.last_done = self.sim.now
+        if frame["kind"] == "batch":
+            self.up.send(BATCH_RESP, None, self.host.on_ack, len(frame["pages"]))
+        else:
+            if frame["kind"] == "credit-cmd":
+                self.credit_mode = True
+                self.base = self.done + self.skipped    # 本帧算第 1 帧
+            self.done += 1
+            if self.credit_mode:
+                self.up.send(CREDIT_RESP, None, self.host.on_credit, self.limit())
+        self.kick()
+
+
+class Host(object):
+    def __init__(self, sim, down, dev, mode, pages, k, args):
+        self.sim = sim
+        self.down = down
+        self.dev = dev
+        self.mode = mode
+        self.pages = pages
+        self.k = k
+        self.next = 0
+        self.sent = 0
+        self.limit = 0
+        self.inflight = 0
+        self.loss = args.loss
+        self.rng = random.Random(args.seed)
+        self.lost = 0
+        self.resync_ms = args.resync
+        self.resyncs = 0
+        self.stamp = 0              # 每收到一个 credit 通告加 1，超时检查据此判断有没有进展
+
+    def send(self, kind, pages, nbytes):
+        frame = {"kind": kind, "pages": pages}
+        if self.loss > 0 and self.rng.random() < self.loss:
+            self.down.send(nbytes, None, None)      # 帧头损坏：设备不知道有这一帧
+            self.lost += 1
+        else:
+            self.down.send(nbytes, self.dev.on_header, self.dev.on_end, frame)
+        self.sent += 1
+
+    def start(self):
+        if self.mode == "stream":
+            for i, (flags, payload) in enumerate(self.pages):
+                self.send("page", [i], len(build_frame(flags, payload)))
+        elif self.mode == "credit":
+            self.send_credit_cmd()
+        else:
+            self.send_batch()
+
+    # "CREDIT"：主机从这一帧重新计数（本帧算第 1 帧），等设备回新的上限
+    def send_credit_cmd(self):
+        self.sent = 0
+        self.limit = 0
+        self.send("credit-cmd", [], FRAME_OVERHEAD + len("CREDIT"))
+        self.arm()
+
+    def arm(self):
+        self.stamp += 1
+        if self.resync_ms > 0:
+            self.sim.at(self.sim.now + self.resync_ms, self.check, self.stamp)
+
+    # 超时仍没有新通告且已用完上限：有帧在线路上丢了（或 "CREDIT" 本身丢了），重新同步
+    def check(self, stamp):
+        if stamp != self.stamp or self.next >= len(self.pages) or self.sent < self.limit:
+            return
+        self.resyncs += 1
+        self.send_credit_cmd()
+
+    def send_batch(self):
+        if self.next >= len(self.pages):
+            return
+        group = self.pages[self.next:self.next + self.k]
+        self.inflight = len(group)
+        self.send("batch", list(range(self.next, self.next + len(group))), len(build_batch(group)))
+
+    def on_ack(self, written):
+        if written == self.inflight:
+            self.next += written
+        self.send_batch()
+
+    def on_credit(self, limit):
+        self.limit = max(self.limit, limit)
+        self.arm()
+        while self.next < len(self.pages) and self.sent < self.limit:
+            flags, payload = self.pages[self.next]
+            self.send("page", [self.next], len(build_frame(flags, payload)))
+            self.next += 1
+
+
+def run(args, baud, mhz, mode, pages):
+    sim = Sim()
+    down = Link(sim, baud, args.latency)
+    up = Link(sim, baud, args.latency)
+    dev = Device(sim, up, args, mhz, baud)
+    host = Host(sim, down, dev, mode, pages, args.slots if mode == "batch" else 1, args)
+    dev.host = host
+    host.start()
+    sim.run()
+    return dev.last_done, dev.written, dev.skipped, host.lost, host.resyncs, up.sent
+
+
+def main():
+    ap = argparse.ArgumentParser(description="0xABCD link flow control simulation")
+    ap.add_argument("--baud", type=int, nargs="+", default=[19200, 115200])
+    ap.add_argument("--mhz", type=float, nargs="+", default=[4.0, 8.0, 24.0], help="MCU 主频")
+    ap.add_argument("--slots", type=int, default=3, help="设备帧池槽数（source/frame_pool.h）")
+    ap.add_argument("--cycles", type=float, default=40000.0, help="每页解码 + CRC + SPI 写入的 CPU 周期")
+    ap.add_argument("--program", type=float, default=0.8, help="W25Q32 页编程 ms")
+    ap.add_argument("--erase", type=float, default=60.0, help="扇区擦除 ms（典型 45，最大 400）")
+    ap.add_argument("--erase-every", type=int, default=16, help="每写多少页擦除一个扇区")
+    ap.add_argument("--isr-cycles", type=float, default=150.0, help="接收中断每字节周期数")
+    ap.add_argument("--latency", type=float, default=15.0, help="单向延迟 ms（E104 约半个连接间隔）")
+    ap.add_argument("--loss", type=float, default=0.0, help="下行帧在线路上损坏、设备收不到的概率")
+    ap.add_argument("--resync", type=float, default=1000.0,
+                    help="credit 用完后多久没有新通告就重发 CREDIT（ms，应大于最长擦除 + 往返），0 不重发")
+    ap.add_argument("--seed", type=int, default=1, help="丢帧随机数种子")
+    args = ap.parse_args()
+
+    pages = encode_layer(sample_text())
+    layer = len(pages) * PAGE_SIZE
+    print("pages=%d slots=%d cycles=%d program=%.1fms erase=%.0fms/%d pages latency=%.1fms loss=%.3f resync=%.0fms" % (
+        len(pages), args.slots, args.cycles, args.program, args.erase, args.erase_every, args.latency,
+        args.loss, args.resync))
+    print("%7s %5s %-7s %8s %7s %9s %9s %5s %6s %8s" % (
+        "baud", "MHz", "mode", "time(s)", "pages", "B/s", "overflow", "lost", "resync", "up(B)"))
+    for baud in args.baud:
+        for mhz in args.mhz:
+            for mode in ("stream", "ack", "batch", "credit"):
+                t, written, skipped, lost, resyncs, up = run(args, baud, mhz, mode, pages)
+                print("%7d %5.0f %-7s %8.2f %3d/%-3d %9.0f %9d %5d %6d %8d" % (
+                    baud, mhz, mode, t / 1000.0, written, len(pages), written * PAGE_SIZE / max(t / 1000.0, 1e-6),
+                    skipped, lost, resyncs, up))
+    return 0
+
+
+if __name__ == "__main__":
+    main()
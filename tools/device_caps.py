@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+查询设备能力（HELLO/CAPS）并据此选择传输参数
+
+用法:
+    python tools/device_caps.py -p COM5 --link v2              # UART1：发 [0x55,0x0C,CHK,0xAA]，收 RESP_CAPS
+    python tools/device_caps.py -p COM7 --link ble -b 19200    # LPUART/E104：发 0xABCD 文本帧 "HELLO"，收状态 0x09
+    python tools/device_caps.py --hex "01 06 03 03 03 03 7f 08 90 01 2c 01 02 a0 00 f8"  # 离线解析 16 字节
+
+CAPS 为 16 字节小端（source/uart_interface.h）：
+    [0] 协议版本  [1] 链路位图  [2..3] 0xABCD 帧最大 PAYLOAD  [4] V2 最大窗口  [5] 批量帧最大页数
+    [6] 功能位图  [7] 槽位数  [8..9] 宽  [10..11] 高  [12] 图层数  [13..14] 空闲 flash 页  [15] 每页字节数
+不回应 HELLO 的旧固件按最保守的参数处理：V2 停等、0xABCD 逐页、不压缩。
+"""
+import argparse
+import struct
+import sys
+
+from img_codec import build_frame, crc16_ccitt
+
+CAPS_LEN = 16
+
+LINKS = {0x01: "v1", 0x02: "v2", 0x04: "abcd"}
+FEATURES = {0x01: "rle", 0x02: "row-delta", 0x04: "batch", 0x08: "resume", 0x10: "delta", 0x20: "sack",
+            0x40: "credit"}
+
+V2_HELLO = bytes([0x55, 0x0C, (0x55 + 0x0C) & 0xFF, 0xAA])
+V2_RESP_CAPS = 0x2C
+LP_STATUS_CAPS = 0x09
+LP_RESP_FLAGS = 0x80
+LP_FLAG_CREDIT = 0x40      # 应答 PAYLOAD 末尾附 credit 上限
+
+# 不回应 HELLO 的固件：只假设最初的能力
+LEGACY = {"version": 0, "links": ["v2", "abcd"], "max_payload": 260, "window": 1, "batch": 1,
+          "features": [], "slots": 8, "width": 400, "height": 300, "layers": 2,
+          "free_pages": None, "page_size": 248}
+
+
+def parse_caps(data):
+    if len(data) < CAPS_LEN:
+        raise ValueError("CAPS 需要 %d 字节，收到 %d" % (CAPS_LEN, len(data)))
+    (ver, links, max_payload, window, batch, feat, slots,
+     width, height, layers, free_pages, page_size) = struct.unpack_from("<BBHBBBBHHBHB", data)
+    return {
+        "version": ver,
+        "links": [n for b, n in sorted(LINKS.items()) if links & b],
+        "max_payload": max_payload,
+        "window": window,
+        "batch": batch,
+        "features": [n for b, n in sorted(FEATURES.items()) if feat & b],
+        "slots": slots,
+        "width": width,
+        "height": height,
+        "layers": layers,
+        "free_pages": free_pages,
+        "page_size": page_size,
+    }
+
+
+def plan(caps, link):
+    """按能力选择参数：窗口、批量页数、页编码与是否增量更新"""
+    feat = set(caps["features"])
+    layer_bytes = caps["width"] * caps["height"] // 8
+    pages = -(-layer_bytes // caps["page_size"])
+    p = {"link": link}
+    if link == "v2":
+        # 窗口受帧槽数量限制；没有 SACK 只能停等
+        p["window"] = caps["window"] if "sack" in feat else 1
+        p["mode"] = "CMD_START_WINDOW" if p["window"] > 1 else "CMD_START"
+    else:
+        p["batch"] = caps["batch"] if "batch" in feat else 1
+        # credit：单页连发，在途页数不超过设备通告的上限（tools/credit_sim.py）；否则按批等应答
+        p["flow"] = "credit" if "credit" in feat else ("batch-ack" if p["batch"] > 1 else "page-ack")
+        p["codec"] = "row-delta+rle" if "row-delta" in feat else ("rle" if "rle" in feat else "raw")
+        p["encode_args"] = {"use_delta": "row-delta" in feat, "use_rle": "rle" in feat}
+    p["resume"] = "resume" in feat
+    # 整图需要 每层页数 + 头页；空闲页不够时设备要先 GC，增量更新只写改动页
+    need = caps["layers"] * pages + 1
+    p["pages_per_layer"] = pages
+    p["delta"] = "delta" in feat
+    if caps["free_pages"] is not None and caps["free_pages"] < need:
+        p["note"] = "空闲页 %d < 整图 %d 页：优先增量更新，否则设备写入前会先整理 flash" % (caps["free_pages"], need)
+    return p
+
+
+def _read_until(ser, pred, limit=256):
+    buf = bytearray()
+    while len(buf) < limit:
+        b = ser.read(1)
+        if not b:
+            return None
+        buf += b
+        r = pred(buf)
+        if r is not None:
+            return r
+    return None
+
+
+def _v2_caps(buf):
+    # [0x55, 0x2C, CAPS(16), CHK, 0xAA]
+    i = buf.find(bytes([0x55, V2_RESP_CAPS]))
+    if i < 0 or len(buf) < i + CAPS_LEN + 4:
+        return None
+    frame = buf[i:i + CAPS_LEN + 4]
+    if frame[-1] != 0xAA or (sum(frame[:-2]) & 0xFF) != frame[-2]:
+        return None
+    return bytes(frame[2:2 + CAPS_LEN])
+
+
+def _lp_caps(buf):
+    # 0xABCD | 0x80(|0x40) | LEN | 0x09 CAPS(16) [credit] | CRC
+    i = buf.find(b"\xAB\xCD")
+    if i < 0 or len(buf) < i + 5 or not buf[i + 2] & LP_RESP_FLAGS:
+        return None
+    credit = 1 if buf[i + 2] & LP_FLAG_CREDIT else 0
+    n = struct.unpack_from(">H", buf, i + 3)[0]
+    if len(buf) < i + 5 + n + 2:
+        return None
+    payload = bytes(buf[i + 5:i + 5 + n])
+    if struct.unpack_from(">H", buf, i + 5 + n)[0] != crc16_ccitt(payload):
+        return None
+    if n != 1 + CAPS_LEN + credit or payload[0] != LP_STATUS_CAPS:
+        return None
+    return payload[1:1 + CAPS_LEN]
+
+
+def query(port, baud, link, timeout):
+    import serial
+    ser = serial.Serial(port, baud, timeout=timeout)
+    try:
+        ser.reset_input_buffer()
+        if link == "v2":
+            ser.write(V2_HELLO)
+            return _read_until(ser, _v2_caps)
+        ser.write(build_frame(0, b"HELLO"))
+        return _read_until(ser, _lp_caps)
+    finally:
+        ser.close()
+
+
+def main():
+    ap = argparse.ArgumentParser(description="query device capabilities")
+    ap.add_argument("-p", "--port", help="串口名，如 COM5 或 /dev/ttyUSB0")
+    ap.add_argument("-b", "--baud", type=int, default=115200)
+    ap.add_argument("--link", choices=("v2", "ble"), default="v2", help="v2 = UART1，ble = LPUART/E104")
+    ap.add_argument("--timeout", type=float, default=1.0)
+    ap.add_argument("--hex", help="直接解析 16 字节 CAPS（十六进制）")
+    opts = ap.parse_args()
+
+    if opts.hex:
+        raw = bytes.fromhex(opts.hex)
+    elif opts.port:
+        raw = query(opts.port, opts.baud, opts.link, opts.timeout)
+    else:
+        ap.error("需要 -p 串口或 --hex")
+    if raw is None:
+        print("设备未回应 HELLO，按旧固件参数传输")
+        caps = LEGACY
+    else:
+        caps = parse_caps(raw)
+    for k in ("version", "links", "max_payload", "window", "batch", "features", "slots",
+              "width", "height", "layers", "free_pages", "page_size"):
+        print("%-12s %s" % (k, caps[k]))
+    print("")
+    for k, v in sorted(plan(caps, opts.link).items()):
+        print("%-16s %s" % (k, v))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+生成 source/crc32_tables.h（CRC32 查表法所需的常量表）
+
+用法:
+    python tools/gen_crc_tables.py            # 写入 source/crc32_tables.h
+    python tools/gen_crc_tables.py --check    # 仅检查已提交的文件是否为最新
+
+多项式与 flash_config.h 中的 CRC32_POLYNOMIAL 保持一致（反射形式 0xEDB88320）。
+修改多项式后重新运行本脚本并提交生成的头文件。
+"""
+import os
+import sys
+
+POLY = 0xEDB88320
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+OUT = os.path.join(HERE, "..", "source", "crc32_tables.h")
+
+
+def crc_bits(crc, nbits):
+    for _ in range(nbits):
+        crc = (crc >> 1) ^ POLY if crc & 1 else crc >> 1
+    return crc
+
+
+def nibble_table():
+    return [crc_bits(i, 4) for i in range(16)]
+
+
+def byte_tables(count):
+    t0 = [crc_bits(i, 8) for i in range(256)]
+    tables = [t0]
+    for k in range(1, count):
+        prev = tables[k - 1]
+        tables.append([(prev[i] >> 8) ^ t0[prev[i] & 0xFF] for i in range(256)])
+    return tables
+
+
+def fmt_table(name, values, per_line=4):
+    lines = ["static const uint32_t %s[%d] = {" % (name, len(values))]
+    for i in range(0, len(values), per_line):
+        chunk = ", ".join("0x%08XU" % v for v in values[i:i + per_line])
+        lines.append("    %s," % chunk)
+    lines[-1] = lines[-1].rstrip(",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def render():
+    slices = byte_tables(4)
+    parts = [
+        "/* 本文件由 tools/gen_crc_tables.py 生成，请勿手工修改 */",
+        "#ifndef CRC32_TABLES_H",
+        "#define CRC32_TABLES_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define CRC32_TABLES_POLYNOMIAL 0x%08XU" % POLY,
+        "",
+        "#if (CRC32_IMPL == CRC32_IMPL_NIBBLE)",
+        "// 半字节表：64 字节",
+        fmt_table("crc32_table_nibble", nibble_table()),
+        "#endif",
+        "",
+        "#if (CRC32_IMPL == CRC32_IMPL_BYTE) || (CRC32_IMPL == CRC32_IMPL_SLICE4)",
+        "// 字节表：1 KB",
+        fmt_table("crc32_table_byte0", slices[0]),
+        "#endif",
+        "",
+        "#if (CRC32_IMPL == CRC32_IMPL_SLICE4)",
+        "// slice-by-4 附加表：3 KB",
+        fmt_table("crc32_table_byte1", slices[1]),
+        "",
+        fmt_table("crc32_table_byte2", slices[2]),
+        "",
+        fmt_table("crc32_table_byte3", slices[3]),
+        "#endif",
+        "",
+        "#endif // CRC32_TABLES_H",
+        "",
+    ]
+    return "\n".join(parts)
+
+
+def main():
+    text = render()
+    if "--check" in sys.argv:
+        with open(OUT, "r", encoding="utf-8") as f:
+            if f.read() != text:
+                print("crc32_tables.h is out of date, run tools/gen_crc_tables.py")
+                return 1
+        return 0
+    with open(OUT, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
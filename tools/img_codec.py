@@ -0,0 +1,425 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+图像图层编码器（0xABCD 帧，LPUART / E104 蓝牙透传）
+
+用法:
+    python tools/img_codec.py encode layer.bin -o frames.bin [--red]   # 15000 字节 1bpp 图层 -> 帧流
+    python tools/img_codec.py bench [文件 ...] [--baud 19200]          # 压缩率与传输时间对比
+    python tools/img_codec.py delta [--baud 19200]                     # 工牌改名：整图上传与增量更新对比
+    python tools/img_codec.py batch [文件 ...] [--baud 19200] [--rtt 60] # 批量帧（一帧 K 页、一个应答）吞吐对比
+
+图层按 248 字节一页切分，每页独立选择最短的编码（FLAGS）：
+    0x00  原始数据
+    0x01  RLE（PackBits，与 source/rle.c 一致）
+    0x05  行差分 + RLE：每字节先与上一行（50 字节之前）异或，再 RLE
+红色图层在 FLAGS 上再置 0x02。行差分在整层上计算，设备按页顺序还原，
+因此页必须按顺序发送（与现有协议一致）。
+
+批量帧 FLAGS 置 0x08，PAYLOAD 为 K 个 [页FLAGS | 页长度(1B) | 页数据]，整帧一个 CRC，
+设备处理完回一个应答（状态 0x08 | 写入页数 | 下一页）。K 由 "BATCH:<K>" 协商，不超过设备帧槽数（3）。
+batch 按 E104 往返延迟 rtt 与每页处理时间估算：逐页等应答、批量等应答，以及现有的逐页不等应答（无法发现丢帧）。
+
+delta 用合成的红黑工牌（红色抬头 + 大号姓名 + 职位 + 黑框），只改姓名，
+按每页 CRC32（与设备页头一致）找出改动的页，统计 LPUART 与 V2 两种链路的字节数和 flash 编程页数。
+增量更新中紧跟在跳过页之后的第一页不能用行差分（设备没有上一页的最后一行）。
+
+bench 的输入可以是 15000 字节的 .bin 图层，或任意图片（需要 Pillow，缩放到 400x300 后抖动为 1bpp）。
+不给文件时使用内置的合成样本（文字、抖动渐变、线框、空白）。
+传输时间按 8N1（每字节 10 bit）计算，只含线路时间。
+"""
+import argparse
+import os
+import random
+import struct
+import sys
+import zlib
+
+WIDTH = 400
+HEIGHT = 300
+ROW_BYTES = WIDTH // 8
+LAYER_BYTES = ROW_BYTES * HEIGHT
+PAGE_SIZE = 248
+PAGE_COUNT = 61
+FRAME_MAX_PAYLOAD = 260         # 设备帧槽大小（source/frame_pool.h）
+
+FLAG_COMPRESSED = 0x01
+FLAG_RED = 0x02
+FLAG_ROW_DELTA = 0x04
+FLAG_BATCH = 0x08
+BATCH_ACK_LEN = 7 + 3 + 1       # 应答帧：状态 | 写入页数 | 下一页 | credit 上限
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def rle_encode(data):
+    out = bytearray()
+    i = 0
+    n = len(data)
+    lit_start = 0
+    while i < n:
+        run = 1
+        while i + run < n and run < 128 and data[i + run] == data[i]:
+            run += 1
+        if run >= 3 or (run == 2 and lit_start == i):
+            while lit_start < i:
+                chunk = data[lit_start:min(i, lit_start + 127)]
+                out.append(len(chunk))
+                out += chunk
+                lit_start += len(chunk)
+            out.append(257 - run)
+            out.append(data[i])
+            i += run
+            lit_start = i
+        else:
+            i += run
+    while lit_start < n:
+        chunk = data[lit_start:min(n, lit_start + 127)]
+        out.append(len(chunk))
+        out += chunk
+        lit_start += len(chunk)
+    return bytes(out)
+
+
+def rle_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        c = data[i]
+        i += 1
+        if c >= 128:
+            out += bytes([data[i]]) * (257 - c)
+            i += 1
+        else:
+            out += data[i:i + c]
+            i += c
+    return bytes(out)
+
+
+def row_delta(layer):
+    out = bytearray(layer)
+    for k in range(len(layer) - 1, ROW_BYTES - 1, -1):
+        out[k] ^= layer[k - ROW_BYTES]
+    return bytes(out)
+
+
+def pad_layer(layer):
+    return bytes(layer) + b"\xff" * (PAGE_SIZE * PAGE_COUNT - len(layer))
+
+
+def encode_layer(layer, use_delta=True, use_rle=True):
+    """返回 [(flags, payload), ...]，每页一项"""
+    layer = pad_layer(layer)
+    delta = row_delta(layer)
+    pages = []
+    for p in range(PAGE_COUNT):
+        raw = layer[p * PAGE_SIZE:(p + 1) * PAGE_SIZE]
+        best = (0, raw)
+        if use_rle:
+            cand = rle_encode(raw)
+            if len(cand) < len(best[1]):
+                best = (FLAG_COMPRESSED, cand)
+        if use_delta:
+            cand = rle_encode(delta[p * PAGE_SIZE:(p + 1) * PAGE_SIZE])
+            if len(cand) < len(best[1]):
+                best = (FLAG_COMPRESSED | FLAG_ROW_DELTA, cand)
+        assert len(best[1]) <= FRAME_MAX_PAYLOAD
+        pages.append(best)
+    return pages
+
+
+def decode_layer(pages):
+    """与设备端一致的解码，用于自检"""
+    out = bytearray()
+    prev = bytes(ROW_BYTES)
+    for flags, payload in pages:
+        page = bytearray(rle_decode(payload) if flags & FLAG_COMPRESSED else payload)
+        assert len(page) == PAGE_SIZE
+        if flags & FLAG_COMPRESSED and flags & FLAG_ROW_DELTA:
+            for i in range(PAGE_SIZE):
+                page[i] ^= prev[i] if i < ROW_BYTES else page[i - ROW_BYTES]
+        prev = bytes(page[-ROW_BYTES:])
+        out += page
+    return bytes(out)
+
+
+def build_frame(flags, payload):
+    crc = crc16_ccitt(payload)
+    return b"\xAB\xCD" + struct.pack(">BH", flags, len(payload)) + payload + struct.pack(">H", crc)
+
+
+def wire_bytes(pages):
+    return sum(len(build_frame(f, p)) for f, p in pages)
+
+
+def build_batch(pages, red=0):
+    payload = b"".join(bytes([f | red, len(p)]) + p for f, p in pages)
+    return build_frame(FLAG_BATCH, payload)
+
+
+# ---------------------------------------------------------------- 样本
+def _canvas():
+    return [[0] * WIDTH for _ in range(HEIGHT)]
+
+
+def _pack(px):
+    """px[y][x] = 1 为黑，按设备约定 bit=0 为黑、高位在左"""
+    out = bytearray()
+    for y in range(HEIGHT):
+        for xb in range(ROW_BYTES):
+            v = 0xFF
+            for bit in range(8):
+                if px[y][xb * 8 + bit]:
+                    v &= ~(0x80 >> bit)
+            out.append(v & 0xFF)
+    return bytes(out)
+
+
+def sample_text(seed=1):
+    rnd = random.Random(seed)
+    px = _canvas()
+    for line in range(12):
+        y0 = 20 + line * 22
+        x = 16
+        while x < WIDTH - 24:
+            w = rnd.randint(4, 9)
+            glyph = [[rnd.random() < 0.45 for _ in range(w)] for _ in range(14)]
+            for gy in range(14):
+                for gx in range(w):
+                    if glyph[gy][gx]:
+                        px[y0 + gy][x + gx] = 1
+            x += w + (rnd.randint(6, 12) if rnd.random() < 0.15 else 2)
+    return _pack(px)
+
+
+def sample_dither():
+    bayer = [[0, 8, 2, 10], [12, 4, 14, 6], [3, 11, 1, 9], [15, 7, 13, 5]]
+    px = _canvas()
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            level = 16 * x // WIDTH
+            px[y][x] = 1 if bayer[y % 4][x % 4] < level else 0
+    return _pack(px)
+
+
+def sample_shapes():
+    px = _canvas()
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            border = x < 4 or x >= WIDTH - 4 or y < 4 or y >= HEIGHT - 4
+            circle = abs((x - 200) ** 2 + (y - 150) ** 2 - 90 ** 2) < 400
+            bar = 40 <= y < 70 and 30 <= x < 370
+            px[y][x] = 1 if (border or circle or bar) else 0
+    return _pack(px)
+
+
+def _glyphs(px, rnd, x, y0, x_end, height, scale):
+    """随机字形串，scale 倍放大，模拟一行文字"""
+    while x < x_end - 8 * scale:
+        w = rnd.randint(4, 9)
+        glyph = [[rnd.random() < 0.45 for _ in range(w)] for _ in range(height)]
+        for gy in range(height * scale):
+            for gx in range(w * scale):
+                if glyph[gy // scale][gx // scale]:
+                    px[y0 + gy][x + gx] = 1
+        x += (w + 2) * scale
+
+
+def sample_badge(name_seed):
+    """返回 (黑白图层, 红色图层)，红色图层 bit=1 为红；只有姓名随 name_seed 变化"""
+    bw = _canvas()
+    red = _canvas()
+    for y in range(8, 60):
+        for x in range(8, WIDTH - 8):
+            red[y][x] = 1
+    _glyphs(red, random.Random(100), 24, 20, 300, 14, 2)
+    _glyphs(bw, random.Random(name_seed), 40, 110, 360, 14, 4)
+    _glyphs(bw, random.Random(101), 40, 190, 320, 14, 1)
+    _glyphs(bw, random.Random(102), 40, 220, 260, 14, 1)
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            if x < 3 or x >= WIDTH - 3 or y < 3 or y >= HEIGHT - 3:
+                bw[y][x] = 1
+    return _pack(bw), bytes(b ^ 0xFF for b in _pack(red))
+
+
+def page_crcs(layer):
+    layer = pad_layer(layer)
+    return [zlib.crc32(layer[p * PAGE_SIZE:(p + 1) * PAGE_SIZE]) & 0xFFFFFFFF for p in range(PAGE_COUNT)]
+
+
+def sample_blank():
+    return b"\xff" * LAYER_BYTES
+
+
+def load_input(path):
+    data = open(path, "rb").read()
+    if path.lower().endswith(".bin"):
+        return data[:LAYER_BYTES]
+    from PIL import Image
+    img = Image.open(path).convert("L").resize((WIDTH, HEIGHT)).convert("1")
+    return img.tobytes()
+
+
+def bench(items, baud):
+    print("%-16s %8s %8s %8s %8s %9s %9s" % ("sample", "raw", "rle", "delta", "ratio", "t_raw(s)", "t_best(s)"))
+    for name, layer in items:
+        raw = wire_bytes(encode_layer(layer, use_delta=False, use_rle=False))
+        rle = wire_bytes(encode_layer(layer, use_delta=False))
+        pages = encode_layer(layer)
+        best = wire_bytes(pages)
+        assert decode_layer(pages) == pad_layer(layer)
+        print("%-16s %8d %8d %8d %7.2fx %9.2f %9.2f" % (
+            name[:16], raw, rle, best, float(raw) / best, raw * 10.0 / baud, best * 10.0 / baud))
+
+
+def link_time(pages, k, baud, rtt_ms, proc_ms, ack=True):
+    """整层传输时间（秒）：k 页一帧，每帧等一个应答（ack=False 为逐页连发）"""
+    total = 0.0
+    nbytes = 0
+    for i in range(0, len(pages), k):
+        group = pages[i:i + k]
+        frame = build_batch(group) if k > 1 else build_frame(*group[0])
+        nbytes += len(frame)
+        total += len(frame) * 10.0 / baud
+        if ack:
+            nbytes += BATCH_ACK_LEN
+            total += BATCH_ACK_LEN * 10.0 / baud + rtt_ms / 1000.0 + proc_ms * len(group) / 1000.0
+    return nbytes, total
+
+
+def batch_bench(items, baud, rtt_ms, proc_ms):
+    modes = [("stream", 1, False), ("k=1+ack", 1, True), ("k=2", 2, True), ("k=3", 3, True)]
+    print("%-10s" % "sample" + "".join("%16s" % m[0] for m in modes) + "   (bytes / s)")
+    for name, layer in items:
+        pages = encode_layer(layer)
+        cols = []
+        for _, k, ack in modes:
+            nbytes, t = link_time(pages, k, baud, rtt_ms, proc_ms, ack)
+            cols.append("%8d / %5.2f" % (nbytes, t))
+        print("%-10s" % name[:10] + "".join("%16s" % c for c in cols))
+
+
+def text_frame(text):
+    return len(build_frame(0, text.encode("ascii")))
+
+
+def response_frame(payload_len):
+    return FRAME_HEADER + payload_len + 1 + 2      # 设备应答末尾附 1 字节 credit 上限
+
+
+FRAME_HEADER = 5
+V2_DATA_FRAME = 259
+V2_MANIFEST_REPLY = 3 + 4 * PAGE_COUNT + 2
+
+
+def lpuart_layer(layer, changed, tag):
+    """返回 (字节数, 编程页数)。changed 为 None 表示整层上传（现有方式）"""
+    best = encode_layer(layer)
+    plain = encode_layer(layer, use_delta=False)
+    if changed is None:
+        return wire_bytes(best), PAGE_COUNT + 1
+    nbytes = text_frame("MANIFEST:1," + tag) + response_frame(1 + 4 * PAGE_COUNT)
+    if not changed:
+        return nbytes, 0
+    nbytes += text_frame("BEGIN:1,%s,12345678,89abcdef" % tag) + response_frame(1)
+    prev = None
+    for p in changed:
+        if prev is None or p != prev + 1:
+            # 跳页：先 PAGE:n，该页不能用行差分
+            if p != 0:
+                nbytes += text_frame("PAGE:%d" % p)
+            nbytes += len(build_frame(*plain[p]))
+        else:
+            nbytes += len(build_frame(*best[p]))
+        prev = p
+    nbytes += text_frame("COMMIT") + response_frame(1)
+    # 传输记录 + 改动页 + 头页
+    return nbytes, 1 + len(changed) + 1
+
+
+def v2_layer(changed):
+    """V2 停等：START/READY、每帧 ACK、END/COMPLETE；增量为 MANIFEST + 改动帧 + END_DELTA"""
+    if changed is None:
+        return 4 + 4 + PAGE_COUNT * (V2_DATA_FRAME + 6) + 4 + 4, PAGE_COUNT + 1
+    nbytes = 5 + V2_MANIFEST_REPLY
+    if not changed:
+        return nbytes, 0
+    return nbytes + 4 + 4 + len(changed) * (V2_DATA_FRAME + 6) + 5 + 4, len(changed) + 1
+
+
+def delta_bench(baud):
+    old_bw, old_red = sample_badge(1)
+    print("%-10s %6s  %-13s %8s %7s %9s %7s" % ("update", "pages", "link", "bytes", "t(s)", "programs", "saved"))
+    for seed in (2, 3, 4):
+        new_bw, new_red = sample_badge(seed)
+        changed = []
+        for old, new in ((old_bw, new_bw), (old_red, new_red)):
+            changed.append([p for p, (a, b) in enumerate(zip(page_crcs(old), page_crcs(new))) if a != b])
+        n = len(changed[0]) + len(changed[1])
+        full_l = [lpuart_layer(new_bw, None, "B"), lpuart_layer(new_red, None, "R")]
+        delta_l = [lpuart_layer(new_bw, changed[0], "B"), lpuart_layer(new_red, changed[1], "R")]
+        disp = text_frame("DISPLAY")
+        rows = [
+            ("lpuart full", sum(b for b, _ in full_l) + disp, sum(w for _, w in full_l)),
+            ("lpuart delta", sum(b for b, _ in delta_l) + disp, sum(w for _, w in delta_l)),
+            ("v2 full", v2_layer(None)[0], v2_layer(None)[1]),
+            ("v2 delta", v2_layer(changed[0])[0], v2_layer(changed[0])[1]),
+        ]
+        for i, (link, nbytes, programs) in enumerate(rows):
+            saved = "" if i % 2 == 0 else "%6.1fx" % (float(rows[i - 1][1]) / nbytes)
+            print("%-10s %6s  %-13s %8d %7.2f %9d %7s" % ("name #%d" % seed if i == 0 else "", n if i == 0 else "",
+                                                        link, nbytes, nbytes * 10.0 / baud, programs, saved))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="1bpp layer codec")
+    sub = ap.add_subparsers(dest="cmd")
+    enc = sub.add_parser("encode")
+    enc.add_argument("layer")
+    enc.add_argument("-o", "--output", required=True)
+    enc.add_argument("--red", action="store_true", help="红色图层（FLAGS 置 0x02）")
+    bp = sub.add_parser("bench")
+    bp.add_argument("files", nargs="*")
+    bp.add_argument("--baud", type=int, default=19200)
+    bt = sub.add_parser("batch")
+    bt.add_argument("files", nargs="*")
+    bt.add_argument("--baud", type=int, default=19200)
+    bt.add_argument("--rtt", type=float, default=60.0, help="应答往返延迟 ms（E104 约两个连接间隔）")
+    bt.add_argument("--proc", type=float, default=2.0, help="设备每页解码 + 编程时间 ms")
+    dp = sub.add_parser("delta")
+    dp.add_argument("--baud", type=int, default=19200)
+    opts = ap.parse_args()
+
+    if opts.cmd == "encode":
+        layer = load_input(opts.layer)
+        red = FLAG_RED if opts.red else 0
+        with open(opts.output, "wb") as f:
+            for flags, payload in encode_layer(layer):
+                f.write(build_frame(flags | red, payload))
+    elif opts.cmd in ("bench", "batch"):
+        if opts.files:
+            items = [(os.path.basename(p), load_input(p)) for p in opts.files]
+        else:
+            items = [("text", sample_text()), ("dither", sample_dither()),
+                     ("shapes", sample_shapes()), ("blank", sample_blank())]
+        if opts.cmd == "bench":
+            bench(items, opts.baud)
+        else:
+            batch_bench(items, opts.baud, opts.rtt, opts.proc)
+    elif opts.cmd == "delta":
+        delta_bench(opts.baud)
+    else:
+        ap.print_help()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+解码固件输出的二进制日志（source/log.h）
+
+用法:
+    python tools/log_decode.py capture.bin          # 解码串口抓包文件
+    python tools/log_decode.py -p COM5 -b 115200    # 直接读串口（需要 pyserial）
+
+记录格式：SYNC(0xA5) | ID(2B LE) | ARGC(1B) | TICK_MS(4B LE) | ARGS(ARGC x 4B LE)
+格式字符串直接从 source/log_fmt.h 的 LOG_FORMAT_TABLE 按顺序解析，id 即表中序号。
+不属于日志记录的字节（协议帧、printf 文本）按原样作为文本输出。
+"""
+import argparse
+import os
+import re
+import struct
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+FMT_H = os.path.join(HERE, "..", "source", "log_fmt.h")
+
+SYNC = 0xA5
+MAX_ARGS = 4
+HEADER_LEN = 8
+
+
+def load_formats(path):
+    text = open(path, encoding="utf-8").read()
+    text = text[text.index("#define LOG_FORMAT_TABLE"):]
+    table = []
+    for name, fmt in re.findall(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', text):
+        table.append((name, fmt.encode("latin-1").decode("unicode_escape")))
+    return table
+
+
+CONV = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:ll|l|h|hh)?([diuxXc%])")
+
+
+def render(fmt, args):
+    out = []
+    pos = 0
+    it = iter(args)
+    for m in CONV.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, conv = m.group(1), m.group(2)
+        if conv == "%":
+            out.append("%")
+            continue
+        v = next(it, 0)
+        if conv in "di":
+            v = v - (1 << 32) if v & 0x80000000 else v
+            conv = "d"
+        elif conv == "c":
+            v = v & 0xFF
+        out.append(("%" + flags + conv) % v)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+class Decoder(object):
+    def __init__(self, table, out):
+        self.table = table
+        self.out = out
+        self.buf = bytearray()
+        self.text = bytearray()
+
+    def flush_text(self):
+        if self.text:
+            self.out.write(self.text.decode("utf-8", "replace"))
+            self.text = bytearray()
+
+    def feed(self, data):
+        self.buf.extend(data)
+        while self.buf:
+            if self.buf[0] != SYNC:
+                self.text.append(self.buf.pop(0))
+                continue
+            if len(self.buf) < HEADER_LEN:
+                return
+            ident, argc, tick = struct.unpack_from("<HBI", self.buf, 1)
+            if ident >= len(self.table) or argc > MAX_ARGS:
+                # 不是合法记录头，0xA5 当作普通字节
+                self.text.append(self.buf.pop(0))
+                continue
+            need = HEADER_LEN + 4 * argc
+            if len(self.buf) < need:
+                return
+            args = struct.unpack_from("<%dI" % argc, self.buf, HEADER_LEN)
+            del self.buf[:need]
+            self.flush_text()
+            name, fmt = self.table[ident]
+            self.out.write("[%10u] %s\n" % (tick, render(fmt, args)))
+        self.flush_text()
+
+
+def main():
+    ap = argparse.ArgumentParser(description="decode binary log records")
+    ap.add_argument("capture", nargs="?", help="串口抓包文件")
+    ap.add_argument("-p", "--port", help="串口名，如 COM5 或 /dev/ttyUSB0")
+    ap.add_argument("-b", "--baud", type=int, default=115200)
+    ap.add_argument("--fmt", default=FMT_H, help="log_fmt.h 路径")
+    opts = ap.parse_args()
+
+    dec = Decoder(load_formats(opts.fmt), sys.stdout)
+    if opts.port:
+        import serial
+        ser = serial.Serial(opts.port, opts.baud, timeout=0.1)
+        try:
+            while True:
+                data = ser.read(256)
+                if data:
+                    dec.feed(data)
+                    sys.stdout.flush()
+        except KeyboardInterrupt:
+            pass
+    elif opts.capture:
+        with open(opts.capture, "rb") as f:
+            dec.feed(f.read())
+    else:
+        ap.error("需要抓包文件或 -p 串口")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
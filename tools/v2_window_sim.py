@@ -0,0 +1,457 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+图像传输 V2：停等与滑动窗口（累计 ACK + SACK 位图）上传 61 帧的链路仿真
+
+用法:
+    python tools/v2_window_sim.py                                   # 默认参数表
+    python tools/v2_window_sim.py --latency 15 30 60 --loss 0 0.02 0.05 --window 1 2 3 8
+    python tools/v2_window_sim.py --disconnect 5 10 20 --outage 2 --baud 19200 [--reboot]   # 断线续传
+
+链路模型：上下行各自按字节速率串行发送（8N1），再加单向延迟；每个帧按 --loss 概率整帧丢失。
+设备模型与 source/image_transfer_v2.c 一致：帧池 --slots 个槽（满则丢帧），每帧处理 --proc 毫秒，
+窗口模式每 K=max(1, W/2) 个新帧、发现新缺口、收到重复帧或图像收齐时回 SACK，链路空闲 200ms 重发 SACK。
+主机按 SACK 位图只重传缺失帧；W 大于设备槽数时设备会按槽数授予窗口，此处可用 --no-clamp 观察不限窗口的效果。
+时间包含 START/READY 握手和 END/COMPLETE。
+
+--disconnect：链路每 N 秒断开一次（E104 蓝牙断线），--outage 秒后重连，断开期间发送的和在途的帧全部丢失；
+--reboot 时设备同时重启，内存中的接收状态丢失，已写入 flash 的帧保留。对比两种主机策略：
+    restart  重连后 START，从第 0 帧重发（现有做法）
+    resume   BEGIN 开始，重连后 RESUME，设备回 READY + SACK（flash 中已写入的帧），只补发缺失帧
+输出下行总字节数和超出 61 帧一遍的重发字节数；600 秒内没完成的记为未完成。
+"""
+import argparse
+import heapq
+import random
+
+FRAMES = 61
+DATA_LEN = 259
+CTRL_LEN = 4
+ACK_LEN = 6
+SACK_LEN = 14
+READY_WIN_LEN = 6
+XFER_LEN = 14               # BEGIN / RESUME
+TIMEOUT_SACK = 200.0
+LIMIT_MS = 600000.0
+
+
+class Link(object):
+    """单向串行链路：发送排队 + 延迟 + 丢帧"""
+
+    def __init__(self, sim, byte_ms, latency, loss, rnd):
+        self.sim = sim
+        self.byte_ms = byte_ms
+        self.latency = latency
+        self.loss = loss
+        self.rnd = rnd
+        self.free_at = 0.0
+        self.sent = 0
+
+    def send(self, nbytes, deliver, *args):
+        start = max(self.sim.now, self.free_at)
+        self.free_at = start + nbytes * self.byte_ms
+        self.sent += nbytes
+        if self.rnd.random() >= self.loss and not self.sim.is_down(start, self.free_at + self.latency):
+            self.sim.at(self.free_at + self.latency, deliver, *args)
+        return self.free_at
+
+
+class Sim(object):
+    def __init__(self):
+        self.now = 0.0
+        self.q = []
+        self.seq = 0
+        self.done = None
+        self.outages = []       # [(断开时刻, 重连时刻)]
+
+    def is_down(self, t0, t1):
+        for down, up in self.outages:
+            if down < t1 and t0 < up:
+                return True
+        return False
+
+    def at(self, t, fn, *args):
+        self.seq += 1
+        heapq.heappush(self.q, (t, self.seq, fn, args))
+
+    def run(self, limit=LIMIT_MS):
+        while self.q and self.done is None:
+            t, _, fn, args = heapq.heappop(self.q)
+            if t > limit:
+                break
+            self.now = t
+            fn(*args)
+        return self.done
+
+
+class Device(object):
+    def __init__(self, sim, up, slots, proc, clamp):
+        self.sim = sim
+        self.up = up
+        self.slots = slots
+        self.proc = proc
+        self.clamp = clamp
+        self.queue = []
+        self.busy = False
+        self.window_mode = False
+        self.bitmap = 0
+        self.cum = 0
+        self.gap_cum = None
+        self.since = 0
+        self.k = 1
+        self.last_rx = 0.0
+        self.last_sack = 0.0
+        self.host = None
+        self.active = False
+        self.stored = 0         # flash 中本次传输已写入的帧（重启后仍在）
+        self.boot = 0
+        self.sim.at(TIMEOUT_SACK, self.timer)
+
+    # 接收：帧池满则丢帧
+    def rx(self, kind, arg):
+        if len(self.queue) + (1 if self.busy else 0) >= self.slots:
+            return
+        self.queue.append((kind, arg))
+        self.kick()
+
+    def kick(self):
+        if not self.busy and self.queue:
+            self.busy = True
+            kind, arg = self.queue.pop(0)
+            cost = self.proc if kind == "data" else 0.1
+            self.sim.at(self.sim.now + cost, self.handle, kind, arg, self.boot)
+
+    def reboot(self):
+        self.boot += 1
+        self.queue = []
+        self.busy = False
+        self.active = False
+        self.window_mode = False
+        self.bitmap = 0
+
+    def handle(self, kind, arg, boot):
+        if boot != self.boot:
+            return
+        self.busy = False
+        self.last_rx = self.sim.now
+        if kind in ("start", "begin", "resume"):
+            self.window_mode = arg is not None
+            if kind == "resume":
+                self.bitmap = self.stored
+            else:
+                self.bitmap = 0
+                self.stored = 0
+            self.cum = 0
+            while self.cum < FRAMES and self.bitmap >> self.cum & 1:
+                self.cum += 1
+            self.gap_cum = None
+            self.since = 0
+            self.active = True
+            if self.window_mode:
+                w = max(1, min(arg, self.slots) if self.clamp else arg)
+                self.k = max(1, w // 2)
+                self.up.send(READY_WIN_LEN, self.host.on_ready, w)
+            else:
+                self.up.send(CTRL_LEN, self.host.on_ready, 1)
+            if kind == "resume":
+                self.sack()
+        elif kind == "data" and self.active:
+            f = arg
+            if self.bitmap >> f & 1:
+                if self.window_mode:
+                    self.sack()
+                else:
+                    self.up.send(ACK_LEN, self.host.on_ack, f)
+            else:
+                self.bitmap |= 1 << f
+                self.stored |= 1 << f
+                if self.window_mode:
+                    before = self.cum
+                    while self.cum < FRAMES and self.bitmap >> self.cum & 1:
+                        self.cum += 1
+                    self.since += 1
+                    if self.cum >= FRAMES or self.since >= self.k:
+                        self.sack()
+                    elif f != before and self.gap_cum != before:
+                        self.gap_cum = before
+                        self.sack()
+                else:
+                    self.up.send(ACK_LEN, self.host.on_ack, f)
+        elif kind == "end" and self.active:
+            ok = self.bitmap == (1 << FRAMES) - 1
+            self.up.send(CTRL_LEN, self.host.on_complete, ok)
+        self.kick()
+
+    def sack(self):
+        self.since = 0
+        self.last_sack = self.sim.now
+        self.up.send(SACK_LEN, self.host.on_sack, self.cum, self.bitmap)
+
+    def timer(self):
+        now = self.sim.now
+        if self.active and self.window_mode and self.cum < FRAMES and now - self.last_rx < 5000.0 \
+                and now - self.last_sack >= TIMEOUT_SACK and now - self.last_rx >= TIMEOUT_SACK:
+            self.sack()
+        self.sim.at(now + 20.0, self.timer)
+
+
+class Host(object):
+    def __init__(self, sim, down, window, rto, rtt, resume=False):
+        self.sim = sim
+        self.resume = resume
+        self.data_bytes = 0
+        self.rtt = rtt
+        self.down = down
+        self.req_window = window
+        self.window = 1
+        self.rto = rto
+        self.acked = 0
+        self.inflight = {}      # frame -> 发送序号
+        self.sent_at = {}
+        self.tx_seq = 0
+        self.last_seq = {}
+        self.next_new = 0
+        self.epoch = 0
+        self.phase = "start"
+        self.dev = None
+        self.retx = 0
+
+    def start(self):
+        self.phase = "start"
+        arg = self.req_window if self.req_window > 1 else None
+        if self.resume:
+            self.down.send(XFER_LEN, self.dev.rx, "begin", arg)
+        else:
+            self.down.send(CTRL_LEN + (1 if arg else 0), self.dev.rx, "start", arg)
+        self.arm()
+
+    def send_resume(self):
+        self.phase = "resume"
+        arg = self.req_window if self.req_window > 1 else None
+        self.down.send(XFER_LEN, self.dev.rx, "resume", arg)
+        self.arm()
+
+    def on_disconnect(self):
+        self.epoch += 1
+        self.inflight.clear()
+        self.phase = "down"
+
+    def on_reconnect(self):
+        if self.resume:
+            self.send_resume()
+        else:
+            # 现有协议：断线后从第 0 帧重新开始
+            self.acked = 0
+            self.next_new = 0
+            self.start()
+
+    def arm(self):
+        self.epoch += 1
+        self.sim.at(self.sim.now + self.rto, self.on_timeout, self.epoch)
+
+    def on_timeout(self, epoch):
+        if epoch != self.epoch:
+            return
+        if self.phase == "start":
+            self.start()
+        elif self.phase == "resume":
+            self.send_resume()
+        elif self.phase == "data":
+            self.retx += len(self.inflight)
+            self.inflight.clear()
+            self.pump()
+            self.arm()
+        elif self.phase == "end":
+            self.send_end()
+
+    def on_ready(self, w):
+        if self.phase == "resume":
+            # 等随后的 SACK 告诉哪些帧已在 flash 中
+            self.window = w
+            self.phase = "resume_sack"
+            return
+        if self.phase != "start":
+            return
+        self.window = w
+        self.phase = "data"
+        self.pump()
+        self.arm()
+
+    def missing(self):
+        for f in range(FRAMES):
+            if not (self.acked >> f & 1) and f not in self.inflight:
+                if f < self.next_new:
+                    return f
+        if self.next_new < FRAMES:
+            return self.next_new
+        return None
+
+    def pump(self):
+        while len(self.inflight) < self.window:
+            f = self.missing()
+            if f is None:
+                break
+            if f == self.next_new:
+                self.next_new += 1
+            else:
+                self.retx += 1
+            self.tx_seq += 1
+            self.inflight[f] = self.tx_seq
+            self.last_seq[f] = self.tx_seq
+            self.sent_at[f] = self.down.send(DATA_LEN, self.dev.rx, "data", f)
+            self.data_bytes += DATA_LEN
+        if self.acked == (1 << FRAMES) - 1:
+            self.send_end()
+
+    def on_ack(self, f):
+        if self.phase != "data":
+            return
+        self.acked |= 1 << f
+        self.inflight.pop(f, None)
+        self.pump()
+        self.arm()
+
+    def on_sack(self, cum, bitmap):
+        if self.phase == "resume_sack":
+            self.acked = bitmap
+            self.phase = "data"
+            self.pump()
+            self.arm()
+            return
+        if self.phase != "data":
+            return
+        progress = (bitmap | self.acked) != self.acked
+        self.acked |= bitmap
+        for f in list(self.inflight):
+            if self.acked >> f & 1:
+                del self.inflight[f]
+        # 比位图中最新收到的帧更早发出、却没收到的帧视为丢失
+        newest = max([self.last_seq[f] for f in range(FRAMES) if bitmap >> f & 1] or [0])
+        for f in list(self.inflight):
+            if self.inflight[f] < newest:
+                del self.inflight[f]
+        if not progress and cum < FRAMES:
+            # 没有新进展的 SACK（空闲重发或重复帧）：超过一个往返仍未确认的在途帧视为丢失
+            for f in list(self.inflight):
+                if self.sim.now - self.sent_at[f] > self.rtt:
+                    del self.inflight[f]
+        self.pump()
+        self.arm()
+
+    def send_end(self):
+        if self.phase != "end":
+            self.phase = "end"
+        self.down.send(CTRL_LEN, self.dev.rx, "end", None)
+        self.arm()
+
+    def on_complete(self, ok):
+        if self.phase == "end" and ok:
+            self.sim.done = self.sim.now
+
+
+def build(args, window, latency, loss, seed, resume=False):
+    rnd = random.Random(seed)
+    sim = Sim()
+    byte_ms = 10000.0 / args.baud
+    down = Link(sim, byte_ms, latency, loss, rnd)
+    up = Link(sim, byte_ms, latency, loss, rnd)
+    dev = Device(sim, up, args.slots, args.proc, not args.no_clamp)
+    granted = min(window, args.slots) if not args.no_clamp else window
+    rto = 2 * latency + (granted + 1) * DATA_LEN * byte_ms + args.proc * granted + 50.0
+    rtt = 2 * latency + (DATA_LEN + SACK_LEN) * byte_ms + args.proc
+    host = Host(sim, down, window, rto, rtt, resume)
+    host.dev = dev
+    dev.host = host
+    return sim, host, dev
+
+
+def run_once(args, window, latency, loss, seed):
+    sim, host, dev = build(args, window, latency, loss, seed)
+    host.start()
+    t = sim.run()
+    return t, host.retx
+
+
+def run_disconnect(args, window, every, resume, seed):
+    """链路每 every 秒断开 args.outage 秒；返回 (完成时间 ms 或 None, 下行总字节, 数据帧字节)"""
+    sim, host, dev = build(args, window, args.latency[0], args.loss[0], seed, resume)
+    t = every * 1000.0
+    while t < LIMIT_MS:
+        up = t + args.outage * 1000.0
+        sim.outages.append((t, up))
+        sim.at(t, host.on_disconnect)
+        if args.reboot:
+            sim.at(t, dev.reboot)
+        sim.at(up, host.on_reconnect)
+        t = up + every * 1000.0
+    host.start()
+    done = sim.run()
+    return done, host.down.sent, host.data_bytes
+
+
+def disconnect_table(args):
+    once = FRAMES * DATA_LEN
+    print("baud=%d slots=%d lat=%.1fms loss=%.2f outage=%.1fs reboot=%s trials=%d, 一遍 61 帧 = %d 字节" % (
+        args.baud, args.slots, args.latency[0], args.loss[0], args.outage,
+        "yes" if args.reboot else "no", args.trials, once))
+    print("%9s %4s %8s %10s %6s %10s %10s" % ("every(s)", "W", "mode", "time(s)", "done", "down(B)", "resent(B)"))
+    for every in args.disconnect:
+        for w in args.window:
+            for resume in (False, True):
+                times = []
+                sent = 0
+                resent = 0
+                for trial in range(args.trials):
+                    t, total, data = run_disconnect(args, w, every, resume, 1000 * trial + 7)
+                    if t is not None:
+                        times.append(t)
+                    sent += total
+                    resent += max(0, data - once)
+                mean = "%10.2f" % (sum(times) / len(times) / 1000.0) if times else "%10s" % "-"
+                print("%9.1f %4d %8s %s %3d/%-2d %10d %10d" % (
+                    every, w, "resume" if resume else "restart", mean, len(times), args.trials,
+                    sent // args.trials, resent // args.trials))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="V2 stop-and-wait vs sliding window")
+    ap.add_argument("--latency", type=float, nargs="+", default=[7.5, 30.0, 60.0], help="单向延迟 ms")
+    ap.add_argument("--loss", type=float, nargs="+", default=[0.0, 0.02, 0.05], help="整帧丢失概率")
+    ap.add_argument("--window", type=int, nargs="+", default=[1, 2, 3])
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--slots", type=int, default=3, help="设备帧池槽数（source/frame_pool.h）")
+    ap.add_argument("--proc", type=float, default=2.0, help="设备处理一帧的时间 ms（CRC + Flash 编程）")
+    ap.add_argument("--trials", type=int, default=20)
+    ap.add_argument("--no-clamp", action="store_true", help="不按帧池槽数限制窗口")
+    ap.add_argument("--disconnect", type=float, nargs="+", help="每 N 秒断线一次（只用第一个 --latency/--loss）")
+    ap.add_argument("--outage", type=float, default=2.0, help="断线到重连的秒数")
+    ap.add_argument("--reboot", action="store_true", help="断线时设备同时重启")
+    args = ap.parse_args()
+
+    if args.disconnect:
+        disconnect_table(args)
+        return 0
+
+    print("baud=%d slots=%d proc=%.1fms trials=%d (W=1 为停等)" % (args.baud, args.slots, args.proc, args.trials))
+    print("%8s %6s %4s %10s %8s %8s" % ("lat(ms)", "loss", "W", "time(s)", "speedup", "retx"))
+    for latency in args.latency:
+        for loss in args.loss:
+            base = None
+            for w in args.window:
+                times = []
+                retx = 0
+                for trial in range(args.trials):
+                    t, r = run_once(args, w, latency, loss, 1000 * trial + 7)
+                    if t is not None:
+                        times.append(t)
+                    retx += r
+                mean = sum(times) / len(times) / 1000.0 if times else float("nan")
+                if base is None:
+                    base = mean
+                print("%8.1f %6.2f %4d %10.2f %7.2fx %8.1f" % (
+                    latency, loss, w, mean, base / mean, float(retx) / args.trials))
+    return 0
+
+
+if __name__ == "__main__":
+    main()